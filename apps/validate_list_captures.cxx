@@ -0,0 +1,240 @@
+/**
+ * @file validate_list_captures.cxx
+ *
+ * validate_list_captures is a standalone application that checks, after the
+ * fact, that the lists recorded in a capture file of reversed lists are the
+ * reverse of the lists recorded in a capture file of original lists. It uses
+ * the same comparison core as the ReversedListValidator DAQModule, and spreads
+ * the comparisons over all of the available cores.
+ *
+ * Usage: validate_list_captures <original capture file> <reversed capture file> [number of threads]
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ListCaptureFile.hpp"
+#include "ReversedListComparison.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::afv1_example;
+
+namespace {
+
+/**
+ * @brief Maximum number of mismatch reports that are printed, in total
+ */
+constexpr size_t MAX_PRINTED_MISMATCHES = 10;
+
+struct ValidationTotals
+{
+  std::atomic<size_t> comparisons{ 0 };
+  std::atomic<size_t> mismatches{ 0 };
+  std::atomic<size_t> bytes{ 0 };
+};
+
+/**
+ * @brief The indices of the records of a file, by stream, in the order in which they were recorded
+ */
+std::map<uint32_t, std::vector<size_t>>
+records_by_stream(const ListCaptureReader& capture)
+{
+  std::map<uint32_t, std::vector<size_t>> streams;
+  for (size_t idx = 0; idx < capture.record_count(); ++idx) {
+    streams[capture.record(idx).header->streamId].push_back(idx);
+  }
+  return streams;
+}
+
+/**
+ * @brief Pairs the records of the two files by stream and, within each stream, by sequence
+ * number, skipping over records that have no partner in the other file (in the same way as
+ * ReversedListValidator)
+ */
+std::vector<std::pair<size_t, size_t>>
+pair_records(const ListCaptureReader& original,
+             const ListCaptureReader& reversed,
+             size_t& unpairedOriginals,
+             size_t& unpairedReversed)
+{
+  std::vector<std::pair<size_t, size_t>> pairs;
+  pairs.reserve(std::min(original.record_count(), reversed.record_count()));
+  auto originalStreams = records_by_stream(original);
+  auto reversedStreams = records_by_stream(reversed);
+  for (auto& [streamId, origIndices] : originalStreams) {
+    auto revStream = reversedStreams.find(streamId);
+    if (revStream == reversedStreams.end()) {
+      unpairedOriginals += origIndices.size();
+      continue;
+    }
+    const std::vector<size_t>& revIndices = revStream->second;
+    size_t origPos = 0;
+    size_t revPos = 0;
+    while (origPos < origIndices.size() && revPos < revIndices.size()) {
+      uint64_t origSeq = original.record(origIndices[origPos]).header->sequenceNumber;
+      uint64_t revSeq = reversed.record(revIndices[revPos]).header->sequenceNumber;
+      if (origSeq < revSeq) {
+        ++unpairedOriginals;
+        ++origPos;
+      } else if (origSeq > revSeq) {
+        ++unpairedReversed;
+        ++revPos;
+      } else {
+        pairs.emplace_back(origIndices[origPos++], revIndices[revPos++]);
+      }
+    }
+    unpairedOriginals += origIndices.size() - origPos;
+    unpairedReversed += revIndices.size() - revPos;
+    reversedStreams.erase(revStream);
+  }
+  for (auto& [streamId, revIndices] : reversedStreams) {
+    unpairedReversed += revIndices.size();
+  }
+  return pairs;
+}
+
+/**
+ * @brief Compares the pairs of records from begin up to end, whose elements are of type T
+ */
+template<typename T>
+void
+validate_range(const ListCaptureReader& original,
+               const ListCaptureReader& reversed,
+               const std::vector<std::pair<size_t, size_t>>& pairs,
+               size_t begin,
+               size_t end,
+               ValidationTotals& totals,
+               std::mutex& printMutex)
+{
+  size_t comparisons = 0;
+  size_t bytes = 0;
+  for (size_t idx = begin; idx < end; ++idx) {
+    auto origRecord = original.record(pairs[idx].first);
+    auto revRecord = reversed.record(pairs[idx].second);
+    const T* origData = static_cast<const T*>(origRecord.elements);
+    const T* revData = static_cast<const T*>(revRecord.elements);
+    size_t origLength = origRecord.header->length;
+    size_t revLength = revRecord.header->length;
+
+    ++comparisons;
+    bytes += (origLength + revLength) * sizeof(T);
+    if (!is_reverse_of(origData, origLength, revData, revLength)) {
+      size_t mismatchNumber = totals.mismatches.fetch_add(1) + 1;
+      if (mismatchNumber <= MAX_PRINTED_MISMATCHES) {
+        auto report = make_mismatch_report(origData, origLength, revData, revLength);
+        std::lock_guard<std::mutex> lock(printMutex);
+        std::cout << "Mismatch for stream " << origRecord.header->streamId << ", sequence number "
+                  << origRecord.header->sequenceNumber << ": " << report << std::endl;
+      }
+    }
+  }
+  totals.comparisons += comparisons;
+  totals.bytes += bytes;
+}
+
+/**
+ * @brief Selects the instantiation of validate_range for the element size of the capture files.
+ * Elements are compared for equality only, so every element type of a given size (e.g. the 8-byte
+ * ChannelSample struct and uint64_t) is validated by the same integer instantiation.
+ */
+decltype(&validate_range<int>)
+validate_range_for_element_size(uint32_t elementSize)
+{
+  switch (elementSize) {
+    case sizeof(uint16_t):
+      return &validate_range<uint16_t>;
+    case sizeof(int):
+      return &validate_range<int>;
+    case sizeof(uint64_t):
+      return &validate_range<uint64_t>;
+    default:
+      return nullptr;
+  }
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <original capture file> <reversed capture file> [number of threads]"
+              << std::endl;
+    return 2;
+  }
+
+  size_t threadCount = std::thread::hardware_concurrency();
+  if (argc > 3) {
+    threadCount = std::strtoul(argv[3], nullptr, 10);
+  }
+  if (threadCount == 0) {
+    threadCount = 1;
+  }
+
+  try {
+    auto startTime = std::chrono::steady_clock::now();
+    ListCaptureReader original(argv[1]);
+    ListCaptureReader reversed(argv[2]);
+    auto validateRange = validate_range_for_element_size(original.element_size());
+    if (original.element_size() != reversed.element_size() || validateRange == nullptr) {
+      std::cerr << "The capture files hold elements of " << original.element_size() << " and "
+                << reversed.element_size() << " bytes, but the files must hold elements of the same size, "
+                << "and only 2-, 4- and 8-byte elements are supported" << std::endl;
+      return 2;
+    }
+
+    size_t unpairedOriginals = 0;
+    size_t unpairedReversed = 0;
+    auto pairs = pair_records(original, reversed, unpairedOriginals, unpairedReversed);
+    auto indexedTime = std::chrono::steady_clock::now();
+
+    ValidationTotals totals;
+    std::mutex printMutex;
+    std::vector<std::thread> workers;
+    size_t pairsPerThread = (pairs.size() + threadCount - 1) / threadCount;
+    for (size_t begin = 0; begin < pairs.size(); begin += pairsPerThread) {
+      size_t end = std::min(begin + pairsPerThread, pairs.size());
+      workers.emplace_back(validateRange,
+                           std::cref(original),
+                           std::cref(reversed),
+                           std::cref(pairs),
+                           begin,
+                           end,
+                           std::ref(totals),
+                           std::ref(printMutex));
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    auto endTime = std::chrono::steady_clock::now();
+
+    double compareSeconds = std::chrono::duration<double>(endTime - indexedTime).count();
+    double totalSeconds = std::chrono::duration<double>(endTime - startTime).count();
+    double gigabytes = static_cast<double>(totals.bytes.load()) / 1e9;
+    std::cout << "Compared " << totals.comparisons.load() << " pairs of lists using " << workers.size()
+              << " thread(s) and found " << totals.mismatches.load() << " mismatches. " << unpairedOriginals
+              << " original and " << unpairedReversed << " reversed lists had no partner." << std::endl;
+    std::cout << "Validated " << gigabytes << " GB of list data in " << compareSeconds << " s ("
+              << (compareSeconds > 0 ? gigabytes / compareSeconds : 0.0) << " GB/s); " << totalSeconds
+              << " s including mapping and indexing the files ("
+              << (totalSeconds > 0 ? gigabytes / totalSeconds : 0.0) << " GB/s)." << std::endl;
+
+    return (totals.mismatches.load() == 0 && unpairedOriginals == 0 && unpairedReversed == 0) ? 0 : 1;
+  } catch (const std::exception& excpt) {
+    std::cerr << excpt.what() << std::endl;
+    return 2;
+  }
+}
@@ -31,6 +31,69 @@ ERS_DECLARE_ISSUE_BASE(afv1_example,
                        ((std::string)name),
                        ((std::string)queueType))
 
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       InvalidSocketFatalError,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The socket for address " << address << " could not be set up.",
+                       ((std::string)name),
+                       ((std::string)address))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       InvalidSettingFatalError,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The setting \"" << setting << "\" does not have a valid value.",
+                       ((std::string)name),
+                       ((std::string)setting))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       SuppressedIssuesSummary,
+                       appfwk::GeneralDAQModuleIssue,
+                       suppressedCount << " further occurrence(s) of \"" << issueDescription
+                                       << "\" were not reported individually since the previous report ("
+                                       << totalCount << " in total).",
+                       ((std::string)name),
+                       ((std::string)issueDescription)((size_t)suppressedCount)((size_t)totalCount))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       SequenceGapDetected,
+                       appfwk::GeneralDAQModuleIssue,
+                       gapSize << " list(s) missing from stream " << streamId << " on " << inputDescription
+                               << " before sequence number " << sequenceNumber << ".",
+                       ((std::string)name),
+                       ((std::string)inputDescription)((uint32_t)streamId)((uint64_t)sequenceNumber)((uint64_t)gapSize))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       DuplicateSequenceNumber,
+                       appfwk::GeneralDAQModuleIssue,
+                       "List with sequence number " << sequenceNumber << " from stream " << streamId << " on "
+                                                    << inputDescription << " was received more than once.",
+                       ((std::string)name),
+                       ((std::string)inputDescription)((uint32_t)streamId)((uint64_t)sequenceNumber))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       ConflictingSettingsWarning,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The settings \"" << usedSetting << "\" and \"" << ignoredSetting
+                                          << "\" can not be used together; \"" << ignoredSetting << "\" is ignored.",
+                       ((std::string)name),
+                       ((std::string)usedSetting)((std::string)ignoredSetting))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       InvalidHugePageSettingWarning,
+                       appfwk::GeneralDAQModuleIssue,
+                       "\"" << setting << "\" is not a valid huge page setting (expected \"none\", \"2MB\" or \"1GB\"); normal pages will be used for list buffers.",
+                       ((std::string)name),
+                       ((std::string)setting))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       ConflictingHugePageSettingWarning,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The huge page setting \"" << setting << "\" is ignored, since module " << decidingModule
+                                                   << " asked first, for \"" << decidedPageSize
+                                                   << "\", and the list buffers of the whole process share the pages.",
+                       ((std::string)name),
+                       ((std::string)setting)((std::string)decidedPageSize)((std::string)decidingModule))
+
 } // namespace dunedaq
 
 #endif // AFV1_EXAMPLE_SRC_COMMONISSUES_HPP_
@@ -0,0 +1,379 @@
+/**
+ * @file HugePageArena.cpp HugePageArena class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "HugePageArena.hpp"
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <new>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+namespace dunedaq {
+namespace afv1_example {
+
+namespace {
+
+constexpr size_t HUGE_1GB = 1024 * 1024 * 1024;
+constexpr size_t NORMAL_PAGE_SIZE = 4096;
+
+// arenas are never destroyed, since the chunks that they hand out are never returned
+std::mutex g_registryMutex;
+std::atomic<HugePageArena*> g_arenas[3] = {};
+
+size_t
+round_up(size_t bytes, size_t multiple)
+{
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+HugePageArena&
+HugePageArena::get(PageSize pageSize)
+{
+  std::lock_guard<std::mutex> lock(g_registryMutex);
+  auto& arena = g_arenas[static_cast<size_t>(pageSize)];
+  if (arena.load(std::memory_order_relaxed) == nullptr) {
+    arena.store(new HugePageArena(pageSize), std::memory_order_release);
+  }
+  return *arena.load(std::memory_order_relaxed);
+}
+
+bool
+HugePageArena::parse_page_size(const std::string& text, PageSize& pageSize)
+{
+  if (text == "none") {
+    pageSize = PageSize::kNormal;
+  } else if (text == "2MB") {
+    pageSize = PageSize::k2MB;
+  } else if (text == "1GB") {
+    pageSize = PageSize::k1GB;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+HugePageArena::HugePageArena(PageSize pageSize)
+  : requestedPageSize_(pageSize)
+  , try1GB_(pageSize == PageSize::k1GB)
+  , try2MB_(pageSize != PageSize::kNormal)
+{
+  stats_.requestedPageSize = pageSize;
+}
+
+void*
+HugePageArena::allocate_chunk()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  void* chunk = nullptr;
+  if (try1GB_ && regionNext_ == regionEnd_ && !map_1gb_region()) {
+    try1GB_ = false;
+    ++stats_.fallbacks;
+  }
+  if (regionNext_ != regionEnd_) {
+    chunk = regionNext_;
+    regionNext_ += CHUNK_SIZE;
+  }
+  if (chunk == nullptr && try2MB_) {
+    chunk = map_2mb_chunk();
+    if (chunk == nullptr) {
+      try2MB_ = false;
+      ++stats_.fallbacks;
+    }
+  }
+  if (chunk == nullptr) {
+    chunk = map_advised_chunk();
+  }
+  ++stats_.chunks;
+  return chunk;
+}
+
+bool
+HugePageArena::map_1gb_region()
+{
+  void* region =
+    mmap(nullptr, HUGE_1GB, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0);
+  if (region == MAP_FAILED) {
+    return false;
+  }
+  regionNext_ = static_cast<char*>(region);
+  regionEnd_ = regionNext_ + HUGE_1GB;
+  mappings_.push_back({ reinterpret_cast<uintptr_t>(region), HUGE_1GB, false });
+  stats_.bytesIn1GBPages += HUGE_1GB;
+  stats_.pageTableEntries += 1;
+  return true;
+}
+
+void*
+HugePageArena::map_2mb_chunk()
+{
+  void* chunk =
+    mmap(nullptr, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+  if (chunk == MAP_FAILED) {
+    return nullptr;
+  }
+  mappings_.push_back({ reinterpret_cast<uintptr_t>(chunk), CHUNK_SIZE, false });
+  stats_.bytesIn2MBPages += CHUNK_SIZE;
+  stats_.pageTableEntries += 1;
+  return chunk;
+}
+
+void*
+HugePageArena::map_advised_chunk()
+{
+  // map twice the chunk size and trim, so that the chunk is aligned to the huge page size
+  void* mapping = mmap(nullptr, 2 * CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+  uintptr_t aligned = (start + CHUNK_SIZE - 1) & ~(uintptr_t(CHUNK_SIZE) - 1);
+  if (aligned > start) {
+    munmap(mapping, aligned - start);
+  }
+  if (aligned + CHUNK_SIZE < start + 2 * CHUNK_SIZE) {
+    munmap(reinterpret_cast<void*>(aligned + CHUNK_SIZE), start + 2 * CHUNK_SIZE - aligned - CHUNK_SIZE);
+  }
+
+  void* chunk = reinterpret_cast<void*>(aligned);
+  bool advised = requestedPageSize_ != PageSize::kNormal && madvise(chunk, CHUNK_SIZE, MADV_HUGEPAGE) == 0;
+  mappings_.push_back({ aligned, CHUNK_SIZE, advised });
+  if (advised) {
+    stats_.bytesAdvised += CHUNK_SIZE;
+  } else {
+    stats_.bytesNormal += CHUNK_SIZE;
+  }
+  return chunk;
+}
+
+void*
+HugePageArena::allocate_large(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Mapping mapping{ 0, 0, false };
+  bool use1GB = try1GB_ && bytes >= HUGE_1GB;
+  size_t length = round_up(bytes, use1GB ? HUGE_1GB : CHUNK_SIZE);
+  for (auto iter = cachedLargeMappings_.begin(); iter != cachedLargeMappings_.end(); ++iter) {
+    if (iter->length == length) {
+      mapping = *iter;
+      cachedLargeMappings_.erase(iter);
+      --stats_.largeMappingsCached;
+      stats_.largeBytesCached -= length;
+      ++stats_.largeMappingsReused;
+      break;
+    }
+  }
+  if (mapping.start == 0) {
+    if (use1GB && !map_large_hugetlb(length, PageSize::k1GB, mapping)) {
+      try1GB_ = false;
+      ++stats_.fallbacks;
+      length = round_up(bytes, CHUNK_SIZE);
+    }
+    if (mapping.start == 0 && try2MB_ && !map_large_hugetlb(length, PageSize::k2MB, mapping)) {
+      try2MB_ = false;
+      ++stats_.fallbacks;
+    }
+    if (mapping.start == 0) {
+      mapping = map_large_advised(length);
+    }
+    count_large_mapping(mapping, true);
+  }
+  largeMappings_.emplace(mapping.start, mapping);
+  ++stats_.largeMappings;
+  stats_.largeBytes += mapping.length;
+  return reinterpret_cast<void*>(mapping.start);
+}
+
+bool
+HugePageArena::deallocate_large(void* block)
+{
+  for (auto& arena : g_arenas) {
+    HugePageArena* candidate = arena.load(std::memory_order_acquire);
+    if (candidate != nullptr && candidate->release_large(reinterpret_cast<uintptr_t>(block))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+HugePageArena::release_large(uintptr_t start)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = largeMappings_.find(start);
+  if (iter == largeMappings_.end()) {
+    return false;
+  }
+  Mapping mapping = iter->second;
+  largeMappings_.erase(iter);
+  --stats_.largeMappings;
+  stats_.largeBytes -= mapping.length;
+  if (cachedLargeMappings_.size() < MAX_CACHED_LARGE_MAPPINGS) {
+    cachedLargeMappings_.push_back(mapping);
+    ++stats_.largeMappingsCached;
+    stats_.largeBytesCached += mapping.length;
+  } else {
+    munmap(reinterpret_cast<void*>(mapping.start), mapping.length);
+    count_large_mapping(mapping, false);
+  }
+  return true;
+}
+
+bool
+HugePageArena::map_large_hugetlb(size_t length, PageSize pageSize, Mapping& mapping)
+{
+  int hugeFlag = pageSize == PageSize::k1GB ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+  void* block =
+    mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | hugeFlag, -1, 0);
+  if (block == MAP_FAILED) {
+    return false;
+  }
+  mapping = { reinterpret_cast<uintptr_t>(block), length, false, pageSize };
+  return true;
+}
+
+HugePageArena::Mapping
+HugePageArena::map_large_advised(size_t length)
+{
+  // map an extra chunk and trim, so that the block is aligned to the huge page size
+  void* region = mmap(nullptr, length + CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(region);
+  uintptr_t aligned = (start + CHUNK_SIZE - 1) & ~(uintptr_t(CHUNK_SIZE) - 1);
+  if (aligned > start) {
+    munmap(region, aligned - start);
+  }
+  if (aligned + length < start + length + CHUNK_SIZE) {
+    munmap(reinterpret_cast<void*>(aligned + length), start + CHUNK_SIZE - aligned);
+  }
+  bool advised =
+    requestedPageSize_ != PageSize::kNormal && madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE) == 0;
+  return { aligned, length, advised };
+}
+
+void
+HugePageArena::count_large_mapping(const Mapping& mapping, bool add)
+{
+  auto count = [add](uint64_t& counter, uint64_t amount) {
+    if (add) {
+      counter += amount;
+    } else {
+      counter -= amount;
+    }
+  };
+  switch (mapping.pageSize) {
+    case PageSize::k1GB:
+      count(stats_.bytesIn1GBPages, mapping.length);
+      count(stats_.pageTableEntries, mapping.length / HUGE_1GB);
+      break;
+    case PageSize::k2MB:
+      count(stats_.bytesIn2MBPages, mapping.length);
+      count(stats_.pageTableEntries, mapping.length / CHUNK_SIZE);
+      break;
+    case PageSize::kNormal:
+      count(mapping.advised ? stats_.bytesAdvised : stats_.bytesNormal, mapping.length);
+      break;
+  }
+}
+
+HugePageArena::Statistics
+HugePageArena::get_statistics() const
+{
+  std::vector<Mapping> mappings;
+  Statistics stats;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mappings = mappings_;
+    for (auto& startAndMapping : largeMappings_) {
+      mappings.push_back(startAndMapping.second);
+    }
+    mappings.insert(mappings.end(), cachedLargeMappings_.begin(), cachedLargeMappings_.end());
+    stats = stats_;
+  }
+
+  // the kernel reports the transparent huge pages of each mapping as "AnonHugePages" in /proc/self/smaps;
+  // adjacent chunks may have been merged into one mapping, so any overlap with an advised chunk counts
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  uintptr_t rangeStart = 0;
+  uintptr_t rangeEnd = 0;
+  bool rangeIsAdvised = false;
+  while (std::getline(smaps, line)) {
+    unsigned long start = 0;
+    unsigned long end = 0;
+    unsigned long kb = 0;
+    if (std::sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2 && line.find(':') > line.find(' ')) {
+      rangeStart = start;
+      rangeEnd = end;
+      rangeIsAdvised = false;
+      for (auto& mapping : mappings) {
+        if (mapping.advised && mapping.start < rangeEnd && mapping.start + mapping.length > rangeStart) {
+          rangeIsAdvised = true;
+          break;
+        }
+      }
+    } else if (rangeIsAdvised && std::sscanf(line.c_str(), "AnonHugePages: %lu kB", &kb) == 1) {
+      stats.bytesTransparentHuge += kb * 1024;
+    }
+  }
+  if (stats.bytesTransparentHuge > stats.bytesAdvised) {
+    stats.bytesTransparentHuge = stats.bytesAdvised;
+  }
+
+  stats.pageTableEntries += stats.bytesTransparentHuge / CHUNK_SIZE +
+                            (stats.bytesAdvised - stats.bytesTransparentHuge + stats.bytesNormal) / NORMAL_PAGE_SIZE;
+  return stats;
+}
+
+std::ostream&
+operator<<(std::ostream& t, HugePageArena::PageSize pageSize)
+{
+  switch (pageSize) {
+    case HugePageArena::PageSize::kNormal:
+      return t << "none";
+    case HugePageArena::PageSize::k2MB:
+      return t << "2MB";
+    case HugePageArena::PageSize::k1GB:
+      return t << "1GB";
+  }
+  return t;
+}
+
+std::ostream&
+operator<<(std::ostream& t, const HugePageArena::Statistics& stats)
+{
+  constexpr double MB = 1024.0 * 1024.0;
+  return t << stats.chunks << " chunk(s) with huge pages \"" << stats.requestedPageSize << "\" requested: "
+           << stats.bytesIn1GBPages / MB << " MB in 1 GB pages, " << stats.bytesIn2MBPages / MB
+           << " MB in 2 MB pages, " << stats.bytesAdvised / MB << " MB advised for transparent huge pages ("
+           << stats.bytesTransparentHuge / MB << " MB of them backed by huge pages), " << stats.bytesNormal / MB
+           << " MB in normal pages; " << stats.pageTableEntries << " page(s) to cover it all, "
+           << stats.fallbacks << " fallback(s) to a smaller page size; " << stats.largeMappings
+           << " large block(s) of " << stats.largeBytes / MB << " MB mapped on their own, "
+           << stats.largeMappingsCached << " freed one(s) of " << stats.largeBytesCached / MB << " MB kept for reuse, "
+           << stats.largeMappingsReused << " reuse(s)";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,179 @@
+/**
+ * @file HugePageArena.hpp
+ *
+ * HugePageArena hands out 2 MB chunks of memory, and dedicated mappings for
+ * blocks too large for a chunk's slab, that are backed by huge pages whenever
+ * the system allows it, so that the list payloads stored in them need far
+ * fewer TLB entries than with normal 4 kB pages.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_HUGEPAGEARENA_HPP_
+#define AFV1_EXAMPLE_SRC_HUGEPAGEARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief HugePageArena maps memory with mmap and hands it out in CHUNK_SIZE chunks that are
+ * aligned to CHUNK_SIZE (the size of a SlabAllocator slab).
+ *
+ * The arena tries the requested page size first and falls back step by step:
+ *  - 1 GB pages from the hugetlbfs pool (MAP_HUGETLB | MAP_HUGE_1GB), carved into chunks;
+ *  - 2 MB pages from the hugetlbfs pool (MAP_HUGETLB | MAP_HUGE_2MB), one per chunk;
+ *  - normal pages with madvise(MADV_HUGEPAGE), which the kernel may back with transparent huge pages;
+ *  - normal pages, if even madvise() fails.
+ * A step that fails is not retried, so a system without a hugetlbfs pool pays for the failed
+ * mmap once. Chunks are never returned to the system; arenas live until the process exits.
+ *
+ * Blocks larger than a SlabAllocator block each get a mapping of their own, from
+ * allocate_large(), rounded up to whole huge pages and with the same fallbacks (1 GB pages are
+ * only used for blocks of at least 1 GB). A freed mapping is kept for the next block of the same
+ * rounded size, up to MAX_CACHED_LARGE_MAPPINGS of them, since mapping and zeroing huge pages for
+ * every list would cost more than the TLB misses that they save; beyond that, it is unmapped.
+ */
+class HugePageArena
+{
+public:
+  static constexpr size_t CHUNK_SIZE = 2 * 1024 * 1024;
+  static constexpr size_t MAX_CACHED_LARGE_MAPPINGS = 16;
+
+  enum class PageSize
+  {
+    kNormal,
+    k2MB,
+    k1GB
+  };
+
+  struct Statistics
+  {
+    PageSize requestedPageSize = PageSize::kNormal;
+    uint64_t chunks = 0;
+    uint64_t bytesIn1GBPages = 0;    ///< Mapped from the 1 GB hugetlbfs pool (including not yet used chunks)
+    uint64_t bytesIn2MBPages = 0;    ///< Mapped from the 2 MB hugetlbfs pool
+    uint64_t bytesAdvised = 0;       ///< Normal pages for which transparent huge pages were requested
+    uint64_t bytesTransparentHuge = 0; ///< ... of which the kernel currently backs with huge pages
+    uint64_t bytesNormal = 0;        ///< Normal pages for which madvise() failed
+    uint64_t fallbacks = 0;          ///< Number of times a page size could not be used
+    uint64_t pageTableEntries = 0;   ///< Pages (of any size), and so TLB entries, needed to map all of the memory
+    uint64_t largeMappings = 0;      ///< Mappings for large blocks that are in use; their bytes are included above
+    uint64_t largeBytes = 0;
+    uint64_t largeMappingsCached = 0; ///< Mappings for large blocks that were freed and are kept for reuse
+    uint64_t largeBytesCached = 0;
+    uint64_t largeMappingsReused = 0; ///< Large blocks that were served from the cache rather than mapped
+  };
+
+  /**
+   * @brief Returns the arena for the given page size, creating it if necessary
+   */
+  static HugePageArena& get(PageSize pageSize);
+
+  /**
+   * @brief Parses a page size setting ("none", "2MB" or "1GB")
+   * @return false if the text is not a valid setting
+   */
+  static bool parse_page_size(const std::string& text, PageSize& pageSize);
+
+  HugePageArena(const HugePageArena&) = delete;
+  HugePageArena& operator=(const HugePageArena&) = delete;
+
+  PageSize get_page_size() const { return requestedPageSize_; }
+
+  /**
+   * @brief Returns a CHUNK_SIZE chunk of memory aligned to CHUNK_SIZE; throws std::bad_alloc
+   * if no memory can be mapped at all
+   */
+  void* allocate_chunk();
+
+  /**
+   * @brief Returns a mapping of its own for a block of the given size, aligned to CHUNK_SIZE;
+   * throws std::bad_alloc if no memory can be mapped at all
+   */
+  void* allocate_large(size_t bytes);
+
+  /**
+   * @brief Frees a block from allocate_large() of whichever arena handed it out
+   * @return false if no arena handed out the block
+   */
+  static bool deallocate_large(void* block);
+
+  /**
+   * @brief Collects the statistics. This reads /proc/self/smaps to find out how much of the
+   * memory is backed by transparent huge pages, so it should not be called often.
+   */
+  Statistics get_statistics() const;
+
+private:
+  struct Mapping
+  {
+    uintptr_t start;
+    size_t length;
+    bool advised;
+    PageSize pageSize = PageSize::kNormal; ///< Of the hugetlbfs pages, or kNormal for normal pages
+  };
+
+  explicit HugePageArena(PageSize pageSize);
+
+  bool map_1gb_region();
+  void* map_2mb_chunk();
+  void* map_advised_chunk();
+
+  /**
+   * @brief Maps a large block in pages of the given size from the hugetlbfs pool
+   * @return false if the pool could not provide them
+   */
+  bool map_large_hugetlb(size_t length, PageSize pageSize, Mapping& mapping);
+  Mapping map_large_advised(size_t length);
+
+  /**
+   * @brief Adds the mapping to the statistics of the memory that is mapped, or removes it
+   */
+  void count_large_mapping(const Mapping& mapping, bool add);
+
+  /**
+   * @brief Frees the block if this arena handed it out
+   */
+  bool release_large(uintptr_t start);
+
+  const PageSize requestedPageSize_;
+  mutable std::mutex mutex_;
+  bool try1GB_;
+  bool try2MB_;
+  char* regionNext_ = nullptr; ///< Next unused chunk in the current 1 GB region
+  char* regionEnd_ = nullptr;
+  std::vector<Mapping> mappings_;
+  std::map<uintptr_t, Mapping> largeMappings_; ///< Large blocks in use, by start address
+  std::vector<Mapping> cachedLargeMappings_;
+  Statistics stats_;
+};
+
+/**
+ * @brief Format a page size setting to a stream
+ */
+std::ostream&
+operator<<(std::ostream& t, HugePageArena::PageSize pageSize);
+
+/**
+ * @brief Format the statistics of a HugePageArena to a stream
+ * @param t ostream Instance
+ * @param stats Statistics to format
+ * @return ostream Instance
+ */
+std::ostream&
+operator<<(std::ostream& t, const HugePageArena::Statistics& stats);
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_HUGEPAGEARENA_HPP_
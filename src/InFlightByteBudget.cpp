@@ -0,0 +1,94 @@
+/**
+ * @file InFlightByteBudget.cpp InFlightByteBudget class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "InFlightByteBudget.hpp"
+
+namespace dunedaq {
+namespace afv1_example {
+
+void
+InFlightByteBudget::set_limit(size_t limit)
+{
+  limit_.store(limit, std::memory_order_relaxed);
+  // a higher limit may make room for a waiting producer
+  notify_waiters();
+}
+
+bool
+InFlightByteBudget::wait_for_room(size_t bytes, std::chrono::milliseconds timeout, StopSignal* stopSignal)
+{
+  if (has_room(bytes)) {
+    return true;
+  }
+
+  auto startTime = std::chrono::steady_clock::now();
+  bool gotRoom = false;
+  bool stopped = false;
+  {
+    StopSignal::Listener stopListener(stopSignal, mutex_, roomAvailable_);
+    // waiters_ is raised before the condition is checked again, and release() lowers the count
+    // before it looks at waiters_, so a release can not slip in between unnoticed
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    roomAvailable_.wait_for(lock, timeout, [&] {
+      gotRoom = has_room(bytes);
+      stopped = stopSignal != nullptr && stopSignal->stop_requested();
+      return gotRoom || stopped;
+    });
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  waits_.fetch_add(1, std::memory_order_relaxed);
+  if (!gotRoom && !stopped) {
+    timeouts_.fetch_add(1, std::memory_order_relaxed);
+  }
+  waitNanoseconds_.fetch_add(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count(),
+    std::memory_order_relaxed);
+  return gotRoom;
+}
+
+void
+InFlightByteBudget::notify_waiters()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  roomAvailable_.notify_all();
+}
+
+InFlightByteBudget::Statistics
+InFlightByteBudget::get_statistics() const
+{
+  Statistics stats;
+  stats.limit = limit_.load(std::memory_order_relaxed);
+  stats.inFlight = inFlight_.load(std::memory_order_relaxed);
+  stats.highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+  stats.charges = charges_.load(std::memory_order_relaxed);
+  stats.waits = waits_.load(std::memory_order_relaxed);
+  stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+  stats.waitSeconds = static_cast<double>(waitNanoseconds_.load(std::memory_order_relaxed)) / 1e9;
+  return stats;
+}
+
+std::ostream&
+operator<<(std::ostream& t, const InFlightByteBudget::Statistics& stats)
+{
+  constexpr double MB = 1024.0 * 1024.0;
+  t << "limit ";
+  if (stats.limit == 0) {
+    t << "none";
+  } else {
+    t << stats.limit / MB << " MB";
+  }
+  return t << ", " << stats.inFlight / MB << " MB in flight now, at most " << stats.highWaterMark / MB
+           << " MB in flight at once over " << stats.charges << " buffer(s); the producer waited for room "
+           << stats.waits << " time(s) for " << stats.waitSeconds << " s in total (" << stats.timeouts
+           << " of the waits timed out)";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,133 @@
+/**
+ * @file InFlightByteBudget.hpp
+ *
+ * InFlightByteBudget keeps count of the bytes of list data that are in
+ * flight in a pipeline, and makes the producer of the lists wait while the
+ * count is above a configured limit, so that the memory that the pipeline
+ * uses is bounded whatever the sizes of the lists.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_INFLIGHTBYTEBUDGET_HPP_
+#define AFV1_EXAMPLE_SRC_INFLIGHTBYTEBUDGET_HPP_
+
+#include "StopSignal.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief InFlightByteBudget counts the bytes that have been charged to it and not yet released,
+ * and lets a producer wait until there is room for more under the limit.
+ *
+ * Charging and releasing never block, so that the stages in the middle and at the end of a
+ * pipeline, which must keep running for bytes to be released, can not deadlock on the budget;
+ * only the producer at the start of the pipeline waits, with wait_for_room(). A single producer
+ * therefore keeps the bytes in flight within the limit, plus whatever the downstream stages
+ * charge for the lists that are already in flight, and plus the difference when the buffer that
+ * is charged turns out larger than the one that was waited for (e.g. a recycled buffer); several
+ * producers may each overshoot it by one message. Once nothing is in flight, a request is let
+ * through even if it is larger than the limit on its own. A limit of 0 means no limit, in which
+ * case the bytes are only counted.
+ */
+class InFlightByteBudget
+{
+public:
+  struct Statistics
+  {
+    uint64_t limit = 0;         ///< In bytes, or 0 for no limit
+    uint64_t inFlight = 0;      ///< Bytes charged and not yet released
+    uint64_t highWaterMark = 0; ///< Highest number of bytes that were in flight at once
+    uint64_t charges = 0;
+    uint64_t waits = 0;         ///< Calls to wait_for_room() that had to wait
+    uint64_t timeouts = 0;      ///< ... of which timed out before there was room, other than for a stop
+    double waitSeconds = 0;     ///< Total time spent waiting in wait_for_room()
+  };
+
+  InFlightByteBudget() = default;
+
+  InFlightByteBudget(const InFlightByteBudget&) = delete;
+  InFlightByteBudget& operator=(const InFlightByteBudget&) = delete;
+
+  /**
+   * @brief Sets the number of bytes that may be in flight at once, or 0 for no limit
+   */
+  void set_limit(size_t limit);
+  size_t get_limit() const { return limit_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Waits until bytes more can be charged without exceeding the limit, or until the
+   * timeout expires or the stop signal, if any, is raised. Nothing is charged; the caller charges
+   * the bytes when it allocates them.
+   * @return false if the timeout expired or the stop signal was raised first
+   */
+  bool wait_for_room(size_t bytes, std::chrono::milliseconds timeout, StopSignal* stopSignal = nullptr);
+
+  void charge(size_t bytes)
+  {
+    uint64_t inFlight = inFlight_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    charges_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+    while (inFlight > highWaterMark &&
+           !highWaterMark_.compare_exchange_weak(highWaterMark, inFlight, std::memory_order_relaxed)) {
+    }
+  }
+
+  void release(size_t bytes)
+  {
+    inFlight_.fetch_sub(bytes, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+      notify_waiters();
+    }
+  }
+
+  size_t in_flight() const { return inFlight_.load(std::memory_order_relaxed); }
+
+  Statistics get_statistics() const;
+
+private:
+  bool has_room(size_t bytes) const
+  {
+    size_t limit = limit_.load(std::memory_order_relaxed);
+    size_t inFlight = inFlight_.load(std::memory_order_seq_cst);
+    return limit == 0 || inFlight == 0 || inFlight + bytes <= limit;
+  }
+
+  void notify_waiters();
+
+  std::atomic<size_t> limit_{ 0 };
+  alignas(64) std::atomic<uint64_t> inFlight_{ 0 };
+  std::atomic<uint64_t> highWaterMark_{ 0 };
+  std::atomic<uint64_t> charges_{ 0 };
+  alignas(64) std::atomic<uint32_t> waiters_{ 0 };
+  std::atomic<uint64_t> waits_{ 0 };
+  std::atomic<uint64_t> timeouts_{ 0 };
+  std::atomic<uint64_t> waitNanoseconds_{ 0 };
+  std::mutex mutex_;
+  std::condition_variable roomAvailable_;
+};
+
+/**
+ * @brief Format the statistics of an InFlightByteBudget to a stream
+ * @param t ostream Instance
+ * @param stats Statistics to format
+ * @return ostream Instance
+ */
+std::ostream&
+operator<<(std::ostream& t, const InFlightByteBudget::Statistics& stats);
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_INFLIGHTBYTEBUDGET_HPP_
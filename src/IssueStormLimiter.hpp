@@ -0,0 +1,110 @@
+/**
+ * @file IssueStormLimiter.hpp
+ *
+ * IssueStormLimiter keeps track of repeated occurrences of one type of
+ * ERS Issue so that DAQModules can report the first few occurrences in
+ * full and then only report periodic summaries of how many more occurred.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_ISSUESTORMLIMITER_HPP_
+#define AFV1_EXAMPLE_SRC_ISSUESTORMLIMITER_HPP_
+
+#include <chrono>
+#include <cstddef>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief IssueStormLimiter decides which occurrences of an Issue should be reported individually
+ * and when a summary of the suppressed occurrences is due.
+ *
+ * The first firstOccurrencesToReport occurrences are reported in full. After that, occurrences
+ * are only counted, and a summary becomes due once per summaryPeriod while any are pending.
+ * Recording an occurrence costs a counter increment, and checking for a due summary costs
+ * at most one clock read, independent of the rate at which the Issue is occurring.
+ *
+ * An IssueStormLimiter is meant to be used from a single thread (typically a DAQModule's
+ * working thread) and is not thread-safe.
+ */
+class IssueStormLimiter
+{
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  static constexpr size_t DEFAULT_FIRST_OCCURRENCES_TO_REPORT = 5;
+  static constexpr std::chrono::milliseconds DEFAULT_SUMMARY_PERIOD = std::chrono::milliseconds(10000);
+
+  explicit IssueStormLimiter(size_t firstOccurrencesToReport = DEFAULT_FIRST_OCCURRENCES_TO_REPORT,
+                             std::chrono::milliseconds summaryPeriod = DEFAULT_SUMMARY_PERIOD)
+    : firstOccurrencesToReport_(firstOccurrencesToReport)
+    , summaryPeriod_(summaryPeriod)
+    , lastSummaryTime_(clock_t::now())
+  {}
+
+  /**
+   * @brief Counts one occurrence of the Issue
+   * @return true if this occurrence should be reported in full, false if it has been
+   * folded into the next summary
+   */
+  bool record()
+  {
+    ++totalCount_;
+    if (totalCount_ <= firstOccurrencesToReport_) {
+      return true;
+    }
+    ++suppressedCount_;
+    return false;
+  }
+
+  /**
+   * @brief Calls reportSummary(suppressedCount, totalCount) if occurrences have been suppressed
+   * and either the summary period has elapsed or flush is requested, then starts a new summary period
+   * @return true if a summary was reported
+   */
+  template<typename SummaryReporter>
+  bool report_summary_if_due(SummaryReporter&& reportSummary, bool flush = false)
+  {
+    if (suppressedCount_ == 0) {
+      return false;
+    }
+    auto now = clock_t::now();
+    if (!flush && (now - lastSummaryTime_) < summaryPeriod_) {
+      return false;
+    }
+    reportSummary(suppressedCount_, totalCount_);
+    suppressedCount_ = 0;
+    lastSummaryTime_ = now;
+    return true;
+  }
+
+  size_t total_count() const { return totalCount_; }
+  size_t suppressed_count() const { return suppressedCount_; }
+  std::chrono::milliseconds summary_period() const { return summaryPeriod_; }
+
+  /**
+   * @brief Forgets all occurrences, so that the next ones are again reported in full
+   */
+  void reset()
+  {
+    totalCount_ = 0;
+    suppressedCount_ = 0;
+    lastSummaryTime_ = clock_t::now();
+  }
+
+private:
+  size_t firstOccurrencesToReport_;
+  std::chrono::milliseconds summaryPeriod_;
+  clock_t::time_point lastSummaryTime_;
+  size_t totalCount_ = 0;
+  size_t suppressedCount_ = 0;
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_ISSUESTORMLIMITER_HPP_
@@ -0,0 +1,151 @@
+/**
+ * @file LatencyHistogram.hpp
+ *
+ * LatencyHistogram is a fixed-size, log-linear histogram of time intervals
+ * that can be filled from a DAQModule's working thread at constant cost and
+ * queried for percentiles.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LATENCYHISTOGRAM_HPP_
+#define AFV1_EXAMPLE_SRC_LATENCYHISTOGRAM_HPP_
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief LatencyHistogram records intervals with nanosecond resolution into buckets
+ * whose width grows with the magnitude of the interval.
+ *
+ * Each power of two is split into 2^SUB_BUCKET_BITS equal sub-buckets, so the value
+ * reported for a percentile is within 1/2^SUB_BUCKET_BITS (about 6%) of the true value.
+ * Recording a value is a handful of integer operations and does not allocate.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr unsigned SUB_BUCKET_BITS = 4;
+  static constexpr uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+  static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT + (64 - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT;
+
+  void record(std::chrono::nanoseconds latency)
+  {
+    uint64_t value = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+    ++counts_[bucket_index(value)];
+    ++count_;
+    if (value < min_) {
+      min_ = value;
+    }
+    if (value > max_) {
+      max_ = value;
+    }
+  }
+
+  uint64_t count() const { return count_; }
+  std::chrono::nanoseconds min() const { return std::chrono::nanoseconds(count_ > 0 ? min_ : 0); }
+  std::chrono::nanoseconds max() const { return std::chrono::nanoseconds(max_); }
+
+  /**
+   * @brief Returns the upper edge of the bucket that holds the given percentile (0-100),
+   * clamped to the largest recorded value
+   */
+  std::chrono::nanoseconds percentile(double pct) const
+  {
+    if (count_ == 0) {
+      return std::chrono::nanoseconds(0);
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(pct / 100.0 * static_cast<double>(count_)));
+    if (target == 0) {
+      target = 1;
+    }
+    uint64_t cumulative = 0;
+    for (size_t idx = 0; idx < BUCKET_COUNT; ++idx) {
+      cumulative += counts_[idx];
+      if (cumulative >= target) {
+        uint64_t upper = bucket_upper_bound(idx);
+        return std::chrono::nanoseconds(upper < max_ ? upper : max_);
+      }
+    }
+    return max();
+  }
+
+  void merge(const LatencyHistogram& other)
+  {
+    for (size_t idx = 0; idx < BUCKET_COUNT; ++idx) {
+      counts_[idx] += other.counts_[idx];
+    }
+    count_ += other.count_;
+    if (other.min_ < min_) {
+      min_ = other.min_;
+    }
+    if (other.max_ > max_) {
+      max_ = other.max_;
+    }
+  }
+
+  void reset()
+  {
+    counts_.fill(0);
+    count_ = 0;
+    min_ = std::numeric_limits<uint64_t>::max();
+    max_ = 0;
+  }
+
+private:
+  static size_t bucket_index(uint64_t value)
+  {
+    if (value < SUB_BUCKET_COUNT) {
+      return static_cast<size_t>(value);
+    }
+    unsigned magnitude = 63 - static_cast<unsigned>(__builtin_clzll(value));
+    unsigned shift = magnitude - SUB_BUCKET_BITS;
+    uint64_t subBucket = (value >> shift) - SUB_BUCKET_COUNT;
+    return static_cast<size_t>(SUB_BUCKET_COUNT + shift * SUB_BUCKET_COUNT + subBucket);
+  }
+
+  static uint64_t bucket_upper_bound(size_t index)
+  {
+    if (index < SUB_BUCKET_COUNT) {
+      return index;
+    }
+    uint64_t shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+    uint64_t subBucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+    uint64_t upperExclusive = (SUB_BUCKET_COUNT + subBucket + 1) << shift;
+    return upperExclusive == 0 ? std::numeric_limits<uint64_t>::max() : upperExclusive - 1;
+  }
+
+  std::array<uint64_t, BUCKET_COUNT> counts_{};
+  uint64_t count_ = 0;
+  uint64_t min_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_ = 0;
+};
+
+/**
+ * @brief Format the percentiles of a LatencyHistogram, in microseconds, to a stream
+ * @param t ostream Instance
+ * @param hist Histogram to format
+ * @return ostream Instance
+ */
+inline std::ostream&
+operator<<(std::ostream& t, const LatencyHistogram& hist)
+{
+  auto usec = [](std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1000.0; };
+  return t << "n=" << hist.count() << ", min=" << usec(hist.min()) << " us, p50=" << usec(hist.percentile(50.0))
+           << " us, p90=" << usec(hist.percentile(90.0)) << " us, p99=" << usec(hist.percentile(99.0))
+           << " us, p99.9=" << usec(hist.percentile(99.9)) << " us, max=" << usec(hist.max()) << " us";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LATENCYHISTOGRAM_HPP_
@@ -0,0 +1,117 @@
+/**
+ * @file ListBatch.hpp
+ *
+ * ListBatch carries many lists through a queue as a single message, in
+ * columnar form: one contiguous array with the values of all of the lists,
+ * and an array of offsets that marks where each list starts.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTBATCH_HPP_
+#define AFV1_EXAMPLE_SRC_LISTBATCH_HPP_
+
+#include "ListMessage.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ListBatch is a ListMessageHeader plus two shared payloads: the values of all of the
+ * lists in the batch, back to back, and list_count() + 1 offsets into the values.
+ *
+ * A batch moves through the queues, and is reference-counted, sequence-numbered and timestamped,
+ * as a single message, so the per-message cost is shared by all of its lists. The sequence number
+ * counts batches. The checksum covers the lists in their original order; reversing the lists of a
+ * batch leaves the offsets untouched, so a reversed batch shares the offsets of its original.
+ */
+template<typename T>
+struct ListBatch
+{
+  using clock_t = ListMessageHeader::clock_t;
+  using value_type = T;
+  using payload_t = ListPayload<T>;
+  using offsets_t = ListPayload<int>;
+
+  ListMessageHeader header;
+  payload_t payload; ///< The values of all of the lists
+  offsets_t offsets; ///< List i consists of the values from offsets[i] up to offsets[i + 1]
+
+  /**
+   * @brief Creates a batch of listCount lists of listLength elements each, with the values and
+   * offsets in buffers from the given pool. The offsets are filled in; the values are not.
+   */
+  static ListBatch allocate(size_t listCount, size_t listLength, ListBufferPool* pool)
+  {
+    ListBatch batch;
+    batch.payload = payload_t::allocate(listCount * listLength, pool);
+    batch.offsets = offsets_t::allocate(listCount + 1, pool);
+    for (size_t idx = 0; idx <= listCount; ++idx) {
+      batch.offsets[idx] = static_cast<int>(idx * listLength);
+    }
+    return batch;
+  }
+
+  /**
+   * @brief All of the values in the batch
+   */
+  const payload_t& data() const { return payload; }
+
+  size_t list_count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+  size_t list_size(size_t idx) const { return static_cast<size_t>(offsets[idx + 1] - offsets[idx]); }
+  const T* list_data(size_t idx) const { return payload.data() + offsets[idx]; }
+
+  /**
+   * @brief Whether this batch holds the only reference to its values, so that they can be modified
+   */
+  bool payload_is_exclusive() const { return payload.unique(); }
+
+  /**
+   * @brief The number of bytes of memory that the batch keeps alive: itself and the buffers of its
+   * values and offsets
+   */
+  size_t memory_footprint() const
+  {
+    return sizeof(ListBatch) + payload.buffer_footprint() + offsets.buffer_footprint();
+  }
+
+  /**
+   * @brief Computes the checksum of the lists, each visited back-to-front if listsAreReversed is set
+   */
+  uint32_t compute_checksum(bool listsAreReversed = false) const
+  {
+    uint64_t hash = LIST_HASH_INITIAL_VALUE;
+    for (size_t idx = 0; idx < list_count(); ++idx) {
+      hash = hash_list(list_data(idx), list_size(idx), listsAreReversed, hash);
+    }
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+  }
+
+  void set_checksum()
+  {
+    header.checksum = compute_checksum();
+    header.flags |= ListMessageHeader::kHasChecksum;
+  }
+
+  /**
+   * @brief Checks the checksum in the header, if there is one, against the lists
+   * @param listsAreReversed Whether each of the lists holds its elements in reverse order
+   */
+  bool checksum_matches(bool listsAreReversed = false) const
+  {
+    if (!(header.flags & ListMessageHeader::kHasChecksum)) {
+      return true;
+    }
+    return header.checksum == compute_checksum(listsAreReversed);
+  }
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTBATCH_HPP_
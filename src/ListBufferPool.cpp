@@ -0,0 +1,145 @@
+/**
+ * @file ListBufferPool.cpp ListBufferPool class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ListBufferPool.hpp"
+#include "SlabAllocator.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace dunedaq {
+namespace afv1_example {
+
+namespace {
+
+/**
+ * @brief The SlabAllocator that the memory of all ListBufferBlocks comes from
+ */
+SlabAllocator&
+block_allocator()
+{
+  static SlabAllocator& allocator = SlabAllocator::get();
+  return allocator;
+}
+
+} // namespace
+
+ListBufferPool&
+ListBufferPool::get(const std::string& name, size_t freeListCapacity)
+{
+  // pools are never destroyed, since buffers from them may be released at any time until the process exits
+  static std::mutex registryMutex;
+  static auto* registry = new std::map<std::string, std::unique_ptr<ListBufferPool>>();
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto& pool = (*registry)[name];
+  if (pool == nullptr) {
+    pool.reset(new ListBufferPool(name, freeListCapacity));
+  }
+  return *pool;
+}
+
+ListBufferPool::ListBufferPool(const std::string& name, size_t freeListCapacity)
+  : name_(name)
+  , freeList_(freeListCapacity)
+{}
+
+ListBufferPool::~ListBufferPool()
+{
+  ListBufferBlock* block = nullptr;
+  while (freeList_.try_pop(block)) {
+    free_block(block);
+  }
+}
+
+ListBufferBlock*
+ListBufferPool::acquire_block(size_t capacityBytes)
+{
+  acquired_.fetch_add(1, std::memory_order_relaxed);
+  ListBufferBlock* block = nullptr;
+  if (freeList_.try_pop(block)) {
+    if (block->capacityBytes >= capacityBytes) {
+      recycled_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      free_block(block);
+      freed_.fetch_add(1, std::memory_order_relaxed);
+      block = nullptr;
+    }
+  }
+  if (block == nullptr) {
+    block = allocate_block(capacityBytes, this);
+    allocated_.fetch_add(1, std::memory_order_relaxed);
+  }
+  block->refCount.store(1, std::memory_order_relaxed);
+  budget_.charge(sizeof(ListBufferBlock) + block->capacityBytes);
+  return block;
+}
+
+void
+ListBufferPool::release(ListBufferBlock* block)
+{
+  if (block->isPlaced) {
+    placedBlockHandler_(block);
+    return;
+  }
+  budget_.release(sizeof(ListBufferBlock) + block->capacityBytes);
+  if (freeList_.try_push(block)) {
+    returned_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    free_block(block);
+    freed_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+ListBufferPool::Statistics
+ListBufferPool::get_statistics() const
+{
+  Statistics stats;
+  stats.acquired = acquired_.load(std::memory_order_relaxed);
+  stats.recycled = recycled_.load(std::memory_order_relaxed);
+  stats.allocated = allocated_.load(std::memory_order_relaxed);
+  stats.returned = returned_.load(std::memory_order_relaxed);
+  stats.freed = freed_.load(std::memory_order_relaxed);
+  stats.freeListDepth = freeList_.size_approx();
+  return stats;
+}
+
+size_t
+ListBufferPool::block_footprint(size_t capacityBytes)
+{
+  return SlabAllocator::usable_size(sizeof(ListBufferBlock) + capacityBytes);
+}
+
+ListBufferBlock*
+ListBufferPool::allocate_block(size_t capacityBytes, ListBufferPool* pool)
+{
+  // round the block up to its slab size class, and let the elements use all of it
+  size_t blockSize = block_footprint(capacityBytes);
+  void* memory = block_allocator().allocate(blockSize);
+  auto* block = new (memory) ListBufferBlock;
+  block->refCount.store(1, std::memory_order_relaxed);
+  block->capacityBytes = static_cast<uint32_t>(blockSize - sizeof(ListBufferBlock));
+  block->size = 0;
+  block->isPlaced = 0;
+  block->pool = pool;
+  return block;
+}
+
+void
+ListBufferPool::free_block(ListBufferBlock* block)
+{
+  size_t blockSize = sizeof(ListBufferBlock) + block->capacityBytes;
+  block->~ListBufferBlock();
+  block_allocator().deallocate(block, blockSize);
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,346 @@
+/**
+ * @file ListBufferPool.hpp
+ *
+ * ListBuffer is a reference-counted buffer that holds the elements of a
+ * list, and ListBufferPool keeps buffers whose last reference has been
+ * dropped so that they can be handed out again, instead of being freed
+ * and re-allocated for every list.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTBUFFERPOOL_HPP_
+#define AFV1_EXAMPLE_SRC_LISTBUFFERPOOL_HPP_
+
+#include "InFlightByteBudget.hpp"
+#include "ListElement.hpp"
+#include "MPMCRing.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace dunedaq {
+namespace afv1_example {
+
+class ListBufferPool;
+
+/**
+ * @brief ListBufferBlock is the bookkeeping that precedes the elements of a list in memory.
+ * The elements start immediately after the block. Blocks are sized in bytes, so a block that
+ * held a list of one element type can be re-used for a list of another.
+ */
+struct alignas(16) ListBufferBlock
+{
+  std::atomic<uint32_t> refCount;
+  uint32_t capacityBytes; ///< Number of bytes that are available for elements
+  uint32_t size;          ///< Number of elements in use
+  uint32_t isPlaced;      ///< Whether the block is in memory that the pool does not own, see ListBufferPool::place()
+  ListBufferPool* pool;   ///< Pool to return the block to, or nullptr if it is simply freed
+
+  void* elements() { return this + 1; }
+};
+
+/**
+ * @brief ListBuffer is an intrusively reference-counted handle to the elements of a list.
+ *
+ * Copying a ListBuffer shares the elements; when the last handle goes away the block is returned
+ * to the ListBufferPool that it came from (or freed, if it did not come from a pool). Like
+ * std::shared_ptr, a single ListBuffer must not be modified by several threads at once, but
+ * different handles to the same elements may be used and dropped by different threads.
+ * Elements are not constructed or destroyed, so T must be trivially copyable.
+ */
+template<typename T>
+class ListBuffer
+{
+public:
+  static_assert(std::is_trivially_copyable<T>::value, "ListBuffer elements must be trivially copyable");
+  static_assert(alignof(T) <= alignof(ListBufferBlock), "ListBuffer elements must not need more than 16-byte alignment");
+
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  ListBuffer() = default;
+  ListBuffer(const ListBuffer& other) noexcept
+    : block_(other.block_)
+  {
+    if (block_ != nullptr) {
+      block_->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  ListBuffer(ListBuffer&& other) noexcept
+    : block_(std::exchange(other.block_, nullptr))
+  {}
+  ListBuffer& operator=(const ListBuffer& other) noexcept
+  {
+    ListBuffer(other).swap(*this);
+    return *this;
+  }
+  ListBuffer& operator=(ListBuffer&& other) noexcept
+  {
+    ListBuffer(std::move(other)).swap(*this);
+    return *this;
+  }
+  ~ListBuffer() { reset(); }
+
+  /**
+   * @brief Allocates a buffer for size elements, from the given pool if there is one
+   */
+  static ListBuffer allocate(size_t size, ListBufferPool* pool = nullptr);
+
+  void swap(ListBuffer& other) noexcept { std::swap(block_, other.block_); }
+
+  /**
+   * @brief Drops this handle's reference to the elements
+   */
+  void reset() noexcept;
+
+  explicit operator bool() const { return block_ != nullptr; }
+
+  /**
+   * @brief Whether this is the only handle to the elements, so that they can be modified
+   * without affecting any other handle
+   */
+  bool unique() const { return block_ != nullptr && block_->refCount.load(std::memory_order_acquire) == 1; }
+
+  size_t size() const { return block_ != nullptr ? block_->size : 0; }
+  size_t capacity() const { return block_ != nullptr ? block_->capacityBytes / sizeof(T) : 0; }
+  bool empty() const { return size() == 0; }
+
+  /**
+   * @brief Changes the number of elements in use, which must not exceed capacity()
+   */
+  void resize(size_t size) { block_->size = static_cast<uint32_t>(size); }
+
+  T* data() { return block_ != nullptr ? static_cast<T*>(block_->elements()) : nullptr; }
+  const T* data() const { return block_ != nullptr ? static_cast<const T*>(block_->elements()) : nullptr; }
+  T& operator[](size_t idx) { return data()[idx]; }
+  const T& operator[](size_t idx) const { return data()[idx]; }
+  iterator begin() { return data(); }
+  iterator end() { return data() + size(); }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size(); }
+
+  ListBufferPool* pool() const { return block_ != nullptr ? block_->pool : nullptr; }
+
+  /**
+   * @brief The number of bytes of memory that the buffer occupies, bookkeeping included
+   */
+  size_t footprint() const { return block_ != nullptr ? sizeof(ListBufferBlock) + block_->capacityBytes : 0; }
+
+private:
+  explicit ListBuffer(ListBufferBlock* block)
+    : block_(block)
+  {}
+
+  friend class ListBufferPool;
+  ListBufferBlock* block_ = nullptr;
+};
+
+/**
+ * @brief ListBufferPool hands out ListBuffers and takes their blocks back when the last
+ * handle to them is dropped, keeping them on a lock-free free-list for re-use.
+ *
+ * Blocks are typically acquired by one thread (the generator) and released by another
+ * (whichever stage consumes a list last), so the free-list is a bounded MPMCRing. Once the
+ * pipeline has run long enough for the free-list to hold as many blocks as are in flight,
+ * acquiring and releasing buffers no longer allocates or frees memory. Blocks that are
+ * too small for a request, or that do not fit on a full free-list, are freed. The memory of
+ * all blocks comes from the default SlabAllocator, which rounds it up to a power-of-two size
+ * class, so a freed block can be re-used for any list of a similar size.
+ *
+ * Pools are looked up by name with get(), so that the modules of a process share them;
+ * they live until the process exits.
+ *
+ * Every buffer that a pool hands out is charged to the pool's InFlightByteBudget, at the size
+ * of the block that holds it, and released from it when the last handle is dropped, so the
+ * budget sees all of the list data that is in flight between the modules that share the pool.
+ * Blocks on the free-list are not in flight; their number is bounded by the free-list capacity.
+ *
+ * A pool can also place blocks in memory that something else owns, such as a slot of a
+ * SharedMemoryRing. Those are not charged to the budget, and when their last handle is dropped
+ * they are handed to the pool's placed-block handler instead of being kept.
+ */
+class ListBufferPool
+{
+public:
+  static constexpr size_t DEFAULT_FREE_LIST_CAPACITY = 1024;
+
+  struct Statistics
+  {
+    uint64_t acquired = 0;    ///< Buffers handed out
+    uint64_t recycled = 0;    ///< ... of which were taken from the free-list
+    uint64_t allocated = 0;   ///< Blocks newly allocated
+    uint64_t returned = 0;    ///< Blocks put back on the free-list
+    uint64_t freed = 0;       ///< Blocks freed because they were too small or the free-list was full
+    uint64_t freeListDepth = 0;
+  };
+
+  /**
+   * @brief Returns the pool with the given name, creating it if necessary. The free-list
+   * capacity is only used when the pool is created.
+   */
+  static ListBufferPool& get(const std::string& name, size_t freeListCapacity = DEFAULT_FREE_LIST_CAPACITY);
+
+  ListBufferPool(const std::string& name, size_t freeListCapacity);
+  ~ListBufferPool();
+
+  ListBufferPool(const ListBufferPool&) = delete;
+  ListBufferPool& operator=(const ListBufferPool&) = delete;
+
+  const std::string& get_name() const { return name_; }
+
+  /**
+   * @brief The budget that the bytes of the buffers in use are charged to
+   */
+  InFlightByteBudget& get_budget() { return budget_; }
+
+  /**
+   * @brief Returns the number of bytes that a buffer for size elements of type T is charged
+   * with, if it is newly allocated
+   */
+  template<typename T>
+  static size_t footprint(size_t size)
+  {
+    return block_footprint(size * sizeof(T));
+  }
+
+  /**
+   * @brief Returns a buffer with room for (at least) size elements and with size() == size
+   */
+  template<typename T>
+  ListBuffer<T> acquire(size_t size)
+  {
+    ListBufferBlock* block = acquire_block(size * sizeof(T));
+    block->size = static_cast<uint32_t>(size);
+    return ListBuffer<T>(block);
+  }
+
+  /**
+   * @brief Returns a buffer for size elements whose block is placed at memory, which must be aligned
+   * like a ListBufferBlock and have room for the block and capacityBytes bytes of elements
+   */
+  template<typename T>
+  ListBuffer<T> place(void* memory, size_t size, size_t capacityBytes)
+  {
+    auto* block = new (memory) ListBufferBlock;
+    block->refCount.store(1, std::memory_order_relaxed);
+    block->capacityBytes = static_cast<uint32_t>(capacityBytes);
+    block->size = static_cast<uint32_t>(size);
+    block->isPlaced = 1;
+    block->pool = this;
+    return ListBuffer<T>(block);
+  }
+
+  /**
+   * @brief Sets what is done with a block that place() put in memory of its own when its last
+   * handle is dropped; it must be set before the first block is placed
+   */
+  void set_placed_block_handler(std::function<void(ListBufferBlock*)> handler)
+  {
+    placedBlockHandler_ = std::move(handler);
+  }
+
+  Statistics get_statistics() const;
+
+private:
+  template<typename T>
+  friend class ListBuffer;
+  ListBufferBlock* acquire_block(size_t capacityBytes);
+  static size_t block_footprint(size_t capacityBytes);
+  static ListBufferBlock* allocate_block(size_t capacityBytes, ListBufferPool* pool);
+  static void free_block(ListBufferBlock* block);
+  void release(ListBufferBlock* block);
+
+  std::string name_;
+  MPMCRing<ListBufferBlock*> freeList_;
+  InFlightByteBudget budget_;
+  std::function<void(ListBufferBlock*)> placedBlockHandler_;
+
+  // counters updated by acquiring threads and by releasing threads are kept on separate cache lines
+  alignas(64) std::atomic<uint64_t> acquired_{ 0 };
+  std::atomic<uint64_t> recycled_{ 0 };
+  std::atomic<uint64_t> allocated_{ 0 };
+  alignas(64) std::atomic<uint64_t> returned_{ 0 };
+  std::atomic<uint64_t> freed_{ 0 };
+};
+
+template<typename T>
+inline void
+ListBuffer<T>::reset() noexcept
+{
+  if (block_ != nullptr) {
+    if (block_->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      if (block_->pool != nullptr) {
+        block_->pool->release(block_);
+      } else {
+        ListBufferPool::free_block(block_);
+      }
+    }
+    block_ = nullptr;
+  }
+}
+
+template<typename T>
+inline ListBuffer<T>
+ListBuffer<T>::allocate(size_t size, ListBufferPool* pool)
+{
+  if (pool != nullptr) {
+    return pool->acquire<T>(size);
+  }
+  ListBufferBlock* block = ListBufferPool::allocate_block(size * sizeof(T), nullptr);
+  block->size = static_cast<uint32_t>(size);
+  return ListBuffer(block);
+}
+
+/**
+ * @brief Format the first few elements of a ListBuffer to a stream, as a list may be far too long to
+ * format whole
+ * @param t ostream Instance
+ * @param buffer Buffer to format
+ * @return ostream Instance
+ */
+template<typename T>
+inline std::ostream&
+operator<<(std::ostream& t, const ListBuffer<T>& buffer)
+{
+  constexpr size_t BUFFER_ELEMENTS_TO_FORMAT = 16;
+  t << "{";
+  size_t count = 0;
+  for (auto iter = buffer.begin(); iter != buffer.end() && count < BUFFER_ELEMENTS_TO_FORMAT; ++iter, ++count) {
+    if (count > 0)
+      t << ", ";
+    format_list_element(t, *iter);
+  }
+  if (buffer.size() > count)
+    t << ", ...";
+  return t << "}";
+}
+
+/**
+ * @brief Format the statistics of a ListBufferPool to a stream
+ * @param t ostream Instance
+ * @param stats Statistics to format
+ * @return ostream Instance
+ */
+inline std::ostream&
+operator<<(std::ostream& t, const ListBufferPool::Statistics& stats)
+{
+  return t << stats.acquired << " buffers acquired (" << stats.recycled << " recycled, " << stats.allocated
+           << " newly allocated), " << stats.returned << " returned to the free-list, " << stats.freed
+           << " freed, " << stats.freeListDepth << " on the free-list";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTBUFFERPOOL_HPP_
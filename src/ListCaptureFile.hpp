@@ -0,0 +1,226 @@
+/**
+ * @file ListCaptureFile.hpp
+ *
+ * ListCaptureFile defines the on-disk format that is used to record a
+ * stream of lists, along with a writer that appends lists to a capture
+ * file and a memory-mapped reader that indexes an existing one.
+ *
+ * A capture file starts with a ListCaptureFileHeader, followed by one
+ * record per list: a ListCaptureRecordHeader and then the elements of
+ * the list. All values are stored in the byte order of the host that
+ * wrote the file, and every record starts on an 8-byte boundary.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTCAPTUREFILE_HPP_
+#define AFV1_EXAMPLE_SRC_LISTCAPTUREFILE_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+struct ListCaptureFileHeader
+{
+  static constexpr char MAGIC[8] = { 'A', 'F', 'V', '1', 'L', 'S', 'T', '\0' };
+  static constexpr uint32_t CURRENT_VERSION = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t elementSize; ///< sizeof() of one list element, in bytes
+};
+
+struct ListCaptureRecordHeader
+{
+  uint32_t streamId;
+  uint32_t length; ///< Number of elements that follow the header
+  uint64_t sequenceNumber;
+};
+
+static_assert(sizeof(ListCaptureFileHeader) == 16, "ListCaptureFileHeader must be 16 bytes");
+static_assert(sizeof(ListCaptureRecordHeader) == 16, "ListCaptureRecordHeader must be 16 bytes");
+
+/**
+ * @brief Number of bytes that a record with the given number of elements occupies in a capture file
+ */
+inline size_t
+capture_record_size(size_t length, size_t elementSize)
+{
+  size_t size = sizeof(ListCaptureRecordHeader) + length * elementSize;
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+/**
+ * @brief ListCaptureWriter appends lists to a capture file using buffered stdio
+ */
+class ListCaptureWriter
+{
+public:
+  ListCaptureWriter(const std::string& fileName, uint32_t elementSize)
+    : fileName_(fileName)
+    , elementSize_(elementSize)
+    , file_(std::fopen(fileName.c_str(), "wb"))
+  {
+    if (file_ == nullptr) {
+      throw std::runtime_error("Unable to open capture file " + fileName_ + " for writing: " + std::strerror(errno));
+    }
+    ListCaptureFileHeader header;
+    std::memcpy(header.magic, ListCaptureFileHeader::MAGIC, sizeof(header.magic));
+    header.version = ListCaptureFileHeader::CURRENT_VERSION;
+    header.elementSize = elementSize_;
+    write_bytes(&header, sizeof(header));
+  }
+
+  ~ListCaptureWriter()
+  {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  ListCaptureWriter(const ListCaptureWriter&) = delete;
+  ListCaptureWriter& operator=(const ListCaptureWriter&) = delete;
+
+  void write(uint32_t streamId, uint64_t sequenceNumber, const void* elements, size_t length)
+  {
+    ListCaptureRecordHeader header{ streamId, static_cast<uint32_t>(length), sequenceNumber };
+    write_bytes(&header, sizeof(header));
+    write_bytes(elements, length * elementSize_);
+    static const char padding[8] = {};
+    size_t payloadSize = sizeof(header) + length * elementSize_;
+    write_bytes(padding, capture_record_size(length, elementSize_) - payloadSize);
+  }
+
+  void flush() { std::fflush(file_); }
+
+private:
+  void write_bytes(const void* bytes, size_t count)
+  {
+    if (count > 0 && std::fwrite(bytes, 1, count, file_) != count) {
+      throw std::runtime_error("Unable to write to capture file " + fileName_ + ": " + std::strerror(errno));
+    }
+  }
+
+  std::string fileName_;
+  uint32_t elementSize_;
+  FILE* file_;
+};
+
+/**
+ * @brief ListCaptureReader memory-maps a capture file and builds an index of its records,
+ * so that records can be accessed in any order (and from several threads) without copying
+ */
+class ListCaptureReader
+{
+public:
+  struct Record
+  {
+    const ListCaptureRecordHeader* header;
+    const void* elements;
+  };
+
+  explicit ListCaptureReader(const std::string& fileName)
+    : fileName_(fileName)
+  {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Unable to open capture file " + fileName_ + ": " + std::strerror(errno));
+    }
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Unable to stat capture file " + fileName_ + ": " + std::strerror(errno));
+    }
+    size_ = static_cast<size_t>(fileStat.st_size);
+    if (size_ < sizeof(ListCaptureFileHeader)) {
+      ::close(fd);
+      throw std::runtime_error("Capture file " + fileName_ + " is too short to hold a file header");
+    }
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Unable to map capture file " + fileName_ + ": " + std::strerror(errno));
+    }
+    base_ = static_cast<const char*>(mapping);
+    ::madvise(mapping, size_, MADV_WILLNEED);
+
+    const auto* fileHeader = reinterpret_cast<const ListCaptureFileHeader*>(base_);
+    if (std::memcmp(fileHeader->magic, ListCaptureFileHeader::MAGIC, sizeof(fileHeader->magic)) != 0 ||
+        fileHeader->version != ListCaptureFileHeader::CURRENT_VERSION) {
+      unmap();
+      throw std::runtime_error("File " + fileName_ + " is not a version " +
+                               std::to_string(ListCaptureFileHeader::CURRENT_VERSION) + " list capture file");
+    }
+    elementSize_ = fileHeader->elementSize;
+    try {
+      build_index();
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+
+  ~ListCaptureReader() { unmap(); }
+
+  ListCaptureReader(const ListCaptureReader&) = delete;
+  ListCaptureReader& operator=(const ListCaptureReader&) = delete;
+
+  size_t record_count() const { return offsets_.size(); }
+  uint32_t element_size() const { return elementSize_; }
+  size_t file_size() const { return size_; }
+
+  Record record(size_t index) const
+  {
+    const char* ptr = base_ + offsets_[index];
+    return Record{ reinterpret_cast<const ListCaptureRecordHeader*>(ptr), ptr + sizeof(ListCaptureRecordHeader) };
+  }
+
+private:
+  void build_index()
+  {
+    size_t offset = sizeof(ListCaptureFileHeader);
+    while (offset + sizeof(ListCaptureRecordHeader) <= size_) {
+      const auto* header = reinterpret_cast<const ListCaptureRecordHeader*>(base_ + offset);
+      size_t recordSize = capture_record_size(header->length, elementSize_);
+      if (offset + sizeof(ListCaptureRecordHeader) + header->length * static_cast<size_t>(elementSize_) > size_) {
+        throw std::runtime_error("Capture file " + fileName_ + " ends in the middle of record " +
+                                 std::to_string(offsets_.size()));
+      }
+      offsets_.push_back(offset);
+      offset += recordSize;
+    }
+  }
+
+  void unmap()
+  {
+    if (base_ != nullptr) {
+      ::munmap(const_cast<char*>(base_), size_);
+      base_ = nullptr;
+    }
+  }
+
+  std::string fileName_;
+  const char* base_ = nullptr;
+  size_t size_ = 0;
+  uint32_t elementSize_ = 0;
+  std::vector<size_t> offsets_;
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTCAPTUREFILE_HPP_
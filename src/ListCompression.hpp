@@ -0,0 +1,594 @@
+/**
+ * @file ListCompression.hpp
+ *
+ * ListCompression contains the integer codecs that shrink list messages
+ * before they leave the process: frame-of-reference bit-packing, delta
+ * coding and plain varints, together with the statistics that show how
+ * well they work on each stream.
+ *
+ * The codecs work on words of the width of the list elements. Bit-packing
+ * lays each whole block of 16-bit or 32-bit words out in the lanes of
+ * 16-byte vectors, so that SSE2 packs and unpacks a vector of words with one
+ * shift for all lanes; 64-bit words, the partial block at the end of a list
+ * and the varints of the other codecs are handled one word at a time.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTCOMPRESSION_HPP_
+#define AFV1_EXAMPLE_SRC_LISTCOMPRESSION_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief The ways in which the elements of a list message can be compressed
+ */
+enum class ListCompression : uint8_t
+{
+  kNone = 0,
+  kBitPacking = 1, ///< Each block of words as the differences from its smallest, in as few bits as the largest needs
+  kDelta = 2,      ///< The differences between neighbouring words, zigzag-encoded, as varints
+  kVarint = 3      ///< Each word as a varint
+};
+
+/**
+ * @brief Reads a compression from its name in a configuration: "none", "bitpacking", "delta" or
+ * "varint"; throws std::invalid_argument for any other name
+ */
+inline ListCompression
+parse_list_compression(const std::string& name)
+{
+  if (name == "none") {
+    return ListCompression::kNone;
+  }
+  if (name == "bitpacking") {
+    return ListCompression::kBitPacking;
+  }
+  if (name == "delta") {
+    return ListCompression::kDelta;
+  }
+  if (name == "varint") {
+    return ListCompression::kVarint;
+  }
+  throw std::invalid_argument("Unknown compression \"" + name +
+                              "\"; the choices are \"none\", \"bitpacking\", \"delta\" and \"varint\"");
+}
+
+inline const char*
+list_compression_name(ListCompression compression)
+{
+  switch (compression) {
+    case ListCompression::kBitPacking:
+      return "bitpacking";
+    case ListCompression::kDelta:
+      return "delta";
+    case ListCompression::kVarint:
+      return "varint";
+    default:
+      return "none";
+  }
+}
+
+/**
+ * @brief The unsigned word that elements of type T are compressed as: the element itself for
+ * integers, and 32-bit pieces of it for anything else, such as a ChannelSample
+ */
+template<typename T, bool = std::is_integral<T>::value>
+struct list_compression_word
+{
+  using type = std::make_unsigned_t<T>;
+};
+
+template<typename T>
+struct list_compression_word<T, false>
+{
+  using type = uint32_t;
+};
+
+namespace compression_detail {
+
+constexpr size_t BLOCK_WORDS = 128; ///< The words that share a reference and a bit width in bit-packing
+
+template<typename W>
+inline unsigned
+bit_width(W value)
+{
+  unsigned bits = 0;
+  for (uint64_t rest = value; rest != 0; rest >>= 1) {
+    ++bits;
+  }
+  return bits;
+}
+
+/**
+ * @brief Maps words whose two's-complement value is small in magnitude, e.g. the difference
+ * between neighbouring elements, to small unsigned words
+ */
+template<typename W>
+inline W
+zigzag(W value)
+{
+  using S = std::make_signed_t<W>;
+  return static_cast<W>(value << 1) ^ static_cast<W>(static_cast<S>(value) >> (8 * sizeof(W) - 1));
+}
+
+template<typename W>
+inline W
+unzigzag(W value)
+{
+  return static_cast<W>(value >> 1) ^ static_cast<W>(-static_cast<W>(value & 1));
+}
+
+inline void
+append_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * @brief Reads a varint that fits in a W
+ * @return false if the bytes run out first, or the value is too large
+ */
+template<typename W>
+inline bool
+read_varint(const uint8_t*& in, const uint8_t* end, W& value)
+{
+  uint64_t result = 0;
+  for (unsigned shift = 0; shift < 64 && in != end; shift += 7) {
+    uint8_t byte = *in++;
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      value = static_cast<W>(result);
+      return result <= std::numeric_limits<W>::max();
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Whether a block of count words of type W is packed in lanes: only whole blocks of 16-bit
+ * and 32-bit words are; 64-bit words and the partial block at the end of a list are packed one
+ * word after another
+ */
+template<typename W>
+constexpr bool
+packs_in_lanes(size_t count)
+{
+  return (sizeof(W) == 2 || sizeof(W) == 4) && count == BLOCK_WORDS;
+}
+
+/**
+ * @brief Packs the offsets of a whole block in lanes, one word at a time: word i goes to lane
+ * i % LANES of the 16-byte vectors, as that lane's (i / LANES)th value, and each lane's values are
+ * packed from the lowest bit up. The block takes exactly bits vectors. This is the reference that
+ * the SSE2 kernel must match, and the packing where SSE2 is missing.
+ */
+template<typename W>
+inline void
+pack_lanes_scalar(const W* offsets, unsigned bits, uint8_t* packed)
+{
+  static_assert(sizeof(W) == 2 || sizeof(W) == 4, "Only 16-bit and 32-bit words are packed in lanes");
+  constexpr size_t LANES = 16 / sizeof(W);
+  constexpr unsigned LANE_BITS = 8 * sizeof(W);
+  for (size_t lane = 0; lane < LANES; ++lane) {
+    uint64_t accumulator = 0;
+    unsigned filled = 0;
+    size_t vector = 0;
+    for (size_t idx = lane; idx < BLOCK_WORDS; idx += LANES) {
+      accumulator |= static_cast<uint64_t>(offsets[idx]) << filled;
+      filled += bits;
+      if (filled >= LANE_BITS) {
+        W laneWord = static_cast<W>(accumulator);
+        std::memcpy(packed + vector * 16 + lane * sizeof(W), &laneWord, sizeof(W));
+        ++vector;
+        accumulator >>= LANE_BITS;
+        filled -= LANE_BITS;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Reads back a whole block that pack_lanes_scalar() wrote, adding the reference to each
+ * offset
+ */
+template<typename W>
+inline void
+unpack_lanes_scalar(const uint8_t* packed, unsigned bits, W reference, W* out)
+{
+  static_assert(sizeof(W) == 2 || sizeof(W) == 4, "Only 16-bit and 32-bit words are packed in lanes");
+  constexpr size_t LANES = 16 / sizeof(W);
+  constexpr unsigned LANE_BITS = 8 * sizeof(W);
+  uint64_t mask = (uint64_t(1) << bits) - 1;
+  for (size_t lane = 0; lane < LANES; ++lane) {
+    uint64_t accumulator = 0;
+    unsigned available = 0;
+    size_t vector = 0;
+    for (size_t idx = lane; idx < BLOCK_WORDS; idx += LANES) {
+      if (available < bits) {
+        W laneWord;
+        std::memcpy(&laneWord, packed + vector * 16 + lane * sizeof(W), sizeof(W));
+        ++vector;
+        accumulator |= static_cast<uint64_t>(laneWord) << available;
+        available += LANE_BITS;
+      }
+      out[idx] = static_cast<W>(reference + (accumulator & mask));
+      accumulator >>= bits;
+      available -= bits;
+    }
+  }
+}
+
+#if defined(__SSE2__)
+template<typename W>
+inline __m128i
+shift_lanes_left(__m128i v, unsigned count)
+{
+  return sizeof(W) == 2 ? _mm_sll_epi16(v, _mm_cvtsi32_si128(static_cast<int>(count)))
+                        : _mm_sll_epi32(v, _mm_cvtsi32_si128(static_cast<int>(count)));
+}
+
+template<typename W>
+inline __m128i
+shift_lanes_right(__m128i v, unsigned count)
+{
+  return sizeof(W) == 2 ? _mm_srl_epi16(v, _mm_cvtsi32_si128(static_cast<int>(count)))
+                        : _mm_srl_epi32(v, _mm_cvtsi32_si128(static_cast<int>(count)));
+}
+
+/**
+ * @brief Packs the offsets of a whole block in the layout of pack_lanes_scalar(), a vector of
+ * LANES values at a time. Every lane is shifted by the same count, so the shift counts are held in
+ * a register rather than taken as immediates; counts of the lane width or more give zero.
+ */
+template<typename W>
+inline void
+pack_lanes_sse2(const W* offsets, unsigned bits, uint8_t* packed)
+{
+  constexpr size_t LANES = 16 / sizeof(W);
+  constexpr unsigned LANE_BITS = 8 * sizeof(W);
+  __m128i accumulator = _mm_setzero_si128();
+  unsigned filled = 0;
+  for (size_t idx = 0; idx < BLOCK_WORDS; idx += LANES) {
+    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(offsets + idx));
+    accumulator = _mm_or_si128(accumulator, shift_lanes_left<W>(value, filled));
+    filled += bits;
+    if (filled >= LANE_BITS) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(packed), accumulator);
+      packed += 16;
+      filled -= LANE_BITS;
+      accumulator = shift_lanes_right<W>(value, bits - filled);
+    }
+  }
+}
+
+/**
+ * @brief Reads back a whole block in the layout of pack_lanes_scalar(), a vector of LANES values
+ * at a time, adding the reference to each offset
+ */
+template<typename W>
+inline void
+unpack_lanes_sse2(const uint8_t* packed, unsigned bits, W reference, W* out)
+{
+  constexpr size_t LANES = 16 / sizeof(W);
+  constexpr unsigned LANE_BITS = 8 * sizeof(W);
+  const __m128i mask = sizeof(W) == 2 ? _mm_set1_epi16(static_cast<short>((uint32_t(1) << bits) - 1))
+                                      : _mm_set1_epi32(static_cast<int>((uint64_t(1) << bits) - 1));
+  const __m128i base = sizeof(W) == 2 ? _mm_set1_epi16(static_cast<short>(reference))
+                                      : _mm_set1_epi32(static_cast<int>(reference));
+  const uint8_t* end = packed + 16 * bits;
+  __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed));
+  unsigned used = 0;
+  for (size_t idx = 0; idx < BLOCK_WORDS; idx += LANES) {
+    __m128i value = shift_lanes_right<W>(current, used);
+    used += bits;
+    if (used >= LANE_BITS) {
+      packed += 16;
+      current = packed < end ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed)) : _mm_setzero_si128();
+      used -= LANE_BITS;
+      value = _mm_or_si128(value, shift_lanes_left<W>(current, bits - used));
+    }
+    value = _mm_and_si128(value, mask);
+    value = sizeof(W) == 2 ? _mm_add_epi16(value, base) : _mm_add_epi32(value, base);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx), value);
+  }
+}
+#endif
+
+/**
+ * @brief Appends a block of up to BLOCK_WORDS words as its bit width, its smallest word and the
+ * differences from it. A whole block of 16-bit or 32-bit words is packed in lanes, with SSE2 where
+ * it is available; any other block is packed one word after another from the lowest bit up.
+ */
+template<typename W>
+inline void
+pack_block(const W* in, size_t count, std::vector<uint8_t>& out)
+{
+  W reference = in[0];
+  W largest = in[0];
+  for (size_t idx = 1; idx < count; ++idx) {
+    reference = std::min(reference, in[idx]);
+    largest = std::max(largest, in[idx]);
+  }
+  W offsets[BLOCK_WORDS];
+  for (size_t idx = 0; idx < count; ++idx) {
+    offsets[idx] = in[idx] - reference;
+  }
+  unsigned bits = bit_width(static_cast<W>(largest - reference));
+  out.push_back(static_cast<uint8_t>(bits));
+  size_t start = out.size();
+  size_t packedBytes = (count * bits + 7) / 8;
+  // room for the reference, and for the last 64-bit store to overrun the packed bits
+  out.resize(start + sizeof(W) + packedBytes + sizeof(uint64_t));
+  std::memcpy(out.data() + start, &reference, sizeof(W));
+  uint8_t* packed = out.data() + start + sizeof(W);
+  if constexpr (sizeof(W) == 2 || sizeof(W) == 4) {
+    if (packs_in_lanes<W>(count)) {
+#if defined(__SSE2__)
+      pack_lanes_sse2(offsets, bits, packed);
+#else
+      pack_lanes_scalar(offsets, bits, packed);
+#endif
+      out.resize(start + sizeof(W) + packedBytes);
+      return;
+    }
+  }
+  uint64_t accumulator = 0;
+  unsigned filled = 0;
+  for (size_t idx = 0; bits > 0 && idx < count; ++idx) {
+    uint64_t value = offsets[idx];
+    accumulator |= value << filled;
+    filled += bits;
+    if (filled >= 64) {
+      std::memcpy(packed, &accumulator, sizeof(accumulator));
+      packed += sizeof(accumulator);
+      filled -= 64;
+      accumulator = filled > 0 ? value >> (bits - filled) : 0;
+    }
+  }
+  if (filled > 0) {
+    std::memcpy(packed, &accumulator, sizeof(accumulator));
+  }
+  out.resize(start + sizeof(W) + packedBytes);
+}
+
+/**
+ * @brief Reads back a block of count words that pack_block() wrote, in the same layout
+ * @return false if the bytes run out, or the bit width is wider than a word
+ */
+template<typename W>
+inline bool
+unpack_block(const uint8_t*& in, const uint8_t* end, W* out, size_t count)
+{
+  if (end - in < static_cast<ptrdiff_t>(1 + sizeof(W))) {
+    return false;
+  }
+  unsigned bits = *in++;
+  W reference;
+  std::memcpy(&reference, in, sizeof(W));
+  in += sizeof(W);
+  size_t packedBytes = (count * bits + 7) / 8;
+  if (bits > 8 * sizeof(W) || static_cast<size_t>(end - in) < packedBytes) {
+    return false;
+  }
+  if constexpr (sizeof(W) == 2 || sizeof(W) == 4) {
+    if (packs_in_lanes<W>(count) && bits > 0) {
+#if defined(__SSE2__)
+      unpack_lanes_sse2(in, bits, reference, out);
+#else
+      unpack_lanes_scalar(in, bits, reference, out);
+#endif
+      in += packedBytes;
+      return true;
+    }
+  }
+  auto load = [&](size_t word) {
+    uint64_t value = 0;
+    if (word * sizeof(uint64_t) < packedBytes) {
+      std::memcpy(&value, in + word * sizeof(uint64_t), std::min(sizeof(uint64_t), packedBytes - word * sizeof(uint64_t)));
+    }
+    return value;
+  };
+  uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+  W offsets[BLOCK_WORDS] = {};
+  uint64_t current = load(0);
+  size_t word = 0;
+  unsigned used = 0;
+  for (size_t idx = 0; bits > 0 && idx < count; ++idx) {
+    uint64_t value = current >> used;
+    if (used + bits >= 64) {
+      uint64_t next = load(++word);
+      unsigned taken = 64 - used;
+      if (bits > taken) {
+        value |= next << taken;
+      }
+      current = next;
+      used = used + bits - 64;
+    } else {
+      used += bits;
+    }
+    offsets[idx] = static_cast<W>(value & mask);
+  }
+  for (size_t idx = 0; idx < count; ++idx) {
+    out[idx] = static_cast<W>(reference + offsets[idx]);
+  }
+  in += packedBytes;
+  return true;
+}
+
+} // namespace compression_detail
+
+/**
+ * @brief Appends the compressed form of count words to out
+ */
+template<typename W>
+void
+compress_words(const W* in, size_t count, ListCompression compression, std::vector<uint8_t>& out)
+{
+  static_assert(std::is_unsigned<W>::value, "Words are compressed as unsigned integers");
+  using namespace compression_detail;
+  switch (compression) {
+    case ListCompression::kBitPacking:
+      for (size_t done = 0; done < count; done += BLOCK_WORDS) {
+        pack_block(in + done, std::min(BLOCK_WORDS, count - done), out);
+      }
+      break;
+    case ListCompression::kDelta: {
+      W previous = 0;
+      W deltas[BLOCK_WORDS];
+      for (size_t done = 0; done < count; done += BLOCK_WORDS) {
+        size_t blockCount = std::min(BLOCK_WORDS, count - done);
+        for (size_t idx = 0; idx < blockCount; ++idx) {
+          deltas[idx] = zigzag(static_cast<W>(in[done + idx] - (idx == 0 ? previous : in[done + idx - 1])));
+        }
+        previous = in[done + blockCount - 1];
+        for (size_t idx = 0; idx < blockCount; ++idx) {
+          append_varint(out, deltas[idx]);
+        }
+      }
+      break;
+    }
+    case ListCompression::kVarint:
+      for (size_t idx = 0; idx < count; ++idx) {
+        append_varint(out, in[idx]);
+      }
+      break;
+    default:
+      out.insert(out.end(), reinterpret_cast<const uint8_t*>(in), reinterpret_cast<const uint8_t*>(in + count));
+      break;
+  }
+}
+
+/**
+ * @brief Reads count words back from exactly the given bytes
+ * @return false if the bytes are not count words compressed that way
+ */
+template<typename W>
+bool
+decompress_words(const uint8_t* in, size_t bytes, ListCompression compression, W* out, size_t count)
+{
+  static_assert(std::is_unsigned<W>::value, "Words are compressed as unsigned integers");
+  using namespace compression_detail;
+  const uint8_t* end = in + bytes;
+  switch (compression) {
+    case ListCompression::kBitPacking:
+      for (size_t done = 0; done < count; done += BLOCK_WORDS) {
+        if (!unpack_block(in, end, out + done, std::min(BLOCK_WORDS, count - done))) {
+          return false;
+        }
+      }
+      break;
+    case ListCompression::kDelta: {
+      W previous = 0;
+      for (size_t idx = 0; idx < count; ++idx) {
+        W delta;
+        if (!read_varint(in, end, delta)) {
+          return false;
+        }
+        previous = static_cast<W>(previous + unzigzag(delta));
+        out[idx] = previous;
+      }
+      break;
+    }
+    case ListCompression::kVarint:
+      for (size_t idx = 0; idx < count; ++idx) {
+        if (!read_varint(in, end, out[idx])) {
+          return false;
+        }
+      }
+      break;
+    case ListCompression::kNone:
+      if (bytes != count * sizeof(W)) {
+        return false;
+      }
+      std::memcpy(out, in, bytes);
+      in = end;
+      break;
+    default:
+      return false;
+  }
+  return in == end;
+}
+
+/**
+ * @brief The most words that the given number of compressed bytes can hold, in any of the
+ * compressions; a larger word count in a frame is taken for corrupt data
+ */
+inline size_t
+max_decompressed_words(size_t bytes)
+{
+  return bytes * compression_detail::BLOCK_WORDS;
+}
+
+/**
+ * @brief ListCompressionStats counts the bytes of the messages of each stream before and after
+ * they were compressed
+ */
+class ListCompressionStats
+{
+public:
+  void record(uint32_t streamId, size_t rawBytes, size_t encodedBytes)
+  {
+    Stream& stream = streams_[streamId];
+    ++stream.messageCount;
+    stream.rawBytes += rawBytes;
+    stream.encodedBytes += encodedBytes;
+  }
+
+  bool empty() const { return streams_.empty(); }
+
+  friend std::ostream& operator<<(std::ostream& t, const ListCompressionStats& stats)
+  {
+    const char* separator = "";
+    auto flags = t.flags();
+    auto precision = t.precision();
+    for (auto& entry : stats.streams_) {
+      const Stream& stream = entry.second;
+      t << separator << "stream " << entry.first << ": " << stream.messageCount << " message(s), " << stream.rawBytes
+        << " bytes encoded as " << stream.encodedBytes << " (ratio " << std::fixed << std::setprecision(2)
+        << (stream.encodedBytes > 0 ? static_cast<double>(stream.rawBytes) / stream.encodedBytes : 0.0) << ")";
+      separator = "; ";
+    }
+    t.flags(flags);
+    t.precision(precision);
+    return t;
+  }
+
+private:
+  struct Stream
+  {
+    size_t messageCount = 0;
+    size_t rawBytes = 0;
+    size_t encodedBytes = 0;
+  };
+  std::map<uint32_t, Stream> streams_;
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTCOMPRESSION_HPP_
@@ -0,0 +1,88 @@
+/**
+ * @file ListElement.hpp
+ *
+ * ListElement contains the element types, other than the built-in integer
+ * types, that the lists in this package can hold, and the helpers that the
+ * modules use to create and format elements of any of the supported types.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTELEMENT_HPP_
+#define AFV1_EXAMPLE_SRC_LISTELEMENT_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <type_traits>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ChannelSample is a small struct element: one digitized sample from one readout channel
+ */
+struct ChannelSample
+{
+  uint32_t timestamp; ///< Low 32 bits of the time at which the sample was taken
+  uint16_t channel;
+  uint16_t adc;
+};
+
+static_assert(sizeof(ChannelSample) == 8, "ChannelSample must not contain padding");
+
+inline bool
+operator==(const ChannelSample& lhs, const ChannelSample& rhs)
+{
+  return lhs.timestamp == rhs.timestamp && lhs.channel == rhs.channel && lhs.adc == rhs.adc;
+}
+
+inline bool
+operator!=(const ChannelSample& lhs, const ChannelSample& rhs)
+{
+  return !(lhs == rhs);
+}
+
+inline std::ostream&
+operator<<(std::ostream& t, const ChannelSample& sample)
+{
+  return t << "(" << sample.timestamp << ", " << sample.channel << ", " << sample.adc << ")";
+}
+
+/**
+ * @brief Writes one element of a list to a stream; narrow integer types are written as numbers
+ */
+template<typename T>
+inline void
+format_list_element(std::ostream& t, const T& value)
+{
+  if constexpr (std::is_arithmetic<T>::value) {
+    t << +value;
+  } else {
+    t << value;
+  }
+}
+
+/**
+ * @brief Creates an element with random contents, as the generator puts into its lists
+ */
+template<typename T>
+inline T
+random_list_element()
+{
+  return static_cast<T>((rand() % 1000) + 1);
+}
+
+template<>
+inline ChannelSample
+random_list_element<ChannelSample>()
+{
+  return { static_cast<uint32_t>(rand()), static_cast<uint16_t>(rand() % 2560), static_cast<uint16_t>(rand() % 4096) };
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTELEMENT_HPP_
@@ -0,0 +1,143 @@
+/**
+ * @file ListMessage.hpp
+ *
+ * ListMessage is the unit of data that is passed through the queues that
+ * connect the DAQModules in this package: a fixed-size header with the
+ * bookkeeping information for a list, and a reference-counted payload that
+ * holds the elements of the list.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTMESSAGE_HPP_
+#define AFV1_EXAMPLE_SRC_LISTMESSAGE_HPP_
+
+#include "ListPayload.hpp"
+#include "ReversedListComparison.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ListMessageHeader holds the information that travels with a list. It occupies
+ * exactly one cache line, so that reading or copying it never touches a second line.
+ */
+struct alignas(64) ListMessageHeader
+{
+  using clock_t = std::chrono::steady_clock;
+
+  /**
+   * @brief Bits that can be set in the flags field
+   */
+  enum Flags : uint32_t
+  {
+    kHasChecksum = 1u << 0, ///< The checksum field holds the checksum of the list in its original order
+    kHasPriority = 1u << 1, ///< Set on the wire by encoders that know of the priority field
+    kHasDeadline = 1u << 2  ///< The deadline field is set
+  };
+
+  uint64_t sequenceNumber = 0;      ///< Counts up from zero within a stream, restarting at each run
+  clock_t::time_point creationTime; ///< Set by the generator, preserved by every downstream stage
+  uint32_t streamId = 0;            ///< Identifies the generator that produced the list
+  uint32_t flags = 0;
+  uint32_t checksum = 0;
+  uint32_t priority = 0; ///< The lane of a queue with priority lanes; 0 is bulk data, higher is more urgent
+  clock_t::time_point deadline;     ///< After which the list is dropped by the stages that pop it, if kHasDeadline is set
+
+  void set_deadline(clock_t::time_point when) noexcept
+  {
+    deadline = when;
+    flags |= kHasDeadline;
+  }
+
+  /**
+   * @brief Whether the list has a deadline that has passed by now
+   */
+  bool is_expired(clock_t::time_point now) const noexcept { return (flags & kHasDeadline) && now > deadline; }
+};
+
+static_assert(sizeof(ListMessageHeader) == 64, "ListMessageHeader must occupy exactly one cache line");
+
+/**
+ * @brief Computes the checksum that is stored in a ListMessageHeader. When backToFront is set,
+ * the elements are visited in reverse order, so a reversed list has the same checksum as its original.
+ */
+template<typename T>
+inline uint32_t
+list_checksum(const T* data, size_t length, bool backToFront = false)
+{
+  uint64_t hash = hash_list(data, length, backToFront);
+  return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+/**
+ * @brief ListMessage is a ListMessageHeader plus a shared payload.
+ *
+ * Copying a ListMessage copies the header and shares the payload, so the generator can send
+ * the same list to several queues without copying its elements. A stage that wants to modify
+ * the elements may only do so in place when it holds the sole reference to the payload
+ * (see payload_is_exclusive()); otherwise it must put the modified elements into a new payload.
+ * Small lists are stored inline in the payload, so for them "sharing" is a copy of a few
+ * elements. For larger lists, when the last message referring to a payload is dropped, the
+ * payload's buffer goes back to the ListBufferPool that it was acquired from.
+ * T is the type of the elements of the list.
+ */
+template<typename T>
+struct ListMessage
+{
+  using clock_t = ListMessageHeader::clock_t;
+  using value_type = T;
+  using payload_t = ListPayload<T>;
+
+  ListMessageHeader header;
+  payload_t payload;
+
+  /**
+   * @brief The elements of the list
+   */
+  const payload_t& data() const { return payload; }
+
+  /**
+   * @brief A ListMessage always holds a single list (see ListBatch for messages that hold several)
+   */
+  size_t list_count() const { return 1; }
+
+  /**
+   * @brief Whether this message holds the only reference to its payload, so that the payload
+   * can be modified without affecting any other message
+   */
+  bool payload_is_exclusive() const { return payload.unique(); }
+
+  /**
+   * @brief The number of bytes of memory that the message keeps alive: itself and its payload's buffer
+   */
+  size_t memory_footprint() const { return sizeof(ListMessage) + payload.buffer_footprint(); }
+
+  void set_checksum()
+  {
+    header.checksum = list_checksum(data().data(), data().size());
+    header.flags |= ListMessageHeader::kHasChecksum;
+  }
+
+  /**
+   * @brief Checks the checksum in the header, if there is one, against the payload
+   * @param payloadIsReversed Whether the payload holds the list in reverse order
+   */
+  bool checksum_matches(bool payloadIsReversed = false) const
+  {
+    if (!(header.flags & ListMessageHeader::kHasChecksum)) {
+      return true;
+    }
+    return header.checksum == list_checksum(data().data(), data().size(), payloadIsReversed);
+  }
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTMESSAGE_HPP_
@@ -0,0 +1,677 @@
+/**
+ * @file ListMessageCodec.hpp
+ *
+ * ListMessageCodec lays list messages out as bytes, for the queues and
+ * transports that carry them out of the process.
+ *
+ * An encoded message, or frame, starts with a ListWireHeader that gives its
+ * length and the version of the layout, followed by the message's
+ * ListMessageHeader and a body that the codec for each kind of message
+ * defines. Every part of a frame starts at a multiple of eight bytes from the
+ * start of the frame, so the elements of a frame that is held in a suitably
+ * aligned buffer can be used where they are, through a view, without being
+ * decoded or copied. The body can instead be compressed, in which case the
+ * frame has to be read back into a message to get at the elements. All
+ * values are in the byte order of the host that
+ * encoded them; a frame from a host of the other byte order is rejected by
+ * its magic number.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTMESSAGECODEC_HPP_
+#define AFV1_EXAMPLE_SRC_LISTMESSAGECODEC_HPP_
+
+#include "ListBatch.hpp"
+#include "ListBufferPool.hpp"
+#include "ListCompression.hpp"
+#include "ListMessage.hpp"
+#include "ListRopeMessage.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+static_assert(std::is_trivially_copyable<ListMessageHeader>::value,
+              "ListMessageHeader is encoded byte for byte");
+
+/**
+ * @brief ListWireHeader starts every encoded message.
+ *
+ * The layout only ever grows by fields appended to the end of this header or of the
+ * ListMessageHeader; a decoder skips the fields that it does not know, using the sizes recorded
+ * here, and leaves those that the encoder did not know at their defaults. The version is only
+ * changed when a frame can no longer be read that way, and frames of another version are rejected.
+ */
+struct ListWireHeader
+{
+  static constexpr uint32_t MAGIC = 0x574c4641; ///< "AFLW" when written by a little-endian host
+  static constexpr uint16_t CURRENT_VERSION = 1;
+  static constexpr size_t ALIGNMENT = 8; ///< Every part of a frame starts at a multiple of this
+
+  uint64_t frameBytes;         ///< The whole frame, including this header and the trailing padding
+  uint32_t magic;
+  uint16_t version;
+  uint16_t wireHeaderBytes;    ///< The size of this header, as known to the encoder
+  uint16_t messageHeaderBytes; ///< The size of the ListMessageHeader that follows, as known to the encoder
+  uint8_t kind;                ///< The ListMessageCodec<>::KIND of the message
+  uint8_t elementBytes;        ///< sizeof() the list elements
+  uint8_t compression;         ///< The ListCompression of the body
+  uint8_t reserved[3];
+};
+
+static_assert(sizeof(ListWireHeader) == 24, "ListWireHeader must be 24 bytes");
+static_assert(sizeof(ListMessageHeader) % ListWireHeader::ALIGNMENT == 0,
+              "The body must follow the ListMessageHeader without padding");
+
+namespace codec_detail {
+
+/**
+ * @brief The number of bytes that a part of a frame takes up, with the padding that aligns the next one
+ */
+constexpr size_t
+padded(size_t bytes)
+{
+  return (bytes + ListWireHeader::ALIGNMENT - 1) / ListWireHeader::ALIGNMENT * ListWireHeader::ALIGNMENT;
+}
+
+} // namespace codec_detail
+
+/**
+ * @brief A piece of an encoded message that is held by the message itself
+ */
+struct ListMessageSpan
+{
+  const void* data;
+  size_t bytes;
+};
+
+/**
+ * @brief ListView refers to elements that are held somewhere else, such as in a receive buffer
+ */
+template<typename T>
+class ListView
+{
+public:
+  using value_type = T;
+  using const_iterator = const T*;
+
+  ListView() = default;
+  ListView(const T* data, size_t size)
+    : data_(data)
+    , size_(size)
+  {}
+
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const T& operator[](size_t idx) const { return data_[idx]; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+private:
+  const T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+/**
+ * @brief ListMessageView is a ListMessage whose elements are still in an encoded frame
+ */
+template<typename T>
+struct ListMessageView
+{
+  ListMessageHeader header;
+  ListView<T> list;
+
+  const ListView<T>& data() const { return list; }
+
+  bool checksum_matches(bool payloadIsReversed = false) const
+  {
+    if (!(header.flags & ListMessageHeader::kHasChecksum)) {
+      return true;
+    }
+    return header.checksum == list_checksum(list.data(), list.size(), payloadIsReversed);
+  }
+};
+
+/**
+ * @brief ListBatchView is a ListBatch whose offsets and values are still in an encoded frame
+ */
+template<typename T>
+struct ListBatchView
+{
+  using offset_t = typename ListBatch<T>::offsets_t::value_type;
+
+  ListMessageHeader header;
+  ListView<offset_t> offsets;
+  ListView<T> values;
+
+  const ListView<T>& data() const { return values; }
+  size_t list_count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+  ListView<T> list(size_t idx) const
+  {
+    return ListView<T>(values.data() + offsets[idx], offsets[idx + 1] - offsets[idx]);
+  }
+};
+
+/**
+ * @brief ListRopeView is a ListRopeMessage whose chunks are still in an encoded frame. The chunks
+ * are visited in the rope's order with for_each_chunk(), each with whether it is read back-to-front.
+ */
+template<typename T>
+struct ListRopeView
+{
+  ListMessageHeader header;
+  uint64_t size = 0;
+  uint64_t chunkSize = 0; ///< The largest chunk
+  uint64_t chunkCount = 0;
+  const uint64_t* chunkTable = nullptr; ///< (length << 1) | reversed, for each chunk
+  const uint8_t* chunks = nullptr;
+
+  template<typename Visitor>
+  void for_each_chunk(Visitor visit) const
+  {
+    const uint8_t* chunk = chunks;
+    for (size_t idx = 0; idx < chunkCount; ++idx) {
+      uint64_t length = chunkTable[idx] >> 1;
+      visit(ListView<T>(reinterpret_cast<const T*>(chunk), length), (chunkTable[idx] & 1) != 0);
+      chunk += codec_detail::padded(length * sizeof(T));
+    }
+  }
+};
+
+/**
+ * @brief ListMessageCodec describes the body of a message, views an encoded body and reads a view
+ * back into buffers from a pool. It is specialized for each kind of list message, with
+ *   static constexpr uint8_t KIND;
+ *   using view_t = ...;
+ *   static void describe_body(const Message&, std::vector<uint8_t>& prefix, std::vector<ListMessageSpan>& spans);
+ *   static bool view_body(const uint8_t* in, size_t bytes, view_t&);
+ *   static void read_view(const view_t&, Message&, ListBufferPool*);
+ * where the prefix holds the counts that start the body and the spans the rest of it, and
+ * view_body returns false if the bytes are not a body that describe_body could have produced.
+ */
+template<typename Message>
+struct ListMessageCodec;
+
+namespace codec_detail {
+
+template<typename V>
+inline void
+append_value(std::vector<uint8_t>& prefix, V value)
+{
+  size_t offset = prefix.size();
+  prefix.resize(offset + sizeof(V));
+  std::memcpy(prefix.data() + offset, &value, sizeof(V));
+}
+
+/**
+ * @brief Adds a span of the message, and the padding that keeps the next part aligned
+ */
+inline void
+append_span(std::vector<ListMessageSpan>& spans, const void* data, size_t bytes)
+{
+  static const uint8_t zeros[ListWireHeader::ALIGNMENT] = {};
+  if (bytes > 0) {
+    spans.push_back({ data, bytes });
+  }
+  if (padded(bytes) != bytes) {
+    spans.push_back({ zeros, padded(bytes) - bytes });
+  }
+}
+
+/**
+ * @brief Points at the count values that start a body, if there are enough bytes for them
+ */
+inline const uint64_t*
+read_counts(const uint8_t*& in, size_t& bytes, size_t count)
+{
+  if (bytes < count * sizeof(uint64_t)) {
+    return nullptr;
+  }
+  auto counts = reinterpret_cast<const uint64_t*>(in);
+  in += count * sizeof(uint64_t);
+  bytes -= count * sizeof(uint64_t);
+  return counts;
+}
+
+/**
+ * @brief Whether a region of count elements of type V fills exactly bytes, once padded
+ */
+template<typename V>
+inline bool
+region_fits(uint64_t count, size_t bytes)
+{
+  return count <= bytes / sizeof(V) && padded(count * sizeof(V)) <= bytes;
+}
+
+} // namespace codec_detail
+
+/**
+ * @brief A ListMessage is encoded as the number of elements followed by the elements
+ */
+template<typename T>
+struct ListMessageCodec<ListMessage<T>>
+{
+  static constexpr uint8_t KIND = 1;
+  using view_t = ListMessageView<T>;
+
+  static void describe_body(const ListMessage<T>& message,
+                            std::vector<uint8_t>& prefix,
+                            std::vector<ListMessageSpan>& spans)
+  {
+    codec_detail::append_value<uint64_t>(prefix, message.data().size());
+    codec_detail::append_span(spans, message.data().data(), message.data().size() * sizeof(T));
+  }
+
+  static bool view_body(const uint8_t* in, size_t bytes, view_t& view)
+  {
+    const uint64_t* size = codec_detail::read_counts(in, bytes, 1);
+    if (size == nullptr || !codec_detail::region_fits<T>(*size, bytes) ||
+        codec_detail::padded(*size * sizeof(T)) != bytes) {
+      return false;
+    }
+    view.list = ListView<T>(reinterpret_cast<const T*>(in), *size);
+    return true;
+  }
+
+  static void read_view(const view_t& view, ListMessage<T>& message, ListBufferPool* pool)
+  {
+    message.header = view.header;
+    message.payload = ListMessage<T>::payload_t::allocate(view.list.size(), pool);
+    std::copy(view.list.begin(), view.list.end(), message.payload.data());
+  }
+};
+
+/**
+ * @brief A ListBatch is encoded as the numbers of offsets and of values, followed by the offsets
+ * and then the values
+ */
+template<typename T>
+struct ListMessageCodec<ListBatch<T>>
+{
+  static constexpr uint8_t KIND = 2;
+  using view_t = ListBatchView<T>;
+  using offset_t = typename view_t::offset_t;
+
+  static void describe_body(const ListBatch<T>& batch, std::vector<uint8_t>& prefix, std::vector<ListMessageSpan>& spans)
+  {
+    codec_detail::append_value<uint64_t>(prefix, batch.offsets.size());
+    codec_detail::append_value<uint64_t>(prefix, batch.data().size());
+    codec_detail::append_span(spans, batch.offsets.data(), batch.offsets.size() * sizeof(offset_t));
+    codec_detail::append_span(spans, batch.data().data(), batch.data().size() * sizeof(T));
+  }
+
+  static bool view_body(const uint8_t* in, size_t bytes, view_t& view)
+  {
+    const uint64_t* counts = codec_detail::read_counts(in, bytes, 2);
+    if (counts == nullptr || !codec_detail::region_fits<offset_t>(counts[0], bytes)) {
+      return false;
+    }
+    size_t offsetBytes = codec_detail::padded(counts[0] * sizeof(offset_t));
+    if (!codec_detail::region_fits<T>(counts[1], bytes - offsetBytes) ||
+        codec_detail::padded(counts[1] * sizeof(T)) != bytes - offsetBytes) {
+      return false;
+    }
+    view.offsets = ListView<offset_t>(reinterpret_cast<const offset_t*>(in), counts[0]);
+    view.values = ListView<T>(reinterpret_cast<const T*>(in + offsetBytes), counts[1]);
+    // the offsets are used to index the values, so they must be in order and within the values
+    if (counts[0] == 0) {
+      return counts[1] == 0;
+    }
+    if (view.offsets[0] != 0 || static_cast<uint64_t>(view.offsets[counts[0] - 1]) != counts[1]) {
+      return false;
+    }
+    for (size_t idx = 1; idx < counts[0]; ++idx) {
+      if (view.offsets[idx] < view.offsets[idx - 1]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void read_view(const view_t& view, ListBatch<T>& batch, ListBufferPool* pool)
+  {
+    batch.header = view.header;
+    batch.offsets = ListBatch<T>::offsets_t::allocate(view.offsets.size(), pool);
+    batch.payload = ListBatch<T>::payload_t::allocate(view.values.size(), pool);
+    std::copy(view.offsets.begin(), view.offsets.end(), batch.offsets.data());
+    std::copy(view.values.begin(), view.values.end(), batch.payload.data());
+  }
+};
+
+/**
+ * @brief A ListRopeMessage is encoded as the number of elements, the largest chunk size and the
+ * chunk table, followed by the chunks as they are held, reversed or not. It is read back into a
+ * rope of unreversed chunks of the largest chunk size, in the rope's order.
+ */
+template<typename T>
+struct ListMessageCodec<ListRopeMessage<T>>
+{
+  static constexpr uint8_t KIND = 3;
+  using view_t = ListRopeView<T>;
+
+  static void describe_body(const ListRopeMessage<T>& message,
+                            std::vector<uint8_t>& prefix,
+                            std::vector<ListMessageSpan>& spans)
+  {
+    const ListRope<T>& rope = message.data();
+    uint64_t chunkSize = 0;
+    for (size_t idx = 0; idx < rope.chunk_count(); ++idx) {
+      chunkSize = std::max<uint64_t>(chunkSize, rope.chunk(idx).buffer.size());
+    }
+    codec_detail::append_value<uint64_t>(prefix, rope.size());
+    codec_detail::append_value<uint64_t>(prefix, chunkSize);
+    codec_detail::append_value<uint64_t>(prefix, rope.chunk_count());
+    for (size_t idx = 0; idx < rope.chunk_count(); ++idx) {
+      auto& chunk = rope.chunk(idx);
+      codec_detail::append_value<uint64_t>(prefix, (chunk.buffer.size() << 1) | (chunk.reversed ? 1 : 0));
+      codec_detail::append_span(spans, chunk.buffer.data(), chunk.buffer.size() * sizeof(T));
+    }
+  }
+
+  static bool view_body(const uint8_t* in, size_t bytes, view_t& view)
+  {
+    const uint64_t* sizes = codec_detail::read_counts(in, bytes, 3);
+    if (sizes == nullptr || sizes[2] > bytes / sizeof(uint64_t) || (sizes[0] > 0 && sizes[1] == 0)) {
+      return false;
+    }
+    view.size = sizes[0];
+    view.chunkSize = sizes[1];
+    view.chunkCount = sizes[2];
+    view.chunkTable = codec_detail::read_counts(in, bytes, sizes[2]);
+    view.chunks = in;
+    uint64_t remaining = view.size;
+    for (size_t idx = 0; idx < view.chunkCount; ++idx) {
+      uint64_t length = view.chunkTable[idx] >> 1;
+      if (length > remaining || length > view.chunkSize || !codec_detail::region_fits<T>(length, bytes)) {
+        return false;
+      }
+      remaining -= length;
+      bytes -= codec_detail::padded(length * sizeof(T));
+    }
+    return remaining == 0 && bytes == 0;
+  }
+
+  static void read_view(const view_t& view, ListRopeMessage<T>& message, ListBufferPool* pool)
+  {
+    message.header = view.header;
+    message.payload = ListRope<T>::allocate(view.size, view.chunkSize, pool);
+    // the element of the new rope that is filled in next
+    size_t chunkIdx = 0;
+    size_t position = 0;
+    view.for_each_chunk([&](const ListView<T>& chunk, bool reversed) {
+      for (size_t done = 0; done < chunk.size();) {
+        size_t room = message.payload.chunk(chunkIdx).buffer.size() - position;
+        size_t count = std::min(room, chunk.size() - done);
+        T* out = message.payload.chunk_data(chunkIdx) + position;
+        if (reversed) {
+          std::reverse_copy(chunk.end() - done - count, chunk.end() - done, out);
+        } else {
+          std::copy(chunk.begin() + done, chunk.begin() + done + count, out);
+        }
+        done += count;
+        position += count;
+        if (position == message.payload.chunk(chunkIdx).buffer.size()) {
+          ++chunkIdx;
+          position = 0;
+        }
+      }
+    });
+  }
+};
+
+/**
+ * @brief Describes the encoding of a message: the prefix holds its ListWireHeader, its header
+ * and the counts that start its body, and the spans the rest of the body. With a compression, the
+ * whole body is compressed into the prefix, as the words of list_compression_word, unless that
+ * would not make it smaller.
+ * @param uncompressedBytes Set, if given, to the number of bytes of the message without compression
+ * @return The number of bytes of the encoded message
+ */
+template<typename Message>
+size_t
+describe_list_message(const Message& message,
+                      std::vector<uint8_t>& prefix,
+                      std::vector<ListMessageSpan>& bodySpans,
+                      ListCompression compression = ListCompression::kNone,
+                      size_t* uncompressedBytes = nullptr)
+{
+  using word_t = typename list_compression_word<typename Message::value_type>::type;
+  static_assert(alignof(typename Message::value_type) <= ListWireHeader::ALIGNMENT,
+                "The elements of an encoded message must be aligned within it");
+  constexpr size_t bodyOffset = sizeof(ListWireHeader) + sizeof(ListMessageHeader);
+  prefix.resize(bodyOffset);
+  bodySpans.clear();
+  ListMessageHeader header = message.header;
+  header.flags |= ListMessageHeader::kHasPriority;
+  std::memcpy(prefix.data() + sizeof(ListWireHeader), &header, sizeof(ListMessageHeader));
+  ListMessageCodec<Message>::describe_body(message, prefix, bodySpans);
+
+  ListWireHeader wireHeader{};
+  wireHeader.frameBytes = prefix.size();
+  for (auto& span : bodySpans) {
+    wireHeader.frameBytes += span.bytes;
+  }
+  if (uncompressedBytes != nullptr) {
+    *uncompressedBytes = wireHeader.frameBytes;
+  }
+  if (compression != ListCompression::kNone) {
+    // the body is gathered into whole, aligned words first; the buffer is kept from one message to the next
+    thread_local std::vector<uint64_t> body;
+    size_t bodyBytes = wireHeader.frameBytes - bodyOffset;
+    body.resize(bodyBytes / sizeof(uint64_t));
+    auto out = reinterpret_cast<uint8_t*>(body.data());
+    std::memcpy(out, prefix.data() + bodyOffset, prefix.size() - bodyOffset);
+    out += prefix.size() - bodyOffset;
+    for (auto& span : bodySpans) {
+      std::memcpy(out, span.data, span.bytes);
+      out += span.bytes;
+    }
+    // a compressed body is the sizes of the body before and after compression, then the compressed words
+    prefix.resize(bodyOffset + 2 * sizeof(uint64_t));
+    compress_words(reinterpret_cast<const word_t*>(body.data()), bodyBytes / sizeof(word_t), compression, prefix);
+    uint64_t sizes[2] = { bodyBytes, prefix.size() - bodyOffset - sizeof(sizes) };
+    std::memcpy(prefix.data() + bodyOffset, sizes, sizeof(sizes));
+    prefix.resize(codec_detail::padded(prefix.size()));
+    if (prefix.size() < wireHeader.frameBytes) {
+      wireHeader.frameBytes = prefix.size();
+      wireHeader.compression = static_cast<uint8_t>(compression);
+      bodySpans.clear();
+    } else {
+      prefix.resize(bodyOffset);
+      bodySpans.clear();
+      ListMessageCodec<Message>::describe_body(message, prefix, bodySpans);
+    }
+  }
+  wireHeader.magic = ListWireHeader::MAGIC;
+  wireHeader.version = ListWireHeader::CURRENT_VERSION;
+  wireHeader.wireHeaderBytes = sizeof(ListWireHeader);
+  wireHeader.messageHeaderBytes = sizeof(ListMessageHeader);
+  wireHeader.kind = ListMessageCodec<Message>::KIND;
+  wireHeader.elementBytes = sizeof(typename Message::value_type);
+  std::memcpy(prefix.data(), &wireHeader, sizeof(wireHeader));
+  return wireHeader.frameBytes;
+}
+
+/**
+ * @brief Copies an encoded message, as described by describe_list_message(), to out
+ */
+inline void
+write_list_message(const std::vector<uint8_t>& prefix, const std::vector<ListMessageSpan>& bodySpans, uint8_t* out)
+{
+  std::memcpy(out, prefix.data(), prefix.size());
+  out += prefix.size();
+  for (auto& span : bodySpans) {
+    std::memcpy(out, span.data, span.bytes);
+    out += span.bytes;
+  }
+}
+
+/**
+ * @brief Reads the ListWireHeader at the start of a frame, of which at least sizeof(ListWireHeader)
+ * bytes must be given
+ * @return false if the bytes do not start a frame of the current version
+ */
+inline bool
+read_wire_header(const uint8_t* in, ListWireHeader& wireHeader)
+{
+  std::memcpy(&wireHeader, in, sizeof(wireHeader));
+  return wireHeader.magic == ListWireHeader::MAGIC && wireHeader.version == ListWireHeader::CURRENT_VERSION &&
+         wireHeader.wireHeaderBytes >= sizeof(ListWireHeader) && wireHeader.frameBytes % ListWireHeader::ALIGNMENT == 0 &&
+         wireHeader.frameBytes >= codec_detail::padded(wireHeader.wireHeaderBytes + wireHeader.messageHeaderBytes);
+}
+
+namespace codec_detail {
+
+/**
+ * @brief Checks that the bytes are a whole, aligned frame of the given kind of message, and reads
+ * its ListMessageHeader; fields that the encoder did not know of keep their defaults
+ * @return The offset of the body in the frame, or 0 if the bytes are not such a frame
+ */
+template<typename Message>
+size_t
+read_frame_headers(const uint8_t* in, size_t bytes, ListWireHeader& wireHeader, ListMessageHeader& header)
+{
+  if (reinterpret_cast<uintptr_t>(in) % ListWireHeader::ALIGNMENT != 0 || bytes < sizeof(ListWireHeader) ||
+      !read_wire_header(in, wireHeader) || wireHeader.frameBytes != bytes ||
+      wireHeader.kind != ListMessageCodec<Message>::KIND ||
+      wireHeader.elementBytes != sizeof(typename Message::value_type)) {
+    return 0;
+  }
+  header = ListMessageHeader();
+  std::memcpy(
+    &header, in + wireHeader.wireHeaderBytes, std::min<size_t>(wireHeader.messageHeaderBytes, sizeof(ListMessageHeader)));
+  // the priority was added within the padding of the header, which older encoders wrote as it happened to be
+  if (!(header.flags & ListMessageHeader::kHasPriority)) {
+    header.priority = 0;
+  }
+  header.flags &= ~ListMessageHeader::kHasPriority;
+  return padded(wireHeader.wireHeaderBytes + wireHeader.messageHeaderBytes);
+}
+
+} // namespace codec_detail
+
+/**
+ * @brief Views an encoded message where it is. The frame must start at a multiple of
+ * ListWireHeader::ALIGNMENT bytes, and the view refers to it for as long as it is used.
+ * @return false if the bytes are not an encoded message of this kind, or are a compressed one
+ */
+template<typename Message>
+bool
+view_list_message(const uint8_t* in, size_t bytes, typename ListMessageCodec<Message>::view_t& view)
+{
+  ListWireHeader wireHeader;
+  size_t bodyOffset = codec_detail::read_frame_headers<Message>(in, bytes, wireHeader, view.header);
+  return bodyOffset > 0 && wireHeader.compression == static_cast<uint8_t>(ListCompression::kNone) &&
+         ListMessageCodec<Message>::view_body(in + bodyOffset, bytes - bodyOffset, view);
+}
+
+/**
+ * @brief Reads an encoded message back, with its buffers from the given pool, decompressing it if
+ * necessary. The frame must be aligned as for view_list_message().
+ * @return false if the bytes are not an encoded message of this kind
+ */
+template<typename Message>
+bool
+read_list_message(const uint8_t* in, size_t bytes, Message& message, ListBufferPool* pool)
+{
+  using word_t = typename list_compression_word<typename Message::value_type>::type;
+  typename ListMessageCodec<Message>::view_t view;
+  ListWireHeader wireHeader;
+  size_t bodyOffset = codec_detail::read_frame_headers<Message>(in, bytes, wireHeader, view.header);
+  if (bodyOffset == 0) {
+    return false;
+  }
+  const uint8_t* body = in + bodyOffset;
+  size_t bodyBytes = bytes - bodyOffset;
+  if (wireHeader.compression != static_cast<uint8_t>(ListCompression::kNone)) {
+    // the decompressed body is kept from one message to the next, to save allocations
+    thread_local std::vector<uint64_t> decompressed;
+    const uint64_t* sizes = codec_detail::read_counts(body, bodyBytes, 2);
+    if (sizes == nullptr || sizes[0] % sizeof(uint64_t) != 0 || codec_detail::padded(sizes[1]) != bodyBytes ||
+        sizes[0] / sizeof(word_t) > max_decompressed_words(sizes[1])) {
+      return false;
+    }
+    decompressed.resize(sizes[0] / sizeof(uint64_t));
+    if (!decompress_words(body,
+                          sizes[1],
+                          static_cast<ListCompression>(wireHeader.compression),
+                          reinterpret_cast<word_t*>(decompressed.data()),
+                          sizes[0] / sizeof(word_t))) {
+      return false;
+    }
+    body = reinterpret_cast<const uint8_t*>(decompressed.data());
+    bodyBytes = sizes[0];
+  }
+  if (!ListMessageCodec<Message>::view_body(body, bodyBytes, view)) {
+    return false;
+  }
+  ListMessageCodec<Message>::read_view(view, message, pool);
+  return true;
+}
+
+/**
+ * @brief Identifies the kind of message and its element type, so that the two ends of a queue or
+ * connection can check that they agree on what they exchange; they are expected to run the same
+ * build of this package
+ */
+template<typename Message>
+uint64_t
+list_message_type_tag()
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char* name = typeid(Message).name(); *name != '\0'; ++name) {
+    hash = (hash ^ static_cast<uint8_t>(*name)) * 1099511628211ULL;
+  }
+  return hash ^ sizeof(typename Message::value_type);
+}
+
+/**
+ * @brief ListStreamPreamble starts a stream of encoded messages, such as a connection between the
+ * transport modules; the frames follow one another, each starting with its length
+ */
+struct ListStreamPreamble
+{
+  static constexpr char MAGIC[8] = { 'A', 'F', 'V', '1', 'S', 'T', 'R', 'M' };
+
+  char magic[8];
+  uint32_t version; ///< The ListWireHeader version of the frames
+  uint32_t reserved;
+  uint64_t typeTag; ///< list_message_type_tag() of the messages
+
+  template<typename Message>
+  static ListStreamPreamble for_messages()
+  {
+    ListStreamPreamble preamble;
+    std::memcpy(preamble.magic, MAGIC, sizeof(preamble.magic));
+    preamble.version = ListWireHeader::CURRENT_VERSION;
+    preamble.reserved = 0;
+    preamble.typeTag = list_message_type_tag<Message>();
+    return preamble;
+  }
+
+  bool operator==(const ListStreamPreamble& other) const
+  {
+    return std::memcmp(magic, other.magic, sizeof(magic)) == 0 && version == other.version && typeTag == other.typeTag;
+  }
+  bool operator!=(const ListStreamPreamble& other) const { return !(*this == other); }
+};
+
+static_assert(sizeof(ListStreamPreamble) == 24, "ListStreamPreamble must be 24 bytes");
+static_assert(sizeof(ListStreamPreamble) % ListWireHeader::ALIGNMENT == 0,
+              "The frames that follow a ListStreamPreamble must stay aligned");
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTMESSAGECODEC_HPP_
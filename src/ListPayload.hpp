@@ -0,0 +1,207 @@
+/**
+ * @file ListPayload.hpp
+ *
+ * ListPayload holds the elements of a list inside the object itself when
+ * the list is small, and in a shared ListBuffer when it is not.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTPAYLOAD_HPP_
+#define AFV1_EXAMPLE_SRC_LISTPAYLOAD_HPP_
+
+#include "ListBufferPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <utility>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ListPayload stores up to INLINE_CAPACITY elements inline and spills larger lists
+ * to a reference-counted ListBuffer.
+ *
+ * The inline capacity is chosen so that a ListPayload occupies exactly one cache line, which
+ * is the space that already follows the cache-line-aligned ListMessageHeader in a ListMessage.
+ * Small lists therefore cost no allocation and no pointer chase, and copying one copies its
+ * elements. Large lists are shared between copies, as before. Narrower element types fit
+ * proportionally more elements inline.
+ */
+template<typename T>
+class ListPayload
+{
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  static constexpr size_t INLINE_BYTES = 56;
+  static constexpr size_t INLINE_CAPACITY = INLINE_BYTES / sizeof(T);
+
+  ListPayload() noexcept
+    : size_(0)
+    , isInline_(true)
+  {}
+
+  ListPayload(const ListPayload& other) noexcept
+    : size_(other.size_)
+    , isInline_(other.isInline_)
+  {
+    if (isInline_) {
+      std::memcpy(inline_, other.inline_, size_ * sizeof(T));
+    } else {
+      new (&heap_) ListBuffer<T>(other.heap_);
+    }
+  }
+
+  ListPayload(ListPayload&& other) noexcept
+    : size_(other.size_)
+    , isInline_(other.isInline_)
+  {
+    if (isInline_) {
+      std::memcpy(inline_, other.inline_, size_ * sizeof(T));
+    } else {
+      new (&heap_) ListBuffer<T>(std::move(other.heap_));
+      other.reset();
+    }
+  }
+
+  ListPayload& operator=(const ListPayload& other) noexcept
+  {
+    if (this != &other) {
+      this->~ListPayload();
+      new (this) ListPayload(other);
+    }
+    return *this;
+  }
+
+  ListPayload& operator=(ListPayload&& other) noexcept
+  {
+    if (this != &other) {
+      this->~ListPayload();
+      new (this) ListPayload(std::move(other));
+    }
+    return *this;
+  }
+
+  ~ListPayload()
+  {
+    if (!isInline_) {
+      heap_.~ListBuffer<T>();
+    }
+  }
+
+  /**
+   * @brief Creates a payload for size elements: inline if size does not exceed inlineThreshold
+   * (or INLINE_CAPACITY, whichever is smaller), otherwise in a buffer from the given pool
+   */
+  static ListPayload allocate(size_t size, ListBufferPool* pool, size_t inlineThreshold = INLINE_CAPACITY)
+  {
+    ListPayload payload;
+    if (size <= inlineThreshold && size <= INLINE_CAPACITY) {
+      payload.size_ = static_cast<uint32_t>(size);
+    } else {
+      payload.isInline_ = false;
+      new (&payload.heap_) ListBuffer<T>(ListBuffer<T>::allocate(size, pool));
+    }
+    return payload;
+  }
+
+  /**
+   * @brief Creates a spilled payload that holds the elements of the given buffer
+   */
+  static ListPayload wrap(ListBuffer<T>&& buffer)
+  {
+    ListPayload payload;
+    payload.isInline_ = false;
+    new (&payload.heap_) ListBuffer<T>(std::move(buffer));
+    return payload;
+  }
+
+  /**
+   * @brief Drops the elements (and the reference to a shared buffer), leaving an empty inline payload
+   */
+  void reset() noexcept
+  {
+    if (!isInline_) {
+      heap_.~ListBuffer<T>();
+      isInline_ = true;
+    }
+    size_ = 0;
+  }
+
+  bool is_inline() const { return isInline_; }
+
+  /**
+   * @brief Whether no other payload shares these elements, so that they can be modified in place
+   */
+  bool unique() const { return isInline_ || heap_.unique(); }
+
+  /**
+   * @brief The pool that a spilled payload's buffer came from (nullptr for inline payloads)
+   */
+  ListBufferPool* pool() const { return isInline_ ? nullptr : heap_.pool(); }
+
+  /**
+   * @brief The number of bytes of memory that a spilled payload's buffer occupies (0 for inline payloads)
+   */
+  size_t buffer_footprint() const { return isInline_ ? 0 : heap_.footprint(); }
+
+  size_t size() const { return isInline_ ? size_ : heap_.size(); }
+  bool empty() const { return size() == 0; }
+  T* data() { return isInline_ ? inline_ : heap_.data(); }
+  const T* data() const { return isInline_ ? inline_ : heap_.data(); }
+  T& operator[](size_t idx) { return data()[idx]; }
+  const T& operator[](size_t idx) const { return data()[idx]; }
+  iterator begin() { return data(); }
+  iterator end() { return data() + size(); }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size(); }
+
+private:
+  uint32_t size_; ///< Number of elements, when they are stored inline
+  bool isInline_;
+  union
+  {
+    T inline_[INLINE_CAPACITY > 0 ? INLINE_CAPACITY : 1];
+    ListBuffer<T> heap_;
+  };
+};
+
+static_assert(sizeof(ListPayload<int>) == 64, "ListPayload should occupy exactly one cache line");
+
+/**
+ * @brief Format the first few elements of a ListPayload to a stream, as a list may be far too long to
+ * format whole
+ * @param t ostream Instance
+ * @param payload Payload to format
+ * @return ostream Instance
+ */
+template<typename T>
+inline std::ostream&
+operator<<(std::ostream& t, const ListPayload<T>& payload)
+{
+  constexpr size_t PAYLOAD_ELEMENTS_TO_FORMAT = 16;
+  t << "{";
+  size_t count = 0;
+  for (auto iter = payload.begin(); iter != payload.end() && count < PAYLOAD_ELEMENTS_TO_FORMAT; ++iter, ++count) {
+    if (count > 0)
+      t << ", ";
+    format_list_element(t, *iter);
+  }
+  if (payload.size() > count)
+    t << ", ...";
+  return t << "}";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTPAYLOAD_HPP_
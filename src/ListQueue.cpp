@@ -0,0 +1,86 @@
+/**
+ * @file ListQueue.cpp ListQueueReference and ListQueueRegistry class
+ * implementations
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ListQueue.hpp"
+
+namespace dunedaq {
+namespace afv1_example {
+
+ListQueueReference
+ListQueueReference::parse(const nlohmann::json& config)
+{
+  ListQueueReference reference;
+  if (!config.is_object()) {
+    reference.name = config.get<std::string>();
+    return reference;
+  }
+  reference.name = config.at("name").get<std::string>();
+  reference.kind = config.value<std::string>("kind", "");
+  reference.capacity = config.value<size_t>("capacity", 0);
+  reference.slotBytes = config.value<size_t>("slotBytes", 0);
+  reference.lanes = config.value<size_t>("lanes", 0);
+  reference.laneWeights = config.value<std::vector<size_t>>("laneWeights", {});
+  if (reference.lanes == 0) {
+    reference.lanes = reference.laneWeights.size();
+  }
+  reference.bufferPoolName = config.value<std::string>("bufferPoolName", reference.bufferPoolName);
+  reference.compression = parse_list_compression(config.value<std::string>("compression", "none"));
+  if (reference.kind != MPMC_KIND && reference.kind != SHARED_MEMORY_KIND) {
+    throw std::invalid_argument("Queue " + reference.name + " is of unknown kind \"" + reference.kind + "\"; only \"" +
+                                MPMC_KIND + "\" and \"" + SHARED_MEMORY_KIND +
+                                "\" queues can be configured in a module, appfwk queues are referred to by name");
+  }
+  if (reference.kind != MPMC_KIND && reference.lanes > 1) {
+    throw std::invalid_argument("Queue " + reference.name + " is given priority lanes, which only \"" + MPMC_KIND +
+                                "\" queues have");
+  }
+  return reference;
+}
+
+std::string
+ListQueueReference::name_of(const nlohmann::json& config)
+{
+  return config.is_object() ? config.value<std::string>("name", "") : config.get<std::string>();
+}
+
+ListQueueRegistry&
+ListQueueRegistry::get()
+{
+  // the queues are never destroyed, since a module may still refer to one until the process exits
+  static auto* registry = new ListQueueRegistry();
+  return *registry;
+}
+
+void
+ListQueueRegistry::check_size(const std::string& name, const std::string& what, size_t& existing, size_t requested)
+{
+  if (requested > 0 && existing > 0 && requested != existing) {
+    throw std::invalid_argument("Queue " + name + " already exists with " + what + " " + std::to_string(existing) +
+                                " rather than " + std::to_string(requested));
+  }
+  if (existing == 0) {
+    existing = requested;
+  }
+}
+
+void
+ListQueueRegistry::check_lane_weights(const std::string& name,
+                                      std::vector<size_t>& existing,
+                                      const std::vector<size_t>& requested)
+{
+  if (!requested.empty() && !existing.empty() && requested != existing) {
+    throw std::invalid_argument("Queue " + name + " already exists with other lane weights");
+  }
+  if (existing.empty()) {
+    existing = requested;
+  }
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,458 @@
+/**
+ * @file ListQueue.hpp
+ *
+ * ListQueueSink and ListQueueSource are the ends of a queue of list
+ * messages, as the modules of this package see them. The queue is either
+ * an appfwk queue, or a queue of one of the kinds that this package
+ * provides itself, which are kept in a ListQueueRegistry.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTQUEUE_HPP_
+#define AFV1_EXAMPLE_SRC_LISTQUEUE_HPP_
+
+#include "ListBufferPool.hpp"
+#include "ListCompression.hpp"
+#include "ListQueueBase.hpp"
+#include "MPMCListQueue.hpp"
+#include "QueueOccupancy.hpp"
+#include "SharedMemoryListQueue.hpp"
+#include "StopSignal.hpp"
+
+#include "appfwk/DAQSink.hpp"
+#include "appfwk/DAQSource.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief How a module's configuration refers to a queue: either just the name of an appfwk queue,
+ * or an object with the name, the kind and optionally the capacity of a queue that this package
+ * provides, e.g. { "name": "primaryDataQueue", "kind": "MPMCListQueue", "capacity": 64 }. An
+ * MPMCListQueue can also have several priority lanes, with strict priority between them unless
+ * they are given weights, e.g. "lanes": 2, "laneWeights": [ 1, 4 ]. A SharedMemoryListQueue also takes the size of its slots, the name of the buffer pool that the
+ * messages popped from it take their buffers from, and the compression, if any, of the messages
+ * that this process pushes onto it.
+ */
+struct ListQueueReference
+{
+  static constexpr const char* MPMC_KIND = "MPMCListQueue";
+  static constexpr const char* SHARED_MEMORY_KIND = "SharedMemoryListQueue";
+
+  std::string name;
+  std::string kind;  ///< Empty for an appfwk queue
+  size_t capacity = 0; ///< 0 when not given
+  size_t slotBytes = 0; ///< 0 when not given
+  size_t lanes = 0;     ///< 0 when not given
+  std::vector<size_t> laneWeights; ///< From the lowest lane to the highest; empty for strict priority
+  std::string bufferPoolName = "default";
+  ListCompression compression = ListCompression::kNone;
+
+  /**
+   * @brief Reads a queue reference from a module's configuration; throws std::invalid_argument
+   * if the kind is not one that this package provides, the compression is unknown, or the lanes
+   * are given for a queue that has none
+   */
+  static ListQueueReference parse(const nlohmann::json& config);
+
+  /**
+   * @brief The name of the queue that a module's configuration refers to, without checking the rest
+   */
+  static std::string name_of(const nlohmann::json& config);
+};
+
+/**
+ * @brief ListQueueRegistry holds the queues that this package provides, by name, so that every
+ * module that refers to a queue gets the same one. Like the appfwk queues, the queues live until
+ * the process exits, and messages left in them are still there in the next run; those of a
+ * SharedMemoryListQueue stay in its segment until the last process that has it open exits.
+ */
+class ListQueueRegistry
+{
+public:
+  static ListQueueRegistry& get();
+
+  /**
+   * @brief Returns the queue that the reference is to, creating it if necessary. Throws
+   * std::invalid_argument if a queue of that name exists with a different kind or element type,
+   * or with a different capacity, slot size, lane count or lane weights than those that are asked
+   * for, if they are, and
+   * std::runtime_error if a shared-memory segment can not be set up.
+   */
+  template<typename T>
+  std::shared_ptr<ListQueueBase<T>> get_queue(const ListQueueReference& reference)
+  {
+    bool isSharedMemory = reference.kind == ListQueueReference::SHARED_MEMORY_KIND;
+    std::type_index type = isSharedMemory ? std::type_index(typeid(SharedMemoryListQueue<T>))
+                                          : std::type_index(typeid(MPMCListQueue<T>));
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = queues_.find(reference.name);
+    if (iter == queues_.end()) {
+      std::shared_ptr<ListQueueBase<T>> queue;
+      if (isSharedMemory) {
+        queue = std::make_shared<SharedMemoryListQueue<T>>(
+          reference.name,
+          reference.capacity,
+          reference.slotBytes,
+          &ListBufferPool::get(reference.bufferPoolName),
+          reference.compression);
+      } else {
+        queue = std::make_shared<MPMCListQueue<T>>(reference.name,
+                                                   reference.capacity > 0 ? reference.capacity
+                                                                          : MPMCListQueue<T>::DEFAULT_CAPACITY,
+                                                   reference.lanes > 0 ? reference.lanes : 1,
+                                                   reference.laneWeights);
+      }
+      queues_.emplace(reference.name,
+                      Entry{ queue, type, reference.capacity, reference.slotBytes, reference.lanes, reference.laneWeights });
+      return queue;
+    }
+    Entry& entry = iter->second;
+    if (entry.type != type) {
+      throw std::invalid_argument("Queue " + reference.name + " already exists with a different kind or message type");
+    }
+    check_size(reference.name, "capacity", entry.capacity, reference.capacity);
+    check_size(reference.name, "slot size", entry.slotBytes, reference.slotBytes);
+    check_size(reference.name, "lane count", entry.lanes, reference.lanes);
+    check_lane_weights(reference.name, entry.laneWeights, reference.laneWeights);
+    return std::static_pointer_cast<ListQueueBase<T>>(entry.queue);
+  }
+
+private:
+  ListQueueRegistry() = default;
+
+  struct Entry
+  {
+    std::shared_ptr<void> queue; ///< A std::shared_ptr<ListQueueBase<T>>
+    std::type_index type;
+    size_t capacity;  ///< As first given, or 0 while no module has given one
+    size_t slotBytes; ///< Likewise
+    size_t lanes;     ///< Likewise
+    std::vector<size_t> laneWeights; ///< As first given, or empty while no module has given any
+  };
+
+  /**
+   * @brief Throws std::invalid_argument if both sizes are given and differ, and otherwise
+   * remembers the requested size if none was given before
+   */
+  static void check_size(const std::string& name, const std::string& what, size_t& existing, size_t requested);
+
+  /**
+   * @brief Likewise, for the lane weights
+   */
+  static void check_lane_weights(const std::string& name,
+                                 std::vector<size_t>& existing,
+                                 const std::vector<size_t>& requested);
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> queues_;
+};
+
+/**
+ * @brief ListQueueSink is the end of a queue that a module pushes messages onto.
+ *
+ * When the end is given the module's stop signal, a push that is waiting for room returns as soon
+ * as the signal is raised. A wait on an appfwk queue can not be woken, so it is made in steps of
+ * STOP_CHECK_INTERVAL instead, with the signal checked in between.
+ */
+template<typename T>
+class ListQueueSink
+{
+public:
+  using duration_type = std::chrono::milliseconds;
+
+  static constexpr duration_type STOP_CHECK_INTERVAL{ 10 };
+
+  explicit ListQueueSink(const nlohmann::json& config, StopSignal* stopSignal = nullptr)
+    : reference_(ListQueueReference::parse(config))
+    , stopSignal_(stopSignal)
+    , occupancy_(QueueOccupancy::get(reference_.name))
+  {
+    if (reference_.kind.empty()) {
+      daqSink_.reset(new dunedaq::appfwk::DAQSink<T>(reference_.name));
+      occupancyAttachment_ = occupancy_.attach({ {}, [sink = daqSink_.get()] { return !sink->can_push(); }, 0, {} });
+    } else {
+      listQueue_ = ListQueueRegistry::get().get_queue<T>(reference_);
+      listQueue_->attach_producer();
+      sharedMemoryQueue_ = dynamic_cast<SharedMemoryListQueue<T>*>(listQueue_.get());
+      occupancyAttachment_ = occupancy_.attach(
+        { [queue = listQueue_.get()] { return queue->size_approx(); }, {}, listQueue_->capacity(), reference_.kind });
+    }
+  }
+
+  const std::string& get_name() const { return reference_.name; }
+
+  /**
+   * @brief Pushes a message; throws appfwk::QueueTimeoutExpired if there is no room before the
+   * timeout, or before the stop signal is raised
+   * @return false if the queue can never hold the message, which it has reported and dropped
+   */
+  bool push(T&& value, const duration_type& timeout)
+  {
+    PushTimer timer(occupancy_);
+    if (daqSink_) {
+      push_to_daq_sink(std::move(value), timeout);
+      occupancy_.record_push(1);
+      return true;
+    }
+    size_t droppedCount = 0;
+    if (listQueue_->push_n(&value, 1, timeout, stopSignal_, droppedCount) == 0) {
+      throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, reference_.name, "push", timeout.count());
+    }
+    if (droppedCount > 0) {
+      return false;
+    }
+    occupancy_.record_push(1, listQueue_->size_approx());
+    return true;
+  }
+  bool push(const T& value, const duration_type& timeout) { return push(T(value), timeout); }
+
+  /**
+   * @brief Pushes the count messages, as far as there is room for them before the timeout, or
+   * before the stop signal is raised. Messages that the queue can never hold are reported and
+   * dropped, and added to droppedCount.
+   * @return The number of messages, from the front of the array, that were pushed or dropped
+   */
+  size_t push_n(T* values, size_t count, const duration_type& timeout, size_t& droppedCount)
+  {
+    PushTimer timer(occupancy_);
+    if (listQueue_) {
+      size_t previouslyDroppedCount = droppedCount;
+      size_t pushed = listQueue_->push_n(values, count, timeout, stopSignal_, droppedCount);
+      occupancy_.record_push(pushed - (droppedCount - previouslyDroppedCount), listQueue_->size_approx());
+      return pushed;
+    }
+    size_t pushed = 0;
+    try {
+      for (; pushed < count; ++pushed) {
+        push_to_daq_sink(std::move(values[pushed]), timeout);
+      }
+    } catch (const dunedaq::appfwk::QueueTimeoutExpired&) {
+    }
+    occupancy_.record_push(pushed);
+    return pushed;
+  }
+
+  /**
+   * @brief Creates a payload for size elements of a message that is to be pushed onto this queue
+   * alone: placed where a SharedMemoryListQueue carries its messages, if it can be, so that the
+   * push copies nothing, and otherwise as ListPayload::allocate() creates it. Waiting for a slot to
+   * place it in counts as time spent pushing.
+   */
+  template<typename Message = T>
+  typename Message::payload_t allocate_payload(size_t size,
+                                               ListBufferPool* pool,
+                                               size_t inlineThreshold,
+                                               const duration_type& timeout)
+  {
+    if (sharedMemoryQueue_ != nullptr && size > inlineThreshold) {
+      PushTimer timer(occupancy_);
+      typename Message::payload_t payload = sharedMemoryQueue_->place_payload(size, timeout, stopSignal_);
+      if (payload.size() == size) {
+        return payload;
+      }
+    }
+    return Message::payload_t::allocate(size, pool, inlineThreshold);
+  }
+
+  /**
+   * @brief Whether the messages pushed are copied out of this process, so that their buffers are
+   * free again as soon as the push returns
+   */
+  bool is_cross_process() const { return listQueue_ && listQueue_->is_cross_process(); }
+
+private:
+  /**
+   * @brief Pushes onto the appfwk queue, in steps of STOP_CHECK_INTERVAL if there is a stop signal
+   */
+  void push_to_daq_sink(T&& value, const duration_type& timeout)
+  {
+    if (stopSignal_ == nullptr) {
+      daqSink_->push(std::move(value), timeout);
+      return;
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+      auto remaining = std::chrono::duration_cast<duration_type>(deadline - std::chrono::steady_clock::now());
+      try {
+        // the appfwk queues only move the value from the argument when the push succeeds
+        daqSink_->push(std::move(value), std::max(duration_type::zero(), std::min(remaining, STOP_CHECK_INTERVAL)));
+        return;
+      } catch (const dunedaq::appfwk::QueueTimeoutExpired&) {
+        if (remaining <= STOP_CHECK_INTERVAL || stopSignal_->stop_requested()) {
+          throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, reference_.name, "push", timeout.count());
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Records the time that a push call takes, whether or not it throws
+   */
+  class PushTimer
+  {
+  public:
+    explicit PushTimer(QueueOccupancy& occupancy)
+      : occupancy_(occupancy)
+      , startTime_(std::chrono::steady_clock::now())
+    {}
+    ~PushTimer() { occupancy_.record_push_time(std::chrono::steady_clock::now() - startTime_); }
+    PushTimer(const PushTimer&) = delete;
+    PushTimer& operator=(const PushTimer&) = delete;
+
+  private:
+    QueueOccupancy& occupancy_;
+    std::chrono::steady_clock::time_point startTime_;
+  };
+
+  ListQueueReference reference_;
+  StopSignal* stopSignal_;
+  QueueOccupancy& occupancy_;
+  std::unique_ptr<dunedaq::appfwk::DAQSink<T>> daqSink_;
+  std::shared_ptr<ListQueueBase<T>> listQueue_;
+  SharedMemoryListQueue<T>* sharedMemoryQueue_ = nullptr; ///< listQueue_, if it is one
+  QueueOccupancy::Attachment occupancyAttachment_; ///< Declared last, as its probe refers to the queue
+};
+
+/**
+ * @brief ListQueueSource is the end of a queue that a module pops messages from. Like a
+ * ListQueueSink, it stops waiting when its stop signal, if it is given one, is raised.
+ */
+template<typename T>
+class ListQueueSource
+{
+public:
+  using duration_type = std::chrono::milliseconds;
+
+  static constexpr duration_type STOP_CHECK_INTERVAL{ 10 };
+
+  explicit ListQueueSource(const nlohmann::json& config, StopSignal* stopSignal = nullptr)
+    : reference_(ListQueueReference::parse(config))
+    , stopSignal_(stopSignal)
+    , occupancy_(QueueOccupancy::get(reference_.name))
+  {
+    if (reference_.kind.empty()) {
+      daqSource_.reset(new dunedaq::appfwk::DAQSource<T>(reference_.name));
+      // the depth is counted from the pushes and pops that the ends record
+      occupancyAttachment_ = occupancy_.attach({});
+    } else {
+      listQueue_ = ListQueueRegistry::get().get_queue<T>(reference_);
+      listQueue_->attach_consumer();
+      occupancyAttachment_ = occupancy_.attach(
+        { [queue = listQueue_.get()] { return queue->size_approx(); }, {}, listQueue_->capacity(), reference_.kind });
+    }
+  }
+
+  const std::string& get_name() const { return reference_.name; }
+
+  /**
+   * @brief Pops a message; throws appfwk::QueueTimeoutExpired if there is none before the timeout,
+   * or before the stop signal is raised
+   */
+  void pop(T& value, const duration_type& timeout)
+  {
+    if (daqSource_) {
+      pop_from_daq_source(value, timeout);
+    } else if (listQueue_->pop_n(&value, 1, timeout, stopSignal_) == 0) {
+      throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, reference_.name, "pop", timeout.count());
+    }
+    occupancy_.record_pop(1);
+  }
+
+  /**
+   * @brief Pops up to maxCount messages, waiting up to the timeout for the first one. From an
+   * appfwk queue, the messages after the first are only taken while the queue has some ready.
+   * @return The number of messages that were popped into the front of the array, 0 if the timeout
+   * expired or the stop signal was raised first
+   */
+  size_t pop_n(T* values, size_t maxCount, const duration_type& timeout)
+  {
+    if (listQueue_) {
+      size_t popped = listQueue_->pop_n(values, maxCount, timeout, stopSignal_);
+      occupancy_.record_pop(popped);
+      return popped;
+    }
+    size_t popped = 0;
+    try {
+      for (; popped < maxCount; ++popped) {
+        if (popped > 0 && !daqSource_->can_pop()) {
+          break;
+        }
+        if (popped == 0) {
+          pop_from_daq_source(values[popped], timeout);
+        } else {
+          daqSource_->pop(values[popped], duration_type::zero());
+        }
+      }
+    } catch (const dunedaq::appfwk::QueueTimeoutExpired&) {
+    }
+    occupancy_.record_pop(popped);
+    return popped;
+  }
+
+  /**
+   * @brief Whether other modules pop from the same queue, or several modules push onto it, in
+   * which case the sequence numbers that this end sees have gaps or are out of order. Only known
+   * once all of the modules have been initialized, and only for the modules of this process.
+   */
+  bool is_shared() const { return listQueue_ && listQueue_->is_shared(); }
+
+  /**
+   * @brief Whether the messages popped were copied in from another process, rather than handed
+   * over by a module of this one
+   */
+  bool is_cross_process() const { return listQueue_ && listQueue_->is_cross_process(); }
+
+private:
+  /**
+   * @brief Pops from the appfwk queue, in steps of STOP_CHECK_INTERVAL if there is a stop signal
+   */
+  void pop_from_daq_source(T& value, const duration_type& timeout)
+  {
+    if (stopSignal_ == nullptr) {
+      daqSource_->pop(value, timeout);
+      return;
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+      auto remaining = std::chrono::duration_cast<duration_type>(deadline - std::chrono::steady_clock::now());
+      try {
+        daqSource_->pop(value, std::max(duration_type::zero(), std::min(remaining, STOP_CHECK_INTERVAL)));
+        return;
+      } catch (const dunedaq::appfwk::QueueTimeoutExpired&) {
+        if (remaining <= STOP_CHECK_INTERVAL || stopSignal_->stop_requested()) {
+          throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, reference_.name, "pop", timeout.count());
+        }
+      }
+    }
+  }
+
+  ListQueueReference reference_;
+  StopSignal* stopSignal_;
+  QueueOccupancy& occupancy_;
+  std::unique_ptr<dunedaq::appfwk::DAQSource<T>> daqSource_;
+  std::shared_ptr<ListQueueBase<T>> listQueue_;
+  QueueOccupancy::Attachment occupancyAttachment_; ///< Declared last, as its probe refers to the queue
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTQUEUE_HPP_
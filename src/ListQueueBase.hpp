@@ -0,0 +1,103 @@
+/**
+ * @file ListQueueBase.hpp
+ *
+ * ListQueueBase is the interface of the queue kinds that this package
+ * provides in addition to the appfwk ones.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTQUEUEBASE_HPP_
+#define AFV1_EXAMPLE_SRC_LISTQUEUEBASE_HPP_
+
+#include "StopSignal.hpp"
+
+#include "appfwk/Queue.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ListQueueBase is an appfwk Queue that can also move several messages at once, and that
+ * knows how many of the modules in this process push onto it and pop from it
+ */
+template<typename T>
+class ListQueueBase : public dunedaq::appfwk::Queue<T>
+{
+public:
+  using value_type = typename dunedaq::appfwk::Queue<T>::value_type;
+  using duration_type = typename dunedaq::appfwk::Queue<T>::duration_type;
+
+  explicit ListQueueBase(const std::string& name)
+    : dunedaq::appfwk::Queue<T>(name)
+  {}
+
+  /**
+   * @brief Moves the count values into the queue, waiting up to the timeout for room for those
+   * that do not fit straight away, unless the stop signal, which may be null, is raised first. A
+   * value that the queue can never hold, such as one too large for its slots, is dropped instead,
+   * and added to droppedCount.
+   * @return The number of values, from the front of the array, that were pushed or dropped; fewer
+   * than count if the timeout expired or the stop signal was raised first
+   */
+  virtual size_t push_n(value_type* values,
+                        size_t count,
+                        const duration_type& timeout,
+                        StopSignal* stopSignal,
+                        size_t& droppedCount) = 0;
+
+  /**
+   * @brief Pops up to maxCount values, waiting up to the timeout if the queue is empty, unless the
+   * stop signal, which may be null, is raised first
+   * @return The number of values that were popped into the front of the array, 0 if the timeout
+   * expired or the stop signal was raised first
+   */
+  virtual size_t pop_n(value_type* values, size_t maxCount, const duration_type& timeout, StopSignal* stopSignal) = 0;
+
+  /**
+   * @brief The number of messages in the queue, which may already be out of date when it is returned
+   */
+  virtual size_t size_approx() const = 0;
+
+  /**
+   * @brief The most messages that the queue can hold
+   */
+  virtual size_t capacity() const = 0;
+
+  /**
+   * @brief Whether the messages leave this process, so that those in the queue take up none of its memory
+   */
+  virtual bool is_cross_process() const { return false; }
+
+  /**
+   * @brief Counts a module that pushes onto, or pops from, the queue
+   */
+  void attach_producer() { producerCount_.fetch_add(1, std::memory_order_relaxed); }
+  void attach_consumer() { consumerCount_.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Whether more than one module pushes onto the queue or pops from it, so that the
+   * messages that one module pops are not all of those that one module pushed, in order. For a
+   * queue between processes, only the modules of this process are known about.
+   */
+  bool is_shared() const
+  {
+    return producerCount_.load(std::memory_order_relaxed) > 1 || consumerCount_.load(std::memory_order_relaxed) > 1;
+  }
+
+private:
+  std::atomic<uint32_t> producerCount_{ 0 };
+  std::atomic<uint32_t> consumerCount_{ 0 };
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTQUEUEBASE_HPP_
@@ -0,0 +1,150 @@
+/**
+ * @file ListReceiver.hpp
+ *
+ * ListReceiver is a DAQModule implementation that accepts connections
+ * from ListSenders, which may be in other processes or on other hosts, and
+ * pushes the lists that it receives onto a queue.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTRECEIVER_HPP_
+#define AFV1_EXAMPLE_SRC_LISTRECEIVER_HPP_
+
+#include "ListBatch.hpp"
+#include "ListBufferPool.hpp"
+#include "ListMessage.hpp"
+#include "ListQueue.hpp"
+#include "ListRopeMessage.hpp"
+#include "ListSocket.hpp"
+#include "MemoryAccount.hpp"
+#include "QueueOccupancy.hpp"
+#include "StopSignal.hpp"
+
+#include "appfwk/DAQModule.hpp"
+#include "appfwk/ThreadHelper.hpp"
+
+#include <ers/Issue.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       InvalidStreamData,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The data received on a connection to " << address
+                                                                << " is not a stream of the expected list messages ("
+                                                                << reason << "); the connection is closed.",
+                       ((std::string)name),
+                       ((std::string)address)((std::string)reason))
+
+namespace afv1_example {
+
+/**
+ * @brief ListReceiver listens for connections from ListSenders and pushes the lists that arrive
+ * on them onto a queue.
+ *
+ * Any number of senders may connect, e.g. one from each of several hosts. The lists are read back
+ * into buffers from a pool. While the output queue is full, the receiver stops reading, so the
+ * senders are held back by the connections rather than the lists piling up in the receiver.
+ *
+ * The module is a template on the type of the list elements; each explicit instantiation is
+ * registered as a module type of its own (ListReceiver for int, ListReceiverUInt16, ...).
+ */
+template<typename T>
+class ListReceiver : public dunedaq::appfwk::DAQModule
+{
+public:
+  using message_t = ListMessage<T>;
+  using batch_t = ListBatch<T>;
+  using rope_message_t = ListRopeMessage<T>;
+
+  /**
+   * @brief ListReceiver Constructor
+   * @param name Instance name for this ListReceiver instance
+   */
+  explicit ListReceiver(const std::string& name);
+
+  ListReceiver(const ListReceiver&) = delete;            ///< ListReceiver is not copy-constructible
+  ListReceiver& operator=(const ListReceiver&) = delete; ///< ListReceiver is not copy-assignable
+  ListReceiver(ListReceiver&&) = delete;                 ///< ListReceiver is not move-constructible
+  ListReceiver& operator=(ListReceiver&&) = delete;      ///< ListReceiver is not move-assignable
+
+  void init() override;
+
+private:
+  /**
+   * @brief A connection from a sender, with the bytes that have been read from it but not yet decoded
+   */
+  struct Connection
+  {
+    ListSocket socket;
+    std::vector<uint8_t> buffer;
+    size_t filled = 0;
+    bool preambleSeen = false;
+  };
+
+  // Commands
+  void do_start(const std::vector<std::string>& args);
+  void do_stop(const std::vector<std::string>& args);
+
+  // Threading
+  dunedaq::appfwk::ThreadHelper thread_;
+  StopSignal stopSignal_; ///< Raised by do_stop(), to wake the worker thread out of its waits
+  void do_work(std::atomic<bool>&);
+
+  /**
+   * @brief The body of do_work() for one kind of message: ListMessages, ListBatches in batch mode,
+   * or ListRopeMessages in rope mode
+   */
+  template<typename Message>
+  void process_messages(std::atomic<bool>& running_flag, ListQueueSink<Message>& outputQueue);
+
+  /**
+   * @brief Decodes the complete messages in a connection's buffer, appends them to messages and
+   * keeps the rest of the bytes for the next read
+   * @return false, after reporting it, if the connection carries something else
+   */
+  template<typename Message>
+  bool decode_messages(Connection& connection, std::vector<Message>& messages);
+
+  // Configuration defaults
+  const std::string REASONABLE_DEFAULT_ADDRESS = "tcp://127.0.0.1:5555";
+  const bool REASONABLE_DEFAULT_BATCHMODE = false;
+  const bool REASONABLE_DEFAULT_ROPEMODE = false;
+  const std::string REASONABLE_DEFAULT_BUFFERPOOLNAME = "default";
+  const size_t REASONABLE_DEFAULT_SOCKETBUFFERBYTES = 0; ///< The system's default
+  const size_t REASONABLE_DEFAULT_RECEIVEBUFFERBYTES = 1 << 20;
+  const size_t REASONABLE_DEFAULT_MAXMESSAGEBYTES = 1 << 28;
+  const size_t REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS = 10000;
+
+  // Configuration
+  std::string address_ = REASONABLE_DEFAULT_ADDRESS; ///< Where to listen for ListSenders
+  bool batchMode_ = REASONABLE_DEFAULT_BATCHMODE; ///< Whether the queue carries ListBatches instead of ListMessages
+  bool ropeMode_ = REASONABLE_DEFAULT_ROPEMODE; ///< Whether the queue carries ListRopeMessages instead of ListMessages
+  std::unique_ptr<ListQueueSink<message_t>> outputQueue_;
+  std::unique_ptr<ListQueueSink<batch_t>> batchOutputQueue_;
+  std::unique_ptr<ListQueueSink<rope_message_t>> ropeOutputQueue_;
+  std::chrono::milliseconds queueTimeout_;
+  ListBufferPool* bufferPool_ = &ListBufferPool::get(REASONABLE_DEFAULT_BUFFERPOOLNAME);
+  size_t receiveBufferBytes_ = REASONABLE_DEFAULT_RECEIVEBUFFERBYTES; ///< Initial size of each connection's buffer
+  size_t maxMessageBytes_ = REASONABLE_DEFAULT_MAXMESSAGEBYTES; ///< Larger messages are taken for corrupt data
+  std::chrono::milliseconds memoryReportInterval_{ REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS };
+  ListSocket listener_;
+
+  // Memory accounting
+  MemoryAccount* memoryAccount_;
+  MemoryAccount* outputQueueAccount_ = nullptr;
+  QueueOccupancy* outputQueueOccupancy_ = nullptr;
+};
+} // namespace afv1_example
+} // namespace dunedaq
+
+#include "detail/ListReceiver.hxx"
+
+#endif // AFV1_EXAMPLE_SRC_LISTRECEIVER_HPP_
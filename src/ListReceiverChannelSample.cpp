@@ -0,0 +1,20 @@
+/**
+ * @file ListReceiverChannelSample.cpp ListReceiver class
+ * instantiation for lists of ChannelSample, registered as module type ListReceiverChannelSample
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ListReceiver.hpp"
+
+namespace dunedaq {
+namespace afv1_example {
+
+template class ListReceiver<ChannelSample>;
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+DEFINE_DUNE_DAQ_MODULE(dunedaq::afv1_example::ListReceiver<dunedaq::afv1_example::ChannelSample>)
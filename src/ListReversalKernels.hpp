@@ -0,0 +1,315 @@
+/**
+ * @file ListReversalKernels.hpp
+ *
+ * ListReversalKernels contains the loops that reverse, and check the reversal
+ * of, every list in a batch of lists that are stored back to back, using SSE2
+ * shuffles when all of the lists have the same, short length.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTREVERSALKERNELS_HPP_
+#define AFV1_EXAMPLE_SRC_LISTREVERSALKERNELS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief Returns the length that every list in a batch has, or 0 if the lengths differ.
+ * List i occupies the values from offsets[i] up to offsets[i + 1].
+ */
+inline size_t
+uniform_list_length(const int* offsets, size_t listCount)
+{
+  if (listCount == 0) {
+    return 0;
+  }
+  size_t length = static_cast<size_t>(offsets[1] - offsets[0]);
+  for (size_t idx = 1; idx < listCount; ++idx) {
+    if (static_cast<size_t>(offsets[idx + 1] - offsets[idx]) != length) {
+      return 0;
+    }
+  }
+  return length;
+}
+
+namespace detail {
+
+#if defined(__SSE2__)
+/**
+ * @brief Reverses the order of the ElementSize-byte elements within each GroupSize-byte group
+ * of a 16-byte vector. Only the combinations that the batch kernels use are defined.
+ */
+template<size_t ElementSize, size_t GroupSize>
+__m128i reverse_within_groups(__m128i v);
+
+template<>
+inline __m128i
+reverse_within_groups<2, 4>(__m128i v)
+{
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+template<>
+inline __m128i
+reverse_within_groups<2, 8>(__m128i v)
+{
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+template<>
+inline __m128i
+reverse_within_groups<2, 16>(__m128i v)
+{
+  __m128i halves = reverse_within_groups<2, 8>(v);
+  return _mm_shuffle_epi32(halves, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+template<>
+inline __m128i
+reverse_within_groups<4, 8>(__m128i v)
+{
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+template<>
+inline __m128i
+reverse_within_groups<4, 16>(__m128i v)
+{
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+template<>
+inline __m128i
+reverse_within_groups<8, 16>(__m128i v)
+{
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+/**
+ * @brief Reverses consecutive GroupSize-byte groups of elements over count elements, in a single
+ * sweep of 16-byte loads and stores; 32-byte groups swap two vectors as well. src and dst may be
+ * the same.
+ * @return The number of elements that were handled; the rest are left for the scalar loop
+ */
+template<size_t GroupSize, typename T>
+inline size_t
+reverse_groups_sse2(const T* src, T* dst, size_t count)
+{
+  constexpr size_t PER_VECTOR = 16 / sizeof(T);
+  size_t idx = 0;
+  if constexpr (GroupSize <= 16) {
+    for (; idx + PER_VECTOR <= count; idx += PER_VECTOR) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx), reverse_within_groups<sizeof(T), GroupSize>(v));
+    }
+  } else {
+    for (; idx + 2 * PER_VECTOR <= count; idx += 2 * PER_VECTOR) {
+      __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx));
+      __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx + PER_VECTOR));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx), reverse_within_groups<sizeof(T), 16>(hi));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx + PER_VECTOR), reverse_within_groups<sizeof(T), 16>(lo));
+    }
+  }
+  return idx;
+}
+
+/**
+ * @brief Compares the GroupSize-byte groups of one array with the reversed groups of another
+ * @return The number of elements that were found to match, a whole number of vectors
+ */
+template<size_t GroupSize, typename T>
+inline size_t
+match_reversed_groups_sse2(const T* original, const T* reversed, size_t count)
+{
+  constexpr size_t PER_VECTOR = 16 / sizeof(T);
+  size_t idx = 0;
+  if constexpr (GroupSize <= 16) {
+    for (; idx + PER_VECTOR <= count; idx += PER_VECTOR) {
+      __m128i o = _mm_loadu_si128(reinterpret_cast<const __m128i*>(original + idx));
+      __m128i r = reverse_within_groups<sizeof(T), GroupSize>(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(reversed + idx)));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(o, r)) != 0xFFFF) {
+        break;
+      }
+    }
+  } else {
+    for (; idx + 2 * PER_VECTOR <= count; idx += 2 * PER_VECTOR) {
+      __m128i oLo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(original + idx));
+      __m128i oHi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(original + idx + PER_VECTOR));
+      __m128i rLo = reverse_within_groups<sizeof(T), 16>(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(reversed + idx + PER_VECTOR)));
+      __m128i rHi = reverse_within_groups<sizeof(T), 16>(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(reversed + idx)));
+      if (_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(oLo, rLo), _mm_cmpeq_epi8(oHi, rHi))) != 0xFFFF) {
+        break;
+      }
+    }
+  }
+  return idx;
+}
+#endif
+
+/**
+ * @brief Whether the SSE2 kernels may be used for elements of type T: integers of 2, 4 or 8 bytes,
+ * for which comparing bytes is the same as comparing values
+ */
+template<typename T>
+constexpr bool
+has_vector_kernels()
+{
+#if defined(__SSE2__)
+  return std::is_integral<T>::value && (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Runs the reversal sweep for lists of the given length, if there is a kernel for it
+ * @return The number of elements that were handled
+ */
+template<typename T>
+inline size_t
+reverse_uniform_lists_vectorized(const T* src, T* dst, size_t count, size_t length)
+{
+#if defined(__SSE2__)
+  if constexpr (has_vector_kernels<T>()) {
+    switch (length * sizeof(T)) {
+      case 4:
+        if constexpr (sizeof(T) == 2) {
+          return reverse_groups_sse2<4>(src, dst, count);
+        }
+        break;
+      case 8:
+        if constexpr (sizeof(T) <= 4) {
+          return reverse_groups_sse2<8>(src, dst, count);
+        }
+        break;
+      case 16:
+        return reverse_groups_sse2<16>(src, dst, count);
+      case 32:
+        return reverse_groups_sse2<32>(src, dst, count);
+      default:
+        break;
+    }
+  }
+#endif
+  return 0;
+}
+
+/**
+ * @brief Runs the comparison sweep for lists of the given length, if there is a kernel for it
+ * @return The number of elements that were found to match
+ */
+template<typename T>
+inline size_t
+match_uniform_lists_vectorized(const T* original, const T* reversed, size_t count, size_t length)
+{
+#if defined(__SSE2__)
+  if constexpr (has_vector_kernels<T>()) {
+    switch (length * sizeof(T)) {
+      case 4:
+        if constexpr (sizeof(T) == 2) {
+          return match_reversed_groups_sse2<4>(original, reversed, count);
+        }
+        break;
+      case 8:
+        if constexpr (sizeof(T) <= 4) {
+          return match_reversed_groups_sse2<8>(original, reversed, count);
+        }
+        break;
+      case 16:
+        return match_reversed_groups_sse2<16>(original, reversed, count);
+      case 32:
+        return match_reversed_groups_sse2<32>(original, reversed, count);
+      default:
+        break;
+    }
+  }
+#endif
+  return 0;
+}
+
+} // namespace detail
+
+/**
+ * @brief Writes every list of a batch to dst in reverse order, keeping the lists where they are.
+ * src and dst may be the same array, to reverse the lists in place.
+ *
+ * When all of the lists are 4, 8, 16 or 32 bytes long and hold 2-, 4- or 8-byte integers, the
+ * whole values array is reversed in one sweep of vector shuffles chosen for that element width,
+ * without looking at the list boundaries again; other batches are reversed list by list.
+ */
+template<typename T>
+inline void
+reverse_lists(const T* src, T* dst, const int* offsets, size_t listCount)
+{
+  size_t valueCount = listCount > 0 ? static_cast<size_t>(offsets[listCount] - offsets[0]) : 0;
+  size_t length = uniform_list_length(offsets, listCount);
+  src += listCount > 0 ? offsets[0] : 0;
+  dst += listCount > 0 ? offsets[0] : 0;
+  if (length > 0) {
+    for (size_t done = detail::reverse_uniform_lists_vectorized(src, dst, valueCount, length); done < valueCount;
+         done += length) {
+      if (src == dst) {
+        std::reverse(dst + done, dst + done + length);
+      } else {
+        std::reverse_copy(src + done, src + done + length, dst + done);
+      }
+    }
+    return;
+  }
+  for (size_t idx = 0; idx < listCount; ++idx) {
+    size_t begin = static_cast<size_t>(offsets[idx] - offsets[0]);
+    size_t end = static_cast<size_t>(offsets[idx + 1] - offsets[0]);
+    if (src == dst) {
+      std::reverse(dst + begin, dst + end);
+    } else {
+      std::reverse_copy(src + begin, src + end, dst + begin);
+    }
+  }
+}
+
+/**
+ * @brief Finds the first list of a batch whose elements are not the reverse of the corresponding
+ * list in the original batch. Both batches must have the same list boundaries.
+ * @return The index of the first such list, or listCount if every list is reversed correctly
+ */
+template<typename T>
+inline size_t
+first_unreversed_list(const T* original, const T* reversed, const int* offsets, size_t listCount)
+{
+  size_t length = uniform_list_length(offsets, listCount);
+  size_t valueCount = listCount > 0 ? static_cast<size_t>(offsets[listCount] - offsets[0]) : 0;
+  size_t base = listCount > 0 ? static_cast<size_t>(offsets[0]) : 0;
+  size_t matched =
+    length > 0 ? detail::match_uniform_lists_vectorized(original + base, reversed + base, valueCount, length) : 0;
+
+  // check the remaining lists one by one, starting with the one in which the vector loop stopped
+  for (size_t idx = length > 0 ? matched / length : 0; idx < listCount; ++idx) {
+    const T* orig = original + offsets[idx];
+    const T* revEnd = reversed + offsets[idx + 1];
+    for (size_t pos = 0, len = static_cast<size_t>(offsets[idx + 1] - offsets[idx]); pos < len; ++pos) {
+      if (!(orig[pos] == *(revEnd - 1 - pos))) {
+        return idx;
+      }
+    }
+  }
+  return listCount;
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTREVERSALKERNELS_HPP_
@@ -13,9 +13,15 @@
 #ifndef AFV1_EXAMPLE_SRC_LISTREVERSER_HPP_
 #define AFV1_EXAMPLE_SRC_LISTREVERSER_HPP_
 
+#include "ListBatch.hpp"
+#include "ListMessage.hpp"
+#include "ListQueue.hpp"
+#include "ListRopeMessage.hpp"
+#include "MemoryAccount.hpp"
+#include "QueueOccupancy.hpp"
+#include "StopSignal.hpp"
+
 #include "appfwk/DAQModule.hpp"
-#include "appfwk/DAQSink.hpp"
-#include "appfwk/DAQSource.hpp"
 #include "appfwk/ThreadHelper.hpp"
 
 #include <ers/Issue.h>
@@ -30,10 +36,18 @@ namespace afv1_example {
 /**
  * @brief ListReverser reads lists of integers from one queue,
  * reverses the order of the list, and writes out the reversed list.
+ *
+ * The module is a template on the type of the list elements; each explicit instantiation is
+ * registered as a module type of its own (ListReverser for int, ListReverserUInt16, ...).
  */
+template<typename T>
 class ListReverser : public dunedaq::appfwk::DAQModule
 {
 public:
+  using message_t = ListMessage<T>;
+  using batch_t = ListBatch<T>;
+  using rope_message_t = ListRopeMessage<T>;
+
   /**
    * @brief ListReverser Constructor
    * @param name Instance name for this ListReverser instance
@@ -58,14 +72,62 @@ private:
 
   // Threading
   dunedaq::appfwk::ThreadHelper thread_;
+  StopSignal stopSignal_; ///< Raised by do_stop(), to wake the worker thread out of its waits
   void do_work(std::atomic<bool>&);
 
+  /**
+   * @brief The body of do_work() for one kind of message: ListMessages, ListBatches in batch mode,
+   * or ListRopeMessages in rope mode
+   */
+  template<typename Message>
+  void process_messages(std::atomic<bool>& running_flag,
+                        ListQueueSource<Message>& inputQueue,
+                        ListQueueSink<Message>& outputQueue);
+
+  /**
+   * @brief Reverses the list in a message: in place if the message holds the only reference to
+   * the payload, otherwise into a new payload
+   */
+  static void reverse_contents(message_t& message);
+
+  /**
+   * @brief Reverses each of the lists in a batch, in a single sweep over the values
+   */
+  static void reverse_contents(batch_t& batch);
+
+  /**
+   * @brief Reverses a rope by reversing its chunk table, in O(number of chunks)
+   */
+  static void reverse_contents(rope_message_t& message);
+
+  // Configuration defaults
+  const bool REASONABLE_DEFAULT_BATCHMODE = false;
+  const bool REASONABLE_DEFAULT_ROPEMODE = false;
+  const size_t REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS = 10000;
+  const size_t REASONABLE_DEFAULT_POPBATCHSIZE = 1;
+
   // Configuration
-  std::unique_ptr<dunedaq::appfwk::DAQSource<std::vector<int>>> inputQueue_;
-  std::unique_ptr<dunedaq::appfwk::DAQSink<std::vector<int>>> outputQueue_;
+  bool batchMode_ = REASONABLE_DEFAULT_BATCHMODE; ///< Whether the queues carry ListBatches instead of ListMessages
+  std::unique_ptr<ListQueueSource<message_t>> inputQueue_;
+  std::unique_ptr<ListQueueSink<message_t>> outputQueue_;
+  std::unique_ptr<ListQueueSource<batch_t>> batchInputQueue_;
+  std::unique_ptr<ListQueueSink<batch_t>> batchOutputQueue_;
+  bool ropeMode_ = REASONABLE_DEFAULT_ROPEMODE; ///< Whether the queues carry ListRopeMessages instead of ListMessages
+  std::unique_ptr<ListQueueSource<rope_message_t>> ropeInputQueue_;
+  std::unique_ptr<ListQueueSink<rope_message_t>> ropeOutputQueue_;
   std::chrono::milliseconds queueTimeout_;
+  std::chrono::milliseconds memoryReportInterval_{ REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS };
+  size_t popBatchSize_ = REASONABLE_DEFAULT_POPBATCHSIZE; ///< Most messages taken from the input queue at once
+
+  // Memory accounting
+  MemoryAccount* memoryAccount_;
+  MemoryAccount* inputQueueAccount_ = nullptr;
+  MemoryAccount* outputQueueAccount_ = nullptr;
+  QueueOccupancy* outputQueueOccupancy_ = nullptr;
 };
 } // namespace afv1_example
 } // namespace dunedaq
 
+#include "detail/ListReverser.hxx"
+
 #endif // AFV1_EXAMPLE_SRC_LISTREVERSER_HPP_
@@ -0,0 +1,267 @@
+/**
+ * @file ListRope.hpp
+ *
+ * ListRope holds a long list as a table of fixed-size chunks, each of which
+ * can be read front-to-back or back-to-front, so that the whole list can be
+ * reversed by reversing the table and flipping the orientation of the chunks,
+ * without moving any elements.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTROPE_HPP_
+#define AFV1_EXAMPLE_SRC_LISTROPE_HPP_
+
+#include "ListBufferPool.hpp"
+#include "ReversedListComparison.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ListRope is a list made of chunks: shared, reference-counted ListBuffers from a pool,
+ * each with a flag that says whether its elements are read in reverse.
+ *
+ * The list consists of the elements of the first chunk, in the chunk's orientation, followed by
+ * those of the second chunk, and so on. reverse() reverses the list in O(number of chunks) by
+ * reversing the order of the chunks and flipping their orientation. The elements of a chunk are
+ * never modified once the rope has been filled in, so copies of a rope share their chunks and
+ * each copy can be reversed on its own, without copying elements.
+ */
+template<typename T>
+class ListRope
+{
+public:
+  using value_type = T;
+
+  struct Chunk
+  {
+    ListBuffer<T> buffer;
+    bool reversed = false; ///< Whether the elements of the buffer are read back-to-front
+  };
+
+  /**
+   * @brief Bidirectional iterator over the elements of a rope, in the rope's order
+   */
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const
+    {
+      const Chunk& chunk = chunks_[chunkIndex_];
+      return chunk.reversed ? chunk.buffer.data()[chunk.buffer.size() - 1 - position_] : chunk.buffer.data()[position_];
+    }
+    pointer operator->() const { return &**this; }
+
+    const_iterator& operator++()
+    {
+      if (++position_ == chunks_[chunkIndex_].buffer.size()) {
+        ++chunkIndex_;
+        position_ = 0;
+      }
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      const_iterator previous = *this;
+      ++*this;
+      return previous;
+    }
+    const_iterator& operator--()
+    {
+      if (position_ == 0) {
+        position_ = chunks_[--chunkIndex_].buffer.size();
+      }
+      --position_;
+      return *this;
+    }
+    const_iterator operator--(int)
+    {
+      const_iterator previous = *this;
+      --*this;
+      return previous;
+    }
+
+    bool operator==(const const_iterator& other) const
+    {
+      return chunkIndex_ == other.chunkIndex_ && position_ == other.position_;
+    }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+  private:
+    friend class ListRope;
+    const_iterator(const Chunk* chunks, size_t chunkIndex)
+      : chunks_(chunks)
+      , chunkIndex_(chunkIndex)
+    {}
+
+    const Chunk* chunks_ = nullptr;
+    size_t chunkIndex_ = 0;
+    size_t position_ = 0; ///< Position within the chunk, in the chunk's reading order
+  };
+
+  ListRope() = default;
+
+  /**
+   * @brief Creates a rope of size elements in chunks of chunkSize elements (the last chunk may be
+   * shorter), with buffers from the given pool. The elements are not filled in. The chunk size
+   * of an empty rope is not used, and may be 0.
+   */
+  static ListRope allocate(size_t size, size_t chunkSize, ListBufferPool* pool)
+  {
+    ListRope rope;
+    if (size == 0) {
+      return rope;
+    }
+    rope.chunks_.reserve((size + chunkSize - 1) / chunkSize);
+    for (size_t done = 0; done < size; done += chunkSize) {
+      rope.chunks_.push_back({ ListBuffer<T>::allocate(std::min(chunkSize, size - done), pool), false });
+    }
+    rope.size_ = size;
+    return rope;
+  }
+
+  /**
+   * @brief Reverses the list by reversing the chunk table and flipping the orientation of each chunk
+   */
+  void reverse()
+  {
+    std::reverse(chunks_.begin(), chunks_.end());
+    for (auto& chunk : chunks_) {
+      chunk.reversed = !chunk.reversed;
+    }
+  }
+
+  /**
+   * @brief Drops the references to the chunks, leaving an empty rope
+   */
+  void reset()
+  {
+    chunks_.clear();
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t chunk_count() const { return chunks_.size(); }
+  const Chunk& chunk(size_t idx) const { return chunks_[idx]; }
+
+  /**
+   * @brief The storage of a chunk, for filling in a newly allocated rope (whose chunks are not reversed)
+   */
+  T* chunk_data(size_t idx) { return chunks_[idx].buffer.data(); }
+
+  const_iterator begin() const { return const_iterator(chunks_.data(), 0); }
+  const_iterator end() const { return const_iterator(chunks_.data(), chunks_.size()); }
+
+  /**
+   * @brief The pool that the chunks came from
+   */
+  ListBufferPool* pool() const { return chunks_.empty() ? nullptr : chunks_.front().buffer.pool(); }
+
+  /**
+   * @brief The number of bytes of memory that the chunk table and the chunks occupy
+   */
+  size_t buffer_footprint() const
+  {
+    size_t footprint = chunks_.capacity() * sizeof(Chunk);
+    for (auto& chunk : chunks_) {
+      footprint += chunk.buffer.footprint();
+    }
+    return footprint;
+  }
+
+  /**
+   * @brief Computes hash_list() of the elements, in the rope's order or back-to-front, chunk by chunk
+   */
+  uint64_t hash(bool backToFront = false) const
+  {
+    uint64_t hash = LIST_HASH_INITIAL_VALUE;
+    for (size_t idx = 0; idx < chunks_.size(); ++idx) {
+      const Chunk& chunk = chunks_[backToFront ? chunks_.size() - 1 - idx : idx];
+      hash = hash_list(chunk.buffer.data(), chunk.buffer.size(), chunk.reversed != backToFront, hash);
+    }
+    return hash;
+  }
+
+  /**
+   * @brief Copies the elements, in the rope's order, into a contiguous vector
+   */
+  std::vector<T> to_vector() const { return std::vector<T>(begin(), end()); }
+
+private:
+  std::vector<Chunk> chunks_;
+  size_t size_ = 0;
+};
+
+/**
+ * @brief Checks whether one rope holds the reverse of another. When the reversed rope consists of
+ * the original's chunks in the opposite order and orientation, as ListRope::reverse() leaves it,
+ * that is established from the chunk tables alone; otherwise the elements are compared.
+ */
+template<typename T>
+bool
+is_reverse_of(const ListRope<T>& original, const ListRope<T>& reversed)
+{
+  if (original.size() != reversed.size()) {
+    return false;
+  }
+  size_t chunkCount = original.chunk_count();
+  bool chunksAreMirrored = reversed.chunk_count() == chunkCount;
+  for (size_t idx = 0; chunksAreMirrored && idx < chunkCount; ++idx) {
+    auto& origChunk = original.chunk(idx);
+    auto& revChunk = reversed.chunk(chunkCount - 1 - idx);
+    chunksAreMirrored = origChunk.buffer.data() == revChunk.buffer.data() &&
+                        origChunk.buffer.size() == revChunk.buffer.size() && origChunk.reversed != revChunk.reversed;
+  }
+  if (chunksAreMirrored) {
+    return true;
+  }
+  return std::equal(original.begin(), original.end(), std::make_reverse_iterator(reversed.end()));
+}
+
+/**
+ * @brief Format the first elements of a ListRope to a stream. Ropes hold long lists, so only the
+ * first ROPE_ELEMENTS_TO_FORMAT elements are written.
+ * @param t ostream Instance
+ * @param rope Rope to format
+ * @return ostream Instance
+ */
+template<typename T>
+inline std::ostream&
+operator<<(std::ostream& t, const ListRope<T>& rope)
+{
+  constexpr size_t ROPE_ELEMENTS_TO_FORMAT = 16;
+  t << "{";
+  size_t count = 0;
+  for (auto iter = rope.begin(); iter != rope.end() && count < ROPE_ELEMENTS_TO_FORMAT; ++iter, ++count) {
+    if (count > 0)
+      t << ", ";
+    format_list_element(t, *iter);
+  }
+  if (rope.size() > count)
+    t << ", ...";
+  return t << "} in " << rope.chunk_count() << " chunk(s)";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTROPE_HPP_
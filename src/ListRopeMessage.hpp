@@ -0,0 +1,81 @@
+/**
+ * @file ListRopeMessage.hpp
+ *
+ * ListRopeMessage carries a single, long list through a queue as a
+ * ListRope, so that the list can be reversed without moving its elements.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTROPEMESSAGE_HPP_
+#define AFV1_EXAMPLE_SRC_LISTROPEMESSAGE_HPP_
+
+#include "ListMessage.hpp"
+#include "ListRope.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ListRopeMessage is a ListMessageHeader plus a ListRope.
+ *
+ * Copying a ListRopeMessage copies the chunk table and shares the chunks. Since the chunks are
+ * never modified, every message can reverse its own rope, whoever else holds the chunks.
+ */
+template<typename T>
+struct ListRopeMessage
+{
+  using clock_t = ListMessageHeader::clock_t;
+  using value_type = T;
+  using payload_t = ListRope<T>;
+
+  ListMessageHeader header;
+  payload_t payload;
+
+  /**
+   * @brief The elements of the list
+   */
+  const payload_t& data() const { return payload; }
+
+  size_t list_count() const { return 1; }
+
+  /**
+   * @brief A rope is reversed without modifying its chunks, so it can always be reversed in place
+   */
+  bool payload_is_exclusive() const { return true; }
+
+  /**
+   * @brief The number of bytes of memory that the message keeps alive: itself, its chunk table and its chunks
+   */
+  size_t memory_footprint() const { return sizeof(ListRopeMessage) + payload.buffer_footprint(); }
+
+  void set_checksum()
+  {
+    uint64_t hash = payload.hash();
+    header.checksum = static_cast<uint32_t>(hash ^ (hash >> 32));
+    header.flags |= ListMessageHeader::kHasChecksum;
+  }
+
+  /**
+   * @brief Checks the checksum in the header, if there is one, against the rope
+   * @param payloadIsReversed Whether the rope holds the list in reverse order
+   */
+  bool checksum_matches(bool payloadIsReversed = false) const
+  {
+    if (!(header.flags & ListMessageHeader::kHasChecksum)) {
+      return true;
+    }
+    uint64_t hash = payload.hash(payloadIsReversed);
+    return header.checksum == static_cast<uint32_t>(hash ^ (hash >> 32));
+  }
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTROPEMESSAGE_HPP_
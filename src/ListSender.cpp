@@ -0,0 +1,20 @@
+/**
+ * @file ListSender.cpp ListSender class
+ * instantiation for lists of int
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ListSender.hpp"
+
+namespace dunedaq {
+namespace afv1_example {
+
+template class ListSender<int>;
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+DEFINE_DUNE_DAQ_MODULE(dunedaq::afv1_example::ListSender<int>)
@@ -0,0 +1,155 @@
+/**
+ * @file ListSender.hpp
+ *
+ * ListSender is a DAQModule implementation that reads lists from a queue
+ * and sends them over a socket to a ListReceiver, which may be in another
+ * process or on another host.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTSENDER_HPP_
+#define AFV1_EXAMPLE_SRC_LISTSENDER_HPP_
+
+#include "IssueStormLimiter.hpp"
+#include "ListBatch.hpp"
+#include "ListCompression.hpp"
+#include "ListMessage.hpp"
+#include "ListQueue.hpp"
+#include "ListRopeMessage.hpp"
+#include "ListSocket.hpp"
+#include "MemoryAccount.hpp"
+#include "StopSignal.hpp"
+
+#include "appfwk/DAQModule.hpp"
+#include "appfwk/ThreadHelper.hpp"
+
+#include <ers/Issue.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       ConnectionFailed,
+                       appfwk::GeneralDAQModuleIssue,
+                       "Unable to connect to " << address << " (" << reason << "); retrying.",
+                       ((std::string)name),
+                       ((std::string)address)((std::string)reason))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       ConnectionLost,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The connection to " << address << " failed (" << reason << "); " << droppedCount
+                                            << " message(s) that were being sent were dropped.",
+                       ((std::string)name),
+                       ((std::string)address)((std::string)reason)((size_t)droppedCount))
+
+namespace afv1_example {
+
+/**
+ * @brief ListSender reads lists from a queue and writes them to a connection to a ListReceiver.
+ *
+ * The messages are encoded with their ListMessageCodec. Up to sendBatchSize messages that are
+ * ready in the queue are sent together, in one vectored write whose pieces point into the
+ * messages' own buffers, so the lists are not copied before the system copies them into the
+ * socket. Optionally, each message is compressed first, at the cost of that copy; the
+ * compression ratio of each stream is reported along with the memory accounting. The sender
+ * connects when it is started, and reconnects whenever the connection fails; the messages that
+ * were being sent when it failed are lost.
+ *
+ * The module is a template on the type of the list elements; each explicit instantiation is
+ * registered as a module type of its own (ListSender for int, ListSenderUInt16, ...).
+ */
+template<typename T>
+class ListSender : public dunedaq::appfwk::DAQModule
+{
+public:
+  using message_t = ListMessage<T>;
+  using batch_t = ListBatch<T>;
+  using rope_message_t = ListRopeMessage<T>;
+
+  /**
+   * @brief ListSender Constructor
+   * @param name Instance name for this ListSender instance
+   */
+  explicit ListSender(const std::string& name);
+
+  ListSender(const ListSender&) = delete;            ///< ListSender is not copy-constructible
+  ListSender& operator=(const ListSender&) = delete; ///< ListSender is not copy-assignable
+  ListSender(ListSender&&) = delete;                 ///< ListSender is not move-constructible
+  ListSender& operator=(ListSender&&) = delete;      ///< ListSender is not move-assignable
+
+  void init() override;
+
+private:
+  // Commands
+  void do_start(const std::vector<std::string>& args);
+  void do_stop(const std::vector<std::string>& args);
+
+  // Threading
+  dunedaq::appfwk::ThreadHelper thread_;
+  StopSignal stopSignal_; ///< Raised by do_stop(), to wake the worker thread out of its waits
+  void do_work(std::atomic<bool>&);
+
+  /**
+   * @brief The body of do_work() for one kind of message: ListMessages, ListBatches in batch mode,
+   * or ListRopeMessages in rope mode
+   */
+  template<typename Message>
+  void process_messages(std::atomic<bool>& running_flag, ListQueueSource<Message>& inputQueue);
+
+  /**
+   * @brief Connects to the receiver and sends the stream preamble, retrying until that succeeds
+   * or the module is stopped
+   * @param reportSuppressedIssues Called between attempts, so that summaries of suppressed issues
+   * are still reported while the receiver can not be reached
+   * @return Whether there is a connection
+   */
+  template<typename Message>
+  bool connect(std::atomic<bool>& running_flag,
+               ListSocket& connection,
+               IssueStormLimiter& connectFailureLimiter,
+               const std::function<void(bool)>& reportSuppressedIssues);
+
+  // Configuration defaults
+  const std::string REASONABLE_DEFAULT_ADDRESS = "tcp://127.0.0.1:5555";
+  const bool REASONABLE_DEFAULT_BATCHMODE = false;
+  const bool REASONABLE_DEFAULT_ROPEMODE = false;
+  const size_t REASONABLE_DEFAULT_SENDBATCHSIZE = 16;
+  const std::string REASONABLE_DEFAULT_COMPRESSION = "none";
+  const size_t REASONABLE_DEFAULT_SOCKETBUFFERBYTES = 0; ///< The system's default
+  const size_t REASONABLE_DEFAULT_MSECBETWEENCONNECTATTEMPTS = 1000;
+  const size_t REASONABLE_DEFAULT_MSECSENDTIMEOUT = 1000;
+  const size_t REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS = 10000;
+
+  // Configuration
+  std::string address_ = REASONABLE_DEFAULT_ADDRESS; ///< Where the ListReceiver listens
+  bool batchMode_ = REASONABLE_DEFAULT_BATCHMODE; ///< Whether the queue carries ListBatches instead of ListMessages
+  bool ropeMode_ = REASONABLE_DEFAULT_ROPEMODE; ///< Whether the queue carries ListRopeMessages instead of ListMessages
+  std::unique_ptr<ListQueueSource<message_t>> inputQueue_;
+  std::unique_ptr<ListQueueSource<batch_t>> batchInputQueue_;
+  std::unique_ptr<ListQueueSource<rope_message_t>> ropeInputQueue_;
+  std::chrono::milliseconds queueTimeout_;
+  size_t sendBatchSize_ = REASONABLE_DEFAULT_SENDBATCHSIZE; ///< Most messages sent in one write
+  ListCompression compression_ = ListCompression::kNone;
+  size_t socketBufferBytes_ = REASONABLE_DEFAULT_SOCKETBUFFERBYTES;
+  std::chrono::milliseconds connectInterval_{ REASONABLE_DEFAULT_MSECBETWEENCONNECTATTEMPTS };
+  std::chrono::milliseconds sendTimeout_{ REASONABLE_DEFAULT_MSECSENDTIMEOUT }; ///< Longest wait for room in the socket
+  std::chrono::milliseconds memoryReportInterval_{ REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS };
+
+  // Memory accounting
+  MemoryAccount* memoryAccount_;
+  MemoryAccount* inputQueueAccount_ = nullptr;
+};
+} // namespace afv1_example
+} // namespace dunedaq
+
+#include "detail/ListSender.hxx"
+
+#endif // AFV1_EXAMPLE_SRC_LISTSENDER_HPP_
@@ -0,0 +1,334 @@
+/**
+ * @file ListSocket.cpp ListSocket class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ListSocket.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace dunedaq {
+namespace afv1_example {
+
+namespace {
+
+constexpr const char* TCP_SCHEME = "tcp://";
+constexpr const char* UNIX_SCHEME = "unix://";
+constexpr int LISTEN_BACKLOG = 16;
+
+/**
+ * @brief A parsed address, ready to be bound or connected to
+ */
+struct SocketAddress
+{
+  int family = AF_UNSPEC;
+  sockaddr_storage storage{};
+  socklen_t length = 0;
+  std::string unixPath;
+};
+
+SocketAddress
+parse_address(const std::string& address)
+{
+  SocketAddress result;
+  if (address.compare(0, std::strlen(UNIX_SCHEME), UNIX_SCHEME) == 0) {
+    result.unixPath = address.substr(std::strlen(UNIX_SCHEME));
+    auto* unixAddress = reinterpret_cast<sockaddr_un*>(&result.storage);
+    if (result.unixPath.empty() || result.unixPath.size() >= sizeof(unixAddress->sun_path)) {
+      throw std::invalid_argument("Unix domain socket address " + address + " has an empty or over-long path");
+    }
+    unixAddress->sun_family = AF_UNIX;
+    std::memcpy(unixAddress->sun_path, result.unixPath.c_str(), result.unixPath.size() + 1);
+    result.family = AF_UNIX;
+    result.length = sizeof(sockaddr_un);
+    return result;
+  }
+  if (address.compare(0, std::strlen(TCP_SCHEME), TCP_SCHEME) == 0) {
+    std::string hostAndPort = address.substr(std::strlen(TCP_SCHEME));
+    size_t colon = hostAndPort.rfind(':');
+    std::string host = hostAndPort.substr(0, colon);
+    if (host == "localhost") {
+      host = "127.0.0.1";
+    }
+    auto* inetAddress = reinterpret_cast<sockaddr_in*>(&result.storage);
+    char* portEnd = nullptr;
+    unsigned long port = colon == std::string::npos ? 0 : std::strtoul(hostAndPort.c_str() + colon + 1, &portEnd, 10);
+    if (colon == std::string::npos || portEnd == hostAndPort.c_str() + colon + 1 || *portEnd != '\0' || port == 0 ||
+        port > 65535 || inet_pton(AF_INET, host.c_str(), &inetAddress->sin_addr) != 1) {
+      throw std::invalid_argument("TCP address " + address + " is not of the form tcp://<IPv4 address>:<port>");
+    }
+    inetAddress->sin_family = AF_INET;
+    inetAddress->sin_port = htons(static_cast<uint16_t>(port));
+    result.family = AF_INET;
+    result.length = sizeof(sockaddr_in);
+    return result;
+  }
+  throw std::invalid_argument("Socket address " + address + " starts with neither " + TCP_SCHEME + " nor " +
+                              UNIX_SCHEME);
+}
+
+std::runtime_error
+socket_error(const std::string& what, const std::string& address)
+{
+  return std::runtime_error(what + " " + address + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Waits up to the timeout for the events on the descriptor, unless the wake descriptor,
+ * if it is not -1, becomes readable first
+ * @return false if the timeout expired or the wake descriptor became readable, with errno set to
+ * ETIMEDOUT or ECANCELED, or if the wait failed
+ */
+bool
+wait_for_events(int fd, short events, std::chrono::milliseconds timeout, int wakeFd)
+{
+  pollfd entries[2] = { { fd, events, 0 }, { wakeFd, POLLIN, 0 } };
+  int result;
+  do {
+    result = ::poll(entries, wakeFd >= 0 ? 2 : 1, static_cast<int>(timeout.count()));
+  } while (result < 0 && errno == EINTR);
+  if (result > 0 && entries[0].revents != 0) {
+    return true;
+  }
+  if (result >= 0) {
+    errno = result > 0 ? ECANCELED : ETIMEDOUT;
+  }
+  return false;
+}
+
+void
+set_buffer_size(int fd, int option, size_t bufferBytes)
+{
+  if (bufferBytes > 0) {
+    int size = static_cast<int>(std::min<size_t>(bufferBytes, static_cast<size_t>(INT32_MAX)));
+    // the system may round the size, or cap it; a size that is refused outright is not worth failing over
+    ::setsockopt(fd, SOL_SOCKET, option, &size, sizeof(size));
+  }
+}
+
+} // namespace
+
+ListSocket::ListSocket(int fd, const std::string& address)
+  : fd_(fd)
+  , address_(address)
+{}
+
+ListSocket::~ListSocket()
+{
+  close();
+}
+
+ListSocket::ListSocket(ListSocket&& other) noexcept
+  : fd_(other.fd_)
+  , address_(std::move(other.address_))
+  , unixPath_(std::move(other.unixPath_))
+  , writeCallCount_(other.writeCallCount_)
+{
+  other.fd_ = -1;
+  other.unixPath_.clear();
+}
+
+ListSocket&
+ListSocket::operator=(ListSocket&& other) noexcept
+{
+  if (this != &other) {
+    close();
+    fd_ = other.fd_;
+    address_ = std::move(other.address_);
+    unixPath_ = std::move(other.unixPath_);
+    writeCallCount_ = other.writeCallCount_;
+    other.fd_ = -1;
+    other.unixPath_.clear();
+  }
+  return *this;
+}
+
+void
+ListSocket::close()
+{
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  if (!unixPath_.empty()) {
+    ::unlink(unixPath_.c_str());
+    unixPath_.clear();
+  }
+}
+
+void
+ListSocket::check_address(const std::string& address)
+{
+  parse_address(address);
+}
+
+ListSocket
+ListSocket::listen(const std::string& address, size_t bufferBytes)
+{
+  SocketAddress parsed = parse_address(address);
+  int fd = ::socket(parsed.family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    throw socket_error("Unable to create a socket to listen on", address);
+  }
+  ListSocket listener(fd, address);
+  if (parsed.family == AF_UNIX) {
+    ::unlink(parsed.unixPath.c_str());
+  } else {
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  }
+  // accepted connections inherit the receive buffer size, which has to be set before the connection is set up
+  set_buffer_size(fd, SO_RCVBUF, bufferBytes);
+  if (::bind(fd, reinterpret_cast<const sockaddr*>(&parsed.storage), parsed.length) != 0) {
+    throw socket_error("Unable to bind to", address);
+  }
+  listener.unixPath_ = parsed.unixPath;
+  if (::listen(fd, LISTEN_BACKLOG) != 0) {
+    throw socket_error("Unable to listen on", address);
+  }
+  return listener;
+}
+
+ListSocket
+ListSocket::connect(const std::string& address, size_t bufferBytes, std::chrono::milliseconds timeout, int wakeFd)
+{
+  SocketAddress parsed = parse_address(address);
+  int fd = ::socket(parsed.family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    throw socket_error("Unable to create a socket to connect to", address);
+  }
+  ListSocket connection(fd, address);
+  set_buffer_size(fd, SO_SNDBUF, bufferBytes);
+  if (parsed.family == AF_INET) {
+    int noDelay = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  }
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(&parsed.storage), parsed.length) != 0) {
+    if (errno != EINPROGRESS && errno != EAGAIN) {
+      throw socket_error("Unable to connect to", address);
+    }
+    if (!wait_for_events(fd, POLLOUT, timeout, wakeFd)) {
+      throw socket_error("Unable to connect to", address);
+    }
+    int error = 0;
+    socklen_t errorLength = sizeof(error);
+    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+    if (error != 0) {
+      errno = error;
+      throw socket_error("Unable to connect to", address);
+    }
+  }
+  return connection;
+}
+
+ListSocket
+ListSocket::accept()
+{
+  int fd = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED) {
+      return ListSocket();
+    }
+    throw socket_error("Unable to accept a connection on", address_);
+  }
+  return ListSocket(fd, address_);
+}
+
+std::vector<size_t>
+ListSocket::wait_readable(const std::vector<const ListSocket*>& sockets, std::chrono::milliseconds timeout, int wakeFd)
+{
+  std::vector<pollfd> entries;
+  entries.reserve(sockets.size() + 1);
+  for (auto* socket : sockets) {
+    entries.push_back(pollfd{ socket->fd_, POLLIN, 0 });
+  }
+  if (wakeFd >= 0) {
+    entries.push_back(pollfd{ wakeFd, POLLIN, 0 });
+  }
+  std::vector<size_t> ready;
+  int result = ::poll(entries.data(), entries.size(), static_cast<int>(timeout.count()));
+  if (result < 0) {
+    if (errno == EINTR) {
+      return ready;
+    }
+    throw socket_error("Unable to wait for", sockets.empty() ? std::string("sockets") : sockets.front()->address_);
+  }
+  for (size_t idx = 0; idx < sockets.size() && result > 0; ++idx) {
+    // a closed or failed connection is reported as readable, and the read then finds out which
+    if ((entries[idx].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+      ready.push_back(idx);
+    }
+  }
+  return ready;
+}
+
+void
+ListSocket::write_all(struct iovec* pieces, size_t count, std::chrono::milliseconds timeout, int wakeFd)
+{
+  static const size_t maxPiecesPerCall = static_cast<size_t>(std::max(1L, ::sysconf(_SC_IOV_MAX)));
+  while (count > 0) {
+    msghdr message{};
+    message.msg_iov = pieces;
+    message.msg_iovlen = std::min(count, maxPiecesPerCall);
+    ssize_t written = ::sendmsg(fd_, &message, MSG_NOSIGNAL);
+    ++writeCallCount_;
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        if (wait_for_events(fd_, POLLOUT, timeout, wakeFd)) {
+          continue;
+        }
+      }
+      throw socket_error("Unable to write to", address_);
+    }
+    // skip the pieces that were written completely, and the written part of the next one
+    size_t remaining = static_cast<size_t>(written);
+    while (count > 0 && remaining >= pieces->iov_len) {
+      remaining -= pieces->iov_len;
+      ++pieces;
+      --count;
+    }
+    if (count > 0) {
+      pieces->iov_base = static_cast<char*>(pieces->iov_base) + remaining;
+      pieces->iov_len -= remaining;
+    }
+  }
+}
+
+size_t
+ListSocket::read_some(void* data, size_t maxBytes)
+{
+  for (;;) {
+    ssize_t bytesRead = ::recv(fd_, data, maxBytes, 0);
+    if (bytesRead >= 0) {
+      return static_cast<size_t>(bytesRead);
+    }
+    if (errno != EINTR) {
+      throw socket_error("Unable to read from", address_);
+    }
+  }
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,121 @@
+/**
+ * @file ListSocket.hpp
+ *
+ * ListSocket is a stream socket, TCP or Unix domain, over which the
+ * transport modules of this package exchange list messages.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_LISTSOCKET_HPP_
+#define AFV1_EXAMPLE_SRC_LISTSOCKET_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct iovec;
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief ListSocket owns the descriptor of a listening or connected stream socket.
+ *
+ * Addresses are written "tcp://<host>:<port>", with a numeric IPv4 host or "localhost", or
+ * "unix://<path>". The operations throw std::runtime_error, with the reason from the system, when
+ * they fail; std::invalid_argument for an address that can not be parsed. Writes never raise
+ * SIGPIPE: a connection that the peer closed is reported as an error instead.
+ */
+class ListSocket
+{
+public:
+  ListSocket() = default;
+  ~ListSocket();
+
+  ListSocket(ListSocket&& other) noexcept;
+  ListSocket& operator=(ListSocket&& other) noexcept;
+  ListSocket(const ListSocket&) = delete;
+  ListSocket& operator=(const ListSocket&) = delete;
+
+  /**
+   * @brief Throws std::invalid_argument if the address can not be parsed
+   */
+  static void check_address(const std::string& address);
+
+  /**
+   * @brief Listens on the address; for a Unix domain socket, a file left at the path by an
+   * earlier listener is replaced
+   * @param bufferBytes Size of the receive buffers of the connections that are accepted, or 0 for
+   * the system's default
+   */
+  static ListSocket listen(const std::string& address, size_t bufferBytes);
+
+  /**
+   * @brief Connects to the address, waiting up to the timeout for the connection to be set up.
+   * Small writes are sent straight away rather than coalesced.
+   * @param bufferBytes Size of the send buffer, or 0 for the system's default
+   * @param wakeFd A descriptor, such as that of a StopSignal, that ends the wait when it becomes
+   * readable, or -1; the connection then fails with ECANCELED
+   */
+  static ListSocket connect(const std::string& address,
+                            size_t bufferBytes,
+                            std::chrono::milliseconds timeout,
+                            int wakeFd = -1);
+
+  /**
+   * @brief Accepts a connection on a listening socket, if one is waiting
+   * @return A socket that is not open if there was none
+   */
+  ListSocket accept();
+
+  /**
+   * @brief Waits up to the timeout until some of the sockets can be read from (or, for a
+   * listening socket, accepted on), or until the wake descriptor, if any, becomes readable
+   * @return The indices of those sockets
+   */
+  static std::vector<size_t> wait_readable(const std::vector<const ListSocket*>& sockets,
+                                           std::chrono::milliseconds timeout,
+                                           int wakeFd = -1);
+
+  /**
+   * @brief Writes all of the bytes of the count pieces, with as few system calls as the system's
+   * limit on the number of pieces per call allows. The pieces may be modified. Whenever the send
+   * buffer is full, waits up to the timeout for room; if there is none, or the wake descriptor
+   * becomes readable first (ECANCELED), the connection is left part of the way through the
+   * pieces, so the caller has to close it.
+   */
+  void write_all(struct iovec* pieces, size_t count, std::chrono::milliseconds timeout, int wakeFd = -1);
+
+  /**
+   * @brief Reads whatever is available, up to maxBytes, waiting for some if there is none
+   * @return The number of bytes read; 0 when the peer has closed the connection
+   */
+  size_t read_some(void* data, size_t maxBytes);
+
+  /**
+   * @brief Number of system calls that write_all() has made
+   */
+  uint64_t write_call_count() const { return writeCallCount_; }
+
+  bool is_open() const { return fd_ >= 0; }
+  const std::string& get_address() const { return address_; }
+  void close();
+
+private:
+  ListSocket(int fd, const std::string& address);
+
+  int fd_ = -1;
+  std::string address_;
+  std::string unixPath_; ///< The path that a listening Unix domain socket is bound to, removed on close
+  uint64_t writeCallCount_ = 0;
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_LISTSOCKET_HPP_
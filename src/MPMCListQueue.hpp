@@ -0,0 +1,290 @@
+/**
+ * @file MPMCListQueue.hpp
+ *
+ * MPMCListQueue is a bounded, lock-free queue that any number of modules
+ * can push list messages onto and pop them from, one at a time or in
+ * batches, optionally with several lanes that the priority in the header of
+ * each message chooses between.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_MPMCLISTQUEUE_HPP_
+#define AFV1_EXAMPLE_SRC_MPMCLISTQUEUE_HPP_
+
+#include "ListQueueBase.hpp"
+#include "MPMCRing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief MPMCListQueue is a ListQueueBase on top of an MPMCRing, whose push_n() and pop_n() move
+ * several messages with one claim on the ring.
+ *
+ * Pushes and pops that find room or data never take a lock. Only a thread that has to wait, for
+ * room or for data, takes the mutex and sleeps on a condition variable; the thread on the other
+ * side looks at the count of waiters after each push or pop, and only takes the mutex to wake
+ * them when there are any. The capacity is rounded up to a power of two.
+ *
+ * With more than one lane, each lane is an MPMCRing of the given capacity, and a message goes onto
+ * the lane of its header's priority, or the highest lane if its priority is higher still. A pop
+ * takes from the highest lane that has messages (strict priority), or, when the lanes are given
+ * weights, from the lanes in turn, each as often as its weight, skipping those that are empty; in
+ * either case a batch that the first lane can not fill is topped up from the others, highest
+ * first. Messages keep their order within a lane, but not across lanes.
+ */
+template<typename T>
+class MPMCListQueue : public ListQueueBase<T>
+{
+public:
+  using value_type = typename ListQueueBase<T>::value_type;
+  using duration_type = typename ListQueueBase<T>::duration_type;
+
+  static constexpr size_t DEFAULT_CAPACITY = 64;
+
+  /**
+   * @param capacity Of each lane
+   * @param laneCount At least 1
+   * @param laneWeights Empty for strict priority, or else one non-zero weight per lane, from the
+   * lowest lane to the highest; throws std::invalid_argument otherwise
+   */
+  MPMCListQueue(const std::string& name,
+                size_t capacity,
+                size_t laneCount = 1,
+                const std::vector<size_t>& laneWeights = {})
+    : ListQueueBase<T>(name)
+  {
+    if (laneCount == 0 || (!laneWeights.empty() && laneWeights.size() != laneCount) ||
+        std::count(laneWeights.begin(), laneWeights.end(), 0) > 0) {
+      throw std::invalid_argument("Queue " + name +
+                                  " needs at least one lane, and either no lane weights or a non-zero one for each lane");
+    }
+    for (size_t lane = 0; lane < laneCount; ++lane) {
+      lanes_.push_back(std::make_unique<MPMCRing<T>>(capacity));
+    }
+    schedule_ = make_schedule(laneWeights);
+  }
+
+  void push(value_type&& val, const duration_type& timeout) override
+  {
+    MPMCRing<T>& ring = *lanes_[lane_of(val)];
+    if (!ring.try_push(std::move(val)) &&
+        !wait_for([&] { return ring.try_push(std::move(val)); }, notFull_, pushWaiters_, timeout, nullptr)) {
+      throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, this->get_name(), "push", timeout.count());
+    }
+    wake_if_waiting(notEmpty_, popWaiters_);
+  }
+
+  void pop(value_type& val, const duration_type& timeout) override
+  {
+    if (try_pop_lanes(&val, 1) == 0 &&
+        !wait_for([&] { return try_pop_lanes(&val, 1) > 0; }, notEmpty_, popWaiters_, timeout, nullptr)) {
+      throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, this->get_name(), "pop", timeout.count());
+    }
+    wake_if_waiting(notFull_, pushWaiters_);
+  }
+
+  bool can_push() const noexcept override
+  {
+    for (auto& ring : lanes_) {
+      if (ring->size_approx() < ring->capacity()) {
+        return true;
+      }
+    }
+    return false;
+  }
+  bool can_pop() const noexcept override { return size_approx() > 0; }
+
+  size_t push_n(value_type* values,
+                size_t count,
+                const duration_type& timeout,
+                StopSignal* stopSignal,
+                size_t& /*droppedCount*/) override
+  {
+    size_t pushed = try_push_lanes(values, count);
+    if (pushed < count) {
+      if (pushed > 0) {
+        wake_if_waiting(notEmpty_, popWaiters_);
+      }
+      wait_for(
+        [&] {
+          size_t morePushed = try_push_lanes(values + pushed, count - pushed);
+          pushed += morePushed;
+          if (morePushed > 0 && pushed < count) {
+            // the consumers may be waiting for this part of the batch to make room for the rest
+            notEmpty_.notify_all();
+          }
+          return pushed == count;
+        },
+        notFull_,
+        pushWaiters_,
+        timeout,
+        stopSignal);
+    }
+    if (pushed > 0) {
+      wake_if_waiting(notEmpty_, popWaiters_);
+    }
+    return pushed;
+  }
+
+  size_t pop_n(value_type* values, size_t maxCount, const duration_type& timeout, StopSignal* stopSignal) override
+  {
+    size_t popped = try_pop_lanes(values, maxCount);
+    if (popped == 0 && maxCount > 0) {
+      wait_for([&] { return (popped = try_pop_lanes(values, maxCount)) > 0; },
+               notEmpty_,
+               popWaiters_,
+               timeout,
+               stopSignal);
+    }
+    if (popped > 0) {
+      wake_if_waiting(notFull_, pushWaiters_);
+    }
+    return popped;
+  }
+
+  size_t capacity() const override { return lanes_.size() * lanes_.front()->capacity(); }
+  size_t size_approx() const override
+  {
+    size_t size = 0;
+    for (auto& ring : lanes_) {
+      size += ring->size_approx();
+    }
+    return size;
+  }
+
+  size_t lane_count() const { return lanes_.size(); }
+
+private:
+  /**
+   * @brief The order in which weighted pops visit the lanes: each lane as often as its weight,
+   * spread out as evenly as possible, rather than in runs (smooth weighted round-robin)
+   */
+  static std::vector<size_t> make_schedule(const std::vector<size_t>& laneWeights)
+  {
+    size_t totalWeight = 0;
+    for (size_t weight : laneWeights) {
+      totalWeight += weight;
+    }
+    std::vector<size_t> schedule;
+    std::vector<int64_t> credit(laneWeights.size(), 0);
+    for (size_t turn = 0; turn < totalWeight; ++turn) {
+      size_t chosen = 0;
+      for (size_t lane = 0; lane < laneWeights.size(); ++lane) {
+        credit[lane] += static_cast<int64_t>(laneWeights[lane]);
+        if (credit[lane] > credit[chosen] || (credit[lane] == credit[chosen] && lane > chosen)) {
+          chosen = lane;
+        }
+      }
+      credit[chosen] -= static_cast<int64_t>(totalWeight);
+      schedule.push_back(chosen);
+    }
+    return schedule;
+  }
+
+  size_t lane_of(const value_type& val) const
+  {
+    return val.header.priority < lanes_.size() ? val.header.priority : lanes_.size() - 1;
+  }
+
+  /**
+   * @brief Pushes the messages onto their lanes, in order, up to the first that does not fit
+   */
+  size_t try_push_lanes(value_type* values, size_t count)
+  {
+    if (lanes_.size() == 1) {
+      return lanes_.front()->try_push_n(values, count);
+    }
+    size_t pushed = 0;
+    while (pushed < count) {
+      size_t lane = lane_of(values[pushed]);
+      size_t run = 1;
+      while (pushed + run < count && lane_of(values[pushed + run]) == lane) {
+        ++run;
+      }
+      size_t runPushed = lanes_[lane]->try_push_n(values + pushed, run);
+      pushed += runPushed;
+      if (runPushed < run) {
+        break;
+      }
+    }
+    return pushed;
+  }
+
+  size_t try_pop_lanes(value_type* values, size_t maxCount)
+  {
+    if (lanes_.size() == 1) {
+      return lanes_.front()->try_pop_n(values, maxCount);
+    }
+    size_t first = schedule_.empty() ? lanes_.size() - 1
+                                     : schedule_[popTurn_.fetch_add(1, std::memory_order_relaxed) % schedule_.size()];
+    size_t popped = lanes_[first]->try_pop_n(values, maxCount);
+    for (size_t lane = lanes_.size(); lane-- > 0 && popped < maxCount;) {
+      if (lane != first) {
+        popped += lanes_[lane]->try_pop_n(values + popped, maxCount - popped);
+      }
+    }
+    return popped;
+  }
+
+  template<typename Attempt>
+  bool wait_for(Attempt attempt,
+                std::condition_variable& condition,
+                std::atomic<uint32_t>& waiters,
+                const duration_type& timeout,
+                StopSignal* stopSignal)
+  {
+    StopSignal::Listener stopListener(stopSignal, mutex_, condition);
+    // the waiter count is raised before the ring is tried again, and wake_if_waiting() reads it
+    // after the ring has changed, so a push or pop can not slip in between unnoticed
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool succeeded = false;
+    condition.wait_for(lock, timeout, [&] {
+      succeeded = attempt();
+      return succeeded || (stopSignal != nullptr && stopSignal->stop_requested());
+    });
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    return succeeded;
+  }
+
+  void wake_if_waiting(std::condition_variable& condition, std::atomic<uint32_t>& waiters)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      condition.notify_all();
+    }
+  }
+
+  std::vector<std::unique_ptr<MPMCRing<T>>> lanes_; ///< From the lowest priority to the highest
+  std::vector<size_t> schedule_;                     ///< Empty for strict priority
+  std::atomic<size_t> popTurn_{ 0 };
+  alignas(64) std::atomic<uint32_t> pushWaiters_{ 0 };
+  std::atomic<uint32_t> popWaiters_{ 0 };
+  std::mutex mutex_;
+  std::condition_variable notFull_;
+  std::condition_variable notEmpty_;
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_MPMCLISTQUEUE_HPP_
@@ -0,0 +1,239 @@
+/**
+ * @file MPMCRing.hpp
+ *
+ * MPMCRing is a bounded, lock-free ring buffer that any number of threads
+ * can push to and pop from concurrently.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_MPMCRING_HPP_
+#define AFV1_EXAMPLE_SRC_MPMCRING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief MPMCRing is a bounded multi-producer, multi-consumer ring of slots, each with its
+ * own sequence counter (D. Vyukov's design).
+ *
+ * A push or pop claims a slot with a single compare-and-swap on the shared tail or head
+ * index, and then publishes the slot through the slot's sequence counter, so there is no
+ * ABA problem and no thread ever waits for a lock. The capacity is rounded up to a power of two.
+ */
+template<typename T>
+class MPMCRing
+{
+public:
+  explicit MPMCRing(size_t capacity)
+    : mask_(round_up_to_power_of_two(capacity < 2 ? 2 : capacity) - 1)
+    , slots_(new Slot[mask_ + 1])
+  {
+    for (size_t idx = 0; idx <= mask_; ++idx) {
+      slots_[idx].sequence.store(idx, std::memory_order_relaxed);
+    }
+  }
+
+  ~MPMCRing()
+  {
+    T discarded;
+    while (try_pop(discarded)) {
+    }
+  }
+
+  MPMCRing(const MPMCRing&) = delete;
+  MPMCRing& operator=(const MPMCRing&) = delete;
+
+  size_t capacity() const { return mask_ + 1; }
+
+  /**
+   * @brief Approximate number of elements in the ring; exact only when no other thread is using it
+   */
+  size_t size_approx() const
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    return tail >= head ? tail - head : 0;
+  }
+
+  /**
+   * @brief Pushes a value unless the ring is full
+   * @return false if the ring was full, in which case value is left untouched
+   */
+  template<typename U>
+  bool try_push(U&& value)
+  {
+    Slot* slot;
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&slot->storage) T(std::forward<U>(value));
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pops the oldest value unless the ring is empty
+   * @return false if the ring was empty
+   */
+  bool try_pop(T& value)
+  {
+    Slot* slot;
+    size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    T* stored = slot->value();
+    value = std::move(*stored);
+    stored->~T();
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Moves as many of the count values as there are free slots for into the ring, claiming
+   * all of those slots with a single compare-and-swap
+   * @return The number of values, from the front of the array, that were pushed
+   */
+  size_t try_push_n(T* values, size_t count)
+  {
+    if (count == 0) {
+      return 0;
+    }
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    size_t claimed;
+    for (;;) {
+      claimed = 0;
+      while (claimed < count && claimed <= mask_) {
+        size_t seq = slots_[(pos + claimed) & mask_].sequence.load(std::memory_order_acquire);
+        if (seq != pos + claimed) {
+          break;
+        }
+        ++claimed;
+      }
+      if (claimed == 0) {
+        // either the ring is full, or another producer moved the tail on since it was read
+        size_t seq = slots_[pos & mask_].sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0) {
+          return 0;
+        }
+        pos = tail_.load(std::memory_order_relaxed);
+        continue;
+      }
+      // a slot that is free for position pos + i stays free until the tail has been moved past it,
+      // so moving the tail from pos gives this thread all of the slots that were checked
+      if (tail_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t idx = 0; idx < claimed; ++idx) {
+      Slot& slot = slots_[(pos + idx) & mask_];
+      new (&slot.storage) T(std::move(values[idx]));
+      slot.sequence.store(pos + idx + 1, std::memory_order_release);
+    }
+    return claimed;
+  }
+
+  /**
+   * @brief Pops up to maxCount of the oldest values, claiming them with a single compare-and-swap
+   * @return The number of values that were popped into the front of the array
+   */
+  size_t try_pop_n(T* values, size_t maxCount)
+  {
+    if (maxCount == 0) {
+      return 0;
+    }
+    size_t pos = head_.load(std::memory_order_relaxed);
+    size_t claimed;
+    for (;;) {
+      claimed = 0;
+      while (claimed < maxCount && claimed <= mask_) {
+        size_t seq = slots_[(pos + claimed) & mask_].sequence.load(std::memory_order_acquire);
+        if (seq != pos + claimed + 1) {
+          break;
+        }
+        ++claimed;
+      }
+      if (claimed == 0) {
+        size_t seq = slots_[pos & mask_].sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) {
+          return 0;
+        }
+        pos = head_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (head_.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t idx = 0; idx < claimed; ++idx) {
+      Slot& slot = slots_[(pos + idx) & mask_];
+      T* stored = slot.value();
+      values[idx] = std::move(*stored);
+      stored->~T();
+      slot.sequence.store(pos + idx + mask_ + 1, std::memory_order_release);
+    }
+    return claimed;
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    T* value() { return std::launder(reinterpret_cast<T*>(&storage)); }
+  };
+
+  static size_t round_up_to_power_of_two(size_t value)
+  {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<size_t> tail_{ 0 };
+  alignas(64) std::atomic<size_t> head_{ 0 };
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_MPMCRING_HPP_
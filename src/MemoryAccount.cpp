@@ -0,0 +1,69 @@
+/**
+ * @file MemoryAccount.cpp MemoryAccount class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "MemoryAccount.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace dunedaq {
+namespace afv1_example {
+
+MemoryAccount&
+MemoryAccount::get(Kind kind, const std::string& name)
+{
+  // accounts are never destroyed, since messages may be recorded against them until the process exits
+  static std::mutex registryMutex;
+  static auto* registry = new std::map<std::pair<Kind, std::string>, std::unique_ptr<MemoryAccount>>();
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto& account = (*registry)[std::make_pair(kind, name)];
+  if (account == nullptr) {
+    account.reset(new MemoryAccount(kind, name));
+  }
+  return *account;
+}
+
+MemoryAccount::MemoryAccount(Kind kind, const std::string& name)
+  : kind_(kind)
+  , name_(name)
+{}
+
+MemoryAccount::Statistics
+MemoryAccount::get_statistics() const
+{
+  Statistics stats;
+  stats.allocatedBytes = allocatedBytes_.load(std::memory_order_relaxed);
+  stats.receivedBytes = receivedBytes_.load(std::memory_order_relaxed);
+  int64_t live = liveBytes_.load(std::memory_order_relaxed);
+  stats.liveBytes = live > 0 ? static_cast<uint64_t>(live) : 0;
+  stats.peakBytes = static_cast<uint64_t>(peakBytes_.load(std::memory_order_relaxed));
+  return stats;
+}
+
+std::ostream&
+operator<<(std::ostream& t, const MemoryAccount::Statistics& stats)
+{
+  constexpr double MB = 1024.0 * 1024.0;
+  return t << stats.liveBytes / MB << " MB live (peak " << stats.peakBytes / MB << " MB), "
+           << stats.allocatedBytes / MB << " MB allocated and " << stats.receivedBytes / MB
+           << " MB received in total";
+}
+
+std::ostream&
+operator<<(std::ostream& t, const MemoryAccount& account)
+{
+  return t << (account.get_kind() == MemoryAccount::Kind::kModule ? "module \"" : "queue \"")
+           << account.get_name() << "\": " << account.get_statistics();
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,124 @@
+/**
+ * @file MemoryAccount.hpp
+ *
+ * MemoryAccount keeps track of the bytes of list messages that are held by
+ * one module, or that are waiting in one queue, so that the memory use of a
+ * pipeline can be broken down by where the lists are.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_MEMORYACCOUNT_HPP_
+#define AFV1_EXAMPLE_SRC_MEMORYACCOUNT_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief MemoryAccount counts the bytes that a module or a queue has allocated or received,
+ * the bytes that it holds now, and the most that it has held at once.
+ *
+ * The modules record what happens to the messages that pass through them: a module that creates
+ * a message records an allocation, a message that is pushed onto a queue is received by the
+ * queue's account, and one that is popped is released by the queue and received by the module
+ * that popped it, which releases it again once it has passed it on or dropped it. The bytes of a
+ * message are its memory_footprint(): the message itself plus the pool buffers that it refers to.
+ * A buffer that is shared by several messages is counted once for each of them, so the accounts
+ * show what each module and queue keeps alive rather than adding up to the memory in use.
+ *
+ * Accounts are looked up by kind and name with get(), so that a queue has the same account in
+ * the module that pushes onto it and in the one that pops from it; they live until the process
+ * exits, and their counters continue across runs.
+ */
+class MemoryAccount
+{
+public:
+  enum class Kind
+  {
+    kModule,
+    kQueue
+  };
+
+  struct Statistics
+  {
+    uint64_t allocatedBytes = 0; ///< Bytes of messages and buffers created by the module
+    uint64_t receivedBytes = 0;  ///< Bytes of messages taken over from another account
+    uint64_t liveBytes = 0;      ///< Bytes held now
+    uint64_t peakBytes = 0;      ///< Most bytes held at once
+  };
+
+  /**
+   * @brief Returns the account of the module or queue with the given name, creating it if necessary
+   */
+  static MemoryAccount& get(Kind kind, const std::string& name);
+
+  MemoryAccount(Kind kind, const std::string& name);
+
+  MemoryAccount(const MemoryAccount&) = delete;
+  MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+  Kind get_kind() const { return kind_; }
+  const std::string& get_name() const { return name_; }
+
+  void record_allocation(size_t bytes)
+  {
+    allocatedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+    add_live(bytes);
+  }
+
+  void record_receipt(size_t bytes)
+  {
+    receivedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+    add_live(bytes);
+  }
+
+  void record_release(size_t bytes) { liveBytes_.fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed); }
+
+  Statistics get_statistics() const;
+
+private:
+  void add_live(size_t bytes)
+  {
+    int64_t live = liveBytes_.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed) + static_cast<int64_t>(bytes);
+    int64_t peak = peakBytes_.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+  }
+
+  const Kind kind_;
+  const std::string name_;
+  std::atomic<uint64_t> allocatedBytes_{ 0 };
+  std::atomic<uint64_t> receivedBytes_{ 0 };
+  // a message may be popped from a queue before the pushing thread has finished recording it,
+  // so the live count of a queue can be briefly negative
+  std::atomic<int64_t> liveBytes_{ 0 };
+  std::atomic<int64_t> peakBytes_{ 0 };
+};
+
+/**
+ * @brief Format the statistics of a MemoryAccount to a stream
+ * @param t ostream Instance
+ * @param stats Statistics to format
+ * @return ostream Instance
+ */
+std::ostream&
+operator<<(std::ostream& t, const MemoryAccount::Statistics& stats);
+
+/**
+ * @brief Format the kind, name and statistics of a MemoryAccount to a stream
+ */
+std::ostream&
+operator<<(std::ostream& t, const MemoryAccount& account);
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_MEMORYACCOUNT_HPP_
@@ -0,0 +1,137 @@
+/**
+ * @file QueueCapacityCalibration.cpp QueueCapacityCalibration class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "QueueCapacityCalibration.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace dunedaq {
+namespace afv1_example {
+
+QueueCapacityCalibration::QueueCapacityCalibration(double targetMessagesPerSecond)
+  : targetMessagesPerSecond_(targetMessagesPerSecond)
+{}
+
+void
+QueueCapacityCalibration::start()
+{
+  for (auto* occupancy : QueueOccupancy::get_attached()) {
+    occupancy->reset_statistics();
+  }
+}
+
+std::vector<QueueCapacityRecommendation>
+QueueCapacityCalibration::recommend() const
+{
+  std::vector<QueueCapacityRecommendation> recommendations;
+  for (auto* occupancy : QueueOccupancy::get_attached()) {
+    recommendations.push_back(recommend(occupancy->get_name(), occupancy->get_statistics()));
+  }
+  return recommendations;
+}
+
+QueueCapacityRecommendation
+QueueCapacityCalibration::recommend(const std::string& queueName, const QueueOccupancy::Statistics& stats) const
+{
+  QueueCapacityRecommendation recommendation;
+  recommendation.queueName = queueName;
+  recommendation.queueKind = stats.kind;
+  recommendation.currentCapacity = stats.capacity;
+  if (stats.sampledSeconds <= 0 || stats.pushCount == 0) {
+    recommendation.recommendedCapacity = stats.capacity;
+    recommendation.reason = "nothing was pushed during calibration";
+    return recommendation;
+  }
+  recommendation.messagesPerSecond = static_cast<double>(stats.pushCount) / stats.sampledSeconds;
+
+  // summed over the pushers, so with several of them the share can exceed 1
+  double blockedShare = stats.pushSeconds / stats.sampledSeconds;
+  double fullShare = stats.fullSeconds / stats.sampledSeconds;
+  double emptyShare = stats.emptySeconds / stats.sampledSeconds;
+  bool targetMet = targetMessagesPerSecond_ <= 0 || recommendation.messagesPerSecond >= targetMessagesPerSecond_;
+  size_t usedCapacity = std::max<size_t>(stats.capacity, stats.highWaterMark);
+  std::ostringstream reason;
+  reason << std::fixed << std::setprecision(1);
+  if (blockedShare < BLOCKED_SHARE_LIMIT) {
+    recommendation.recommendedCapacity =
+      std::max(MIN_CAPACITY, static_cast<size_t>(std::ceil(HEADROOM * static_cast<double>(stats.highWaterMark))));
+    reason << "rarely blocked its pushers, so sized to the high-water mark of " << stats.highWaterMark
+           << " with headroom";
+    if (!targetMet) {
+      reason << "; the throughput target was missed, but not because of this queue";
+    }
+  } else if (targetMet) {
+    recommendation.recommendedCapacity = usedCapacity;
+    reason << "blocked its pushers " << 100 * blockedShare << "% of the time, but the throughput target was met";
+  } else if (emptyShare >= EMPTY_SHARE_LIMIT) {
+    recommendation.recommendedCapacity = std::max(MIN_CAPACITY, GROWTH_FACTOR * usedCapacity);
+    reason << "blocked its pushers " << 100 * blockedShare << "% of the time, and was empty " << 100 * emptyShare
+           << "% of it, so bursts overflow it, and a larger queue should raise the throughput";
+  } else {
+    recommendation.recommendedCapacity = usedCapacity;
+    reason << "blocked its pushers " << 100 * blockedShare << "% of the time, and was full " << 100 * fullShare
+           << "% and rarely empty, so the stage that pops from it limits the throughput, "
+              "which a larger queue would not raise";
+  }
+  recommendation.reason = reason.str();
+  return recommendation;
+}
+
+void
+QueueCapacityCalibration::write(const std::string& path, const std::vector<QueueCapacityRecommendation>& recommendations)
+{
+  nlohmann::json queues = nlohmann::json::object();
+  nlohmann::json moduleQueues = nlohmann::json::object();
+  for (auto& recommendation : recommendations) {
+    if (recommendation.queueKind.empty()) {
+      queues[recommendation.queueName]["capacity"] = recommendation.recommendedCapacity;
+    } else {
+      nlohmann::json& reference = moduleQueues[recommendation.queueName];
+      reference["name"] = recommendation.queueName;
+      reference["kind"] = recommendation.queueKind;
+      reference["capacity"] = recommendation.recommendedCapacity;
+    }
+  }
+  nlohmann::json document;
+  document["queues"] = queues;
+  document["moduleQueues"] = moduleQueues;
+  std::ofstream out(path);
+  out << document.dump(2) << std::endl;
+  if (!out) {
+    throw std::runtime_error("Could not write queue capacities to " + path);
+  }
+}
+
+std::ostream&
+operator<<(std::ostream& t, const QueueCapacityRecommendation& recommendation)
+{
+  auto flags = t.flags();
+  auto precision = t.precision();
+  t << "queue \"" << recommendation.queueName << "\": capacity " << recommendation.recommendedCapacity << " (now ";
+  if (recommendation.currentCapacity > 0) {
+    t << recommendation.currentCapacity;
+  } else {
+    t << "not known";
+  }
+  t << ", " << std::fixed << std::setprecision(1) << recommendation.messagesPerSecond
+    << " messages/s pushed): " << recommendation.reason;
+  t.flags(flags);
+  t.precision(precision);
+  return t;
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,113 @@
+/**
+ * @file QueueCapacityCalibration.hpp
+ *
+ * QueueCapacityCalibration works out, from the occupancy of each queue
+ * over a short run, the smallest capacity with which the queue would not
+ * hold back the throughput of the pipeline.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_QUEUECAPACITYCALIBRATION_HPP_
+#define AFV1_EXAMPLE_SRC_QUEUECAPACITYCALIBRATION_HPP_
+
+#include "QueueOccupancy.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief The capacity that calibration recommends for one queue, and why
+ */
+struct QueueCapacityRecommendation
+{
+  std::string queueName;
+  std::string queueKind;      ///< Of the queues of this package; empty for an appfwk queue
+  size_t currentCapacity = 0; ///< 0 if not known, as for appfwk queues
+  size_t recommendedCapacity = 0;
+  double messagesPerSecond = 0; ///< Pushed onto the queue during calibration
+  std::string reason;
+};
+
+/**
+ * @brief QueueCapacityCalibration starts the statistics of every attached queue afresh, and
+ * after the pipeline has run for a while recommends a capacity for each of them.
+ *
+ * Whether a queue held back the stages that push onto it is judged from the share of the time that
+ * they spent in push calls, which is nearly all time spent waiting for room, rather than from the
+ * share of the samples in which the queue was full, which misses the times that it fills for less
+ * than a sample interval. A queue whose pushers were rarely blocked is sized to its high-water
+ * mark, with some headroom, since any more capacity is memory that was never used. A queue whose
+ * pushers were often blocked, while the throughput target was missed, is grown if it was also
+ * often empty, since it is then overflowed by bursts that it could have absorbed; if it was rarely
+ * empty, the stage that pops from it is the one that limits the throughput, and a larger queue
+ * would not help, so its capacity is kept.
+ */
+class QueueCapacityCalibration
+{
+public:
+  static constexpr size_t MIN_CAPACITY = 2;
+  static constexpr double HEADROOM = 1.25; ///< Capacity over the high-water mark of a queue that rarely blocked
+  static constexpr double BLOCKED_SHARE_LIMIT = 0.01; ///< Share of the time in push calls beyond which a queue
+                                                      ///< counts as blocking the stages that push onto it
+  static constexpr double EMPTY_SHARE_LIMIT = 0.05;   ///< Share of the time beyond which a queue counts as often empty
+  static constexpr size_t GROWTH_FACTOR = 2;
+
+  /**
+   * @param targetMessagesPerSecond The throughput that each queue should carry, or 0 for as much
+   * as the pipeline manages
+   */
+  explicit QueueCapacityCalibration(double targetMessagesPerSecond);
+
+  /**
+   * @brief Starts the statistics of every attached queue afresh
+   */
+  void start();
+
+  /**
+   * @brief Recommends capacities for every attached queue, from the statistics since start()
+   */
+  std::vector<QueueCapacityRecommendation> recommend() const;
+
+  /**
+   * @brief Recommends a capacity for one queue from its statistics
+   */
+  QueueCapacityRecommendation recommend(const std::string& queueName, const QueueOccupancy::Statistics& stats) const;
+
+  /**
+   * @brief Writes the recommended capacities to a file; throws std::runtime_error if the file can
+   * not be written.
+   *
+   * Those of appfwk queues are written in the form of the "queues" section of an application's
+   * configuration, with only the capacity of each queue, to be merged into that section. The
+   * queues of this package take their capacity from the modules' references to them instead, so
+   * theirs are written under "moduleQueues", as the queue reference, e.g.
+   * { "name": "primaryDataQueue", "kind": "MPMCListQueue", "capacity": 320 }, whose capacity is to
+   * replace the one in the modules' references to that queue.
+   */
+  static void write(const std::string& path, const std::vector<QueueCapacityRecommendation>& recommendations);
+
+private:
+  double targetMessagesPerSecond_;
+};
+
+/**
+ * @brief Format a QueueCapacityRecommendation to a stream
+ * @param t ostream Instance
+ * @param recommendation QueueCapacityRecommendation to format
+ * @return ostream Instance
+ */
+std::ostream&
+operator<<(std::ostream& t, const QueueCapacityRecommendation& recommendation);
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_QUEUECAPACITYCALIBRATION_HPP_
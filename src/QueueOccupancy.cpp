@@ -0,0 +1,280 @@
+/**
+ * @file QueueOccupancy.cpp QueueOccupancy class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "QueueOccupancy.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace dunedaq {
+namespace afv1_example {
+
+namespace {
+
+/**
+ * @brief The occupancies, and the thread that samples them while any probe is attached
+ */
+struct Registry
+{
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<QueueOccupancy>> occupancies;
+  size_t probeCount = 0;
+  std::thread sampler;
+  std::shared_ptr<bool> stopSampler; ///< The stop flag of the running sampler thread
+  std::condition_variable wakeSampler;
+};
+
+// occupancies are never destroyed, since the ends of queues may record against them until the process exits
+Registry&
+registry()
+{
+  static auto* theRegistry = new Registry();
+  return *theRegistry;
+}
+
+void
+run_sampler(std::shared_ptr<bool> stop)
+{
+  Registry& reg = registry();
+  std::unique_lock<std::mutex> lock(reg.mutex);
+  auto nextSampleTime = std::chrono::steady_clock::now();
+  while (!*stop) {
+    nextSampleTime += QueueOccupancy::SAMPLE_INTERVAL;
+    // a sampler that falls behind skips the samples that it has missed, rather than catching up
+    nextSampleTime = std::max(nextSampleTime, std::chrono::steady_clock::now());
+    reg.wakeSampler.wait_until(lock, nextSampleTime, [&] { return *stop; });
+    if (*stop) {
+      break;
+    }
+    lock.unlock();
+    QueueOccupancy::sample_all();
+    lock.lock();
+  }
+}
+
+} // namespace
+
+QueueOccupancy&
+QueueOccupancy::get(const std::string& name)
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  auto& occupancy = reg.occupancies[name];
+  if (occupancy == nullptr) {
+    occupancy.reset(new QueueOccupancy(name));
+  }
+  return *occupancy;
+}
+
+std::vector<QueueOccupancy*>
+QueueOccupancy::get_attached()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  std::vector<QueueOccupancy*> attached;
+  for (auto& entry : reg.occupancies) {
+    if (!entry.second->probes_.empty()) {
+      attached.push_back(entry.second.get());
+    }
+  }
+  return attached;
+}
+
+QueueOccupancy::QueueOccupancy(const std::string& name)
+  : name_(name)
+{}
+
+QueueOccupancy::Attachment
+QueueOccupancy::attach(Probe probe)
+{
+  Registry& reg = registry();
+  std::thread finishedSampler;
+  Attachment attachment;
+  {
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    probes_.push_back(std::move(probe));
+    attachment.occupancy_ = this;
+    attachment.probe_ = std::prev(probes_.end());
+    if (reg.probeCount++ == 0) {
+      // a sampler that was stopped by the last detachment may not have been joined yet
+      finishedSampler = std::move(reg.sampler);
+      reg.stopSampler = std::make_shared<bool>(false);
+      reg.sampler = std::thread(run_sampler, reg.stopSampler);
+    }
+  }
+  if (finishedSampler.joinable()) {
+    finishedSampler.join();
+  }
+  return attachment;
+}
+
+QueueOccupancy::Attachment::Attachment(Attachment&& other) noexcept
+  : occupancy_(other.occupancy_)
+  , probe_(other.probe_)
+{
+  other.occupancy_ = nullptr;
+}
+
+QueueOccupancy::Attachment&
+QueueOccupancy::Attachment::operator=(Attachment&& other) noexcept
+{
+  if (this != &other) {
+    detach();
+    occupancy_ = other.occupancy_;
+    probe_ = other.probe_;
+    other.occupancy_ = nullptr;
+  }
+  return *this;
+}
+
+void
+QueueOccupancy::Attachment::detach()
+{
+  if (occupancy_ == nullptr) {
+    return;
+  }
+  Registry& reg = registry();
+  std::thread finishedSampler;
+  {
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    occupancy_->probes_.erase(probe_);
+    if (occupancy_->probes_.empty()) {
+      // the time until the queue is attached again is not sampled
+      occupancy_->hasLastSample_ = false;
+    }
+    if (--reg.probeCount == 0) {
+      *reg.stopSampler = true;
+      reg.wakeSampler.notify_all();
+      finishedSampler = std::move(reg.sampler);
+    }
+  }
+  if (finishedSampler.joinable()) {
+    finishedSampler.join();
+  }
+  occupancy_ = nullptr;
+}
+
+void
+QueueOccupancy::sample_all()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  auto now = std::chrono::steady_clock::now();
+  for (auto& entry : reg.occupancies) {
+    if (!entry.second->probes_.empty()) {
+      entry.second->sample(now);
+    }
+  }
+}
+
+void
+QueueOccupancy::sample(std::chrono::steady_clock::time_point now)
+{
+  std::function<size_t()> depthProbe;
+  std::function<bool()> fullProbe;
+  size_t capacity = 0;
+  std::string kind;
+  for (auto& probe : probes_) {
+    if (!depthProbe && probe.depth) {
+      depthProbe = probe.depth;
+    }
+    if (!fullProbe && probe.isFull) {
+      fullProbe = probe.isFull;
+    }
+    capacity = std::max(capacity, probe.capacity);
+    if (kind.empty()) {
+      kind = probe.kind;
+    }
+  }
+  size_t depth;
+  if (depthProbe) {
+    depth = depthProbe();
+  } else {
+    int64_t counted = countedDepth_.load(std::memory_order_relaxed);
+    depth = counted > 0 ? static_cast<size_t>(counted) : 0;
+  }
+  bool isFull = fullProbe ? fullProbe() : capacity > 0 && depth >= capacity;
+
+  // the state that the queue is found in is taken to have lasted since the previous sample
+  if (hasLastSample_) {
+    double elapsed = std::chrono::duration<double>(now - lastSampleTime_).count();
+    stats_.sampledSeconds += elapsed;
+    if (isFull) {
+      stats_.fullSeconds += elapsed;
+    }
+    if (depth == 0) {
+      stats_.emptySeconds += elapsed;
+    }
+  }
+  lastSampleTime_ = now;
+  hasLastSample_ = true;
+  stats_.depth = depth;
+  stats_.capacity = capacity;
+  stats_.kind = kind;
+}
+
+QueueOccupancy::Statistics
+QueueOccupancy::get_statistics() const
+{
+  Statistics stats;
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    stats = stats_;
+  }
+  stats.highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+  stats.pushCount = pushCount_.load(std::memory_order_relaxed);
+  stats.pushSeconds = 1e-9 * static_cast<double>(pushNanoseconds_.load(std::memory_order_relaxed));
+  return stats;
+}
+
+void
+QueueOccupancy::reset_statistics()
+{
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  // the messages that are already in the queue count towards the new high-water mark
+  highWaterMark_.store(stats_.depth, std::memory_order_relaxed);
+  stats_ = Statistics();
+  hasLastSample_ = false;
+  pushCount_.store(0, std::memory_order_relaxed);
+  pushNanoseconds_.store(0, std::memory_order_relaxed);
+}
+
+std::ostream&
+operator<<(std::ostream& t, const QueueOccupancy::Statistics& stats)
+{
+  auto percent = [&](double seconds) { return stats.sampledSeconds > 0 ? 100.0 * seconds / stats.sampledSeconds : 0.0; };
+  auto flags = t.flags();
+  auto precision = t.precision();
+  t << stats.depth;
+  if (stats.capacity > 0) {
+    t << " of " << stats.capacity;
+  }
+  t << " queued (high-water mark " << stats.highWaterMark << "), full " << std::fixed << std::setprecision(1)
+    << percent(stats.fullSeconds) << "% and empty " << percent(stats.emptySeconds) << "% of "
+    << std::setprecision(2) << stats.sampledSeconds << " s sampled, " << stats.pushCount << " pushed in "
+    << stats.pushSeconds << " s of push calls";
+  t.flags(flags);
+  t.precision(precision);
+  return t;
+}
+
+std::ostream&
+operator<<(std::ostream& t, const QueueOccupancy& occupancy)
+{
+  return t << "queue \"" << occupancy.get_name() << "\": " << occupancy.get_statistics();
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,198 @@
+/**
+ * @file QueueOccupancy.hpp
+ *
+ * QueueOccupancy keeps track of how full each queue is over time, so that
+ * the stage that holds up a pipeline can be found: the queue in front of it
+ * is mostly full, and the one behind it mostly empty.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_QUEUEOCCUPANCY_HPP_
+#define AFV1_EXAMPLE_SRC_QUEUEOCCUPANCY_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief QueueOccupancy samples the depth of a queue at regular intervals, and counts the time
+ * that the queue spent full and empty. The greatest depth that the queue reached is taken from
+ * the depth after each push instead, since a burst that is popped between two samples is missed.
+ *
+ * The ends of a queue attach a Probe, which tells the sampler how to look at the queue, and keep
+ * it attached for as long as they exist; one sampler thread, which runs while any probe is
+ * attached, samples every attached queue once every SAMPLE_INTERVAL. The queues of this package
+ * report their own depth. For an appfwk queue, the depth is the number of pushes less the number
+ * of pops that its ends record, and the queue counts as full while its sink can not push.
+ *
+ * The ends of every queue also record how many messages were pushed, and how long the push calls
+ * took, which is nearly all time spent waiting for room; QueueCapacityCalibration works out
+ * capacities from these.
+ *
+ * Like MemoryAccounts, occupancies are looked up by the name of the queue with get(), live until
+ * the process exits, and continue across runs unless reset_statistics() is called.
+ */
+class QueueOccupancy
+{
+public:
+  static constexpr std::chrono::milliseconds SAMPLE_INTERVAL{ 1 };
+
+  struct Statistics
+  {
+    uint64_t depth = 0;         ///< Messages in the queue at the latest sample
+    uint64_t capacity = 0;      ///< 0 if not known
+    std::string kind;           ///< Of the queues of this package; empty for an appfwk queue
+    uint64_t highWaterMark = 0; ///< Most messages seen in the queue at once
+    double fullSeconds = 0;
+    double emptySeconds = 0;
+    double sampledSeconds = 0; ///< Time during which the queue was sampled
+    uint64_t pushCount = 0;    ///< Messages pushed
+    double pushSeconds = 0;    ///< Time spent in push calls, summed over the pushers
+  };
+
+  /**
+   * @brief How the sampler looks at a queue; either function may be left empty
+   */
+  struct Probe
+  {
+    std::function<size_t()> depth; ///< Without it, the pushes less the pops that were recorded
+    std::function<bool()> isFull;  ///< Without it, whether the depth has reached the capacity
+    size_t capacity = 0;           ///< 0 if not known
+    std::string kind;              ///< Of the queues of this package; empty for an appfwk queue
+  };
+
+  /**
+   * @brief Keeps a probe attached to a queue, and the sampler running, until it is destroyed
+   */
+  class Attachment
+  {
+  public:
+    Attachment() = default;
+    ~Attachment() { detach(); }
+    Attachment(Attachment&& other) noexcept;
+    Attachment& operator=(Attachment&& other) noexcept;
+    Attachment(const Attachment&) = delete;
+    Attachment& operator=(const Attachment&) = delete;
+
+  private:
+    friend class QueueOccupancy;
+    void detach();
+
+    QueueOccupancy* occupancy_ = nullptr;
+    std::list<Probe>::iterator probe_;
+  };
+
+  /**
+   * @brief Returns the occupancy of the queue with the given name, creating it if necessary
+   */
+  static QueueOccupancy& get(const std::string& name);
+
+  /**
+   * @brief Returns the occupancies of the queues that have ends attached, in order of name
+   */
+  static std::vector<QueueOccupancy*> get_attached();
+
+  explicit QueueOccupancy(const std::string& name);
+
+  QueueOccupancy(const QueueOccupancy&) = delete;
+  QueueOccupancy& operator=(const QueueOccupancy&) = delete;
+
+  const std::string& get_name() const { return name_; }
+
+  Attachment attach(Probe probe);
+
+  /**
+   * @brief Records that count messages were pushed, onto a queue whose depth is counted
+   */
+  void record_push(size_t count)
+  {
+    int64_t depth = countedDepth_.fetch_add(static_cast<int64_t>(count), std::memory_order_relaxed) +
+                    static_cast<int64_t>(count);
+    pushCount_.fetch_add(count, std::memory_order_relaxed);
+    raise_high_water_mark(depth > 0 ? static_cast<uint64_t>(depth) : 0);
+  }
+  /**
+   * @brief Records that count messages were pushed, onto a queue that reports its own depth,
+   * which was depth after the push
+   */
+  void record_push(size_t count, size_t depth)
+  {
+    countedDepth_.fetch_add(static_cast<int64_t>(count), std::memory_order_relaxed);
+    pushCount_.fetch_add(count, std::memory_order_relaxed);
+    raise_high_water_mark(depth);
+  }
+  void record_pop(size_t count) { countedDepth_.fetch_sub(static_cast<int64_t>(count), std::memory_order_relaxed); }
+  void record_push_time(std::chrono::steady_clock::duration duration)
+  {
+    pushNanoseconds_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+                               std::memory_order_relaxed);
+  }
+
+  Statistics get_statistics() const;
+
+  /**
+   * @brief Starts the statistics afresh, other than the depth that is counted from pushes and pops
+   */
+  void reset_statistics();
+
+  /**
+   * @brief Takes a sample of every attached queue; called by the sampler thread
+   */
+  static void sample_all();
+
+private:
+  void sample(std::chrono::steady_clock::time_point now);
+
+  void raise_high_water_mark(uint64_t depth)
+  {
+    uint64_t mark = highWaterMark_.load(std::memory_order_relaxed);
+    while (depth > mark && !highWaterMark_.compare_exchange_weak(mark, depth, std::memory_order_relaxed)) {
+    }
+  }
+
+  const std::string name_;
+  // a message may be popped before the push that brought it has been recorded, so the counted
+  // depth can be briefly negative
+  std::atomic<int64_t> countedDepth_{ 0 };
+  std::atomic<uint64_t> pushCount_{ 0 };
+  std::atomic<int64_t> pushNanoseconds_{ 0 };
+  std::atomic<uint64_t> highWaterMark_{ 0 };
+
+  // the rest is guarded by the registry's mutex
+  std::list<Probe> probes_;
+  Statistics stats_;
+  std::chrono::steady_clock::time_point lastSampleTime_; ///< Of the latest sample while attached
+  bool hasLastSample_ = false;
+};
+
+/**
+ * @brief Format the statistics of a QueueOccupancy to a stream
+ * @param t ostream Instance
+ * @param stats Statistics to format
+ * @return ostream Instance
+ */
+std::ostream&
+operator<<(std::ostream& t, const QueueOccupancy::Statistics& stats);
+
+/**
+ * @brief Format the name and statistics of a QueueOccupancy to a stream
+ */
+std::ostream&
+operator<<(std::ostream& t, const QueueOccupancy& occupancy);
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_QUEUEOCCUPANCY_HPP_
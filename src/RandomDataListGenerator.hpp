@@ -12,12 +12,24 @@
 #ifndef AFV1_EXAMPLE_SRC_RANDOMDATALISTGENERATOR_HPP_
 #define AFV1_EXAMPLE_SRC_RANDOMDATALISTGENERATOR_HPP_
 
+#include "IssueStormLimiter.hpp"
+#include "ListBatch.hpp"
+#include "ListBufferPool.hpp"
+#include "ListElement.hpp"
+#include "ListMessage.hpp"
+#include "ListQueue.hpp"
+#include "ListRopeMessage.hpp"
+#include "MemoryAccount.hpp"
+#include "QueueCapacityCalibration.hpp"
+#include "QueueOccupancy.hpp"
+#include "StopSignal.hpp"
+
 #include "appfwk/DAQModule.hpp"
-#include "appfwk/DAQSink.hpp"
 #include "appfwk/ThreadHelper.hpp"
 
 #include <ers/Issue.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,12 +38,26 @@ namespace dunedaq {
 namespace afv1_example {
 
 /**
- * @brief RandomDataListGenerator creates vectors of ints and writes
- * them to the configured output queues.
+ * @brief RandomDataListGenerator creates lists of random elements of type T, as single lists,
+ * ListBatches or ListRopeMessages, and writes them to the configured output queues.
+ *
+ * The module is a template on the type of the list elements; each explicit instantiation is
+ * registered as a module type of its own (RandomDataListGenerator for int,
+ * RandomDataListGeneratorUInt16, ...).
+ *
+ * When calibrationMsec is set, the generator also calibrates the capacities of the queues of the
+ * process: it starts their occupancy statistics afresh when it starts, and once the pipeline has
+ * run for that long, it reports the capacity that it recommends for each queue, given a target of
+ * calibrationTargetRate messages per second, and writes them to calibrationOutputFile if that is set.
  */
+template<typename T>
 class RandomDataListGenerator : public dunedaq::appfwk::DAQModule
 {
 public:
+  using message_t = ListMessage<T>;
+  using batch_t = ListBatch<T>;
+  using rope_message_t = ListRopeMessage<T>;
+
   /**
    * @brief RandomDataListGenerator Constructor
    * @param name Instance name for this RandomDataListGenerator instance
@@ -58,20 +84,75 @@ private:
 
   // Threading
   dunedaq::appfwk::ThreadHelper thread_;
+  StopSignal stopSignal_; ///< Raised by do_stop(), to wake the worker thread out of its waits
   void do_work(std::atomic<bool>&);
 
+  /**
+   * @brief Pushes a message onto each of the given output queues, retrying each push until it
+   * succeeds or the module is stopped
+   * @param reportSuppressedIssues Called between retries, so that summaries of suppressed issues
+   * are still reported while a push is retried
+   * @param droppedCount Incremented for each queue that dropped the message, as it can never hold it
+   * @return The number of queues that the message was pushed onto
+   */
+  template<typename Message>
+  size_t push_to_outputs(std::vector<std::unique_ptr<ListQueueSink<Message>>>& outputQueues,
+                         const Message& message,
+                         size_t& droppedCount,
+                         std::atomic<bool>& running_flag,
+                         IssueStormLimiter& pushTimeoutLimiter,
+                         const std::function<void(bool)>& reportSuppressedIssues);
+
   // Configuration defaults
   const size_t REASONABLE_DEFAULT_INTSPERLIST = 4;
   const size_t REASONABLE_DEFAULT_MSECBETWEENSENDS = 1000;
+  const uint32_t REASONABLE_DEFAULT_STREAMID = 0;
+  const uint32_t REASONABLE_DEFAULT_PRIORITY = 0; ///< Bulk data
+  const size_t REASONABLE_DEFAULT_DEADLINEMSEC = 0; ///< No deadline
+  const bool REASONABLE_DEFAULT_COMPUTECHECKSUMS = false;
+  const std::string REASONABLE_DEFAULT_BUFFERPOOLNAME = "default";
+  const size_t REASONABLE_DEFAULT_LISTSPERBATCH = 0;
+  const size_t REASONABLE_DEFAULT_ROPECHUNKSIZE = 0;
+  const size_t REASONABLE_DEFAULT_INFLIGHTBYTELIMIT = 0; ///< No limit
+  const size_t REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS = 10000;
+  const size_t REASONABLE_DEFAULT_CALIBRATIONMSEC = 0; ///< No calibration
+  const double REASONABLE_DEFAULT_CALIBRATIONTARGETRATE = 0; ///< As many messages per second as the pipeline manages
+  const std::string REASONABLE_DEFAULT_CALIBRATIONOUTPUTFILE = ""; ///< Only report the recommendations
 
   // Configuration
-  std::vector<std::unique_ptr<dunedaq::appfwk::DAQSink<std::vector<int>>>> outputQueues_;
+  size_t listsPerBatch_ = REASONABLE_DEFAULT_LISTSPERBATCH; ///< When non-zero, lists are sent in ListBatches of this size
+  std::vector<std::unique_ptr<ListQueueSink<message_t>>> outputQueues_;
+  std::vector<std::unique_ptr<ListQueueSink<batch_t>>> batchOutputQueues_;
+  size_t ropeChunkSize_ = REASONABLE_DEFAULT_ROPECHUNKSIZE; ///< When non-zero, lists are sent as ropes with chunks of this size
+  std::vector<std::unique_ptr<ListQueueSink<rope_message_t>>> ropeOutputQueues_;
   std::chrono::milliseconds queueTimeout_;
   size_t nIntsPerList_ = REASONABLE_DEFAULT_INTSPERLIST;
   size_t waitBetweenSendsMsec_ = REASONABLE_DEFAULT_MSECBETWEENSENDS;
+  uint32_t streamId_ = REASONABLE_DEFAULT_STREAMID;
+  uint32_t priority_ = REASONABLE_DEFAULT_PRIORITY; ///< Set in the header of every message, to choose its queue lane
+  std::chrono::milliseconds deadline_{ REASONABLE_DEFAULT_DEADLINEMSEC }; ///< After its creation; when non-zero, stages drop lists that are older
+  bool computeChecksums_ = REASONABLE_DEFAULT_COMPUTECHECKSUMS;
+  ListBufferPool* bufferPool_ = &ListBufferPool::get(REASONABLE_DEFAULT_BUFFERPOOLNAME);
+  size_t inlineListThreshold_ = message_t::payload_t::INLINE_CAPACITY; ///< Longer lists are stored in pool buffers
+  std::chrono::milliseconds memoryReportInterval_{ REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS };
+  std::chrono::milliseconds calibrationInterval_{ REASONABLE_DEFAULT_CALIBRATIONMSEC };
+  double calibrationTargetRate_ = REASONABLE_DEFAULT_CALIBRATIONTARGETRATE;
+  std::string calibrationOutputFile_ = REASONABLE_DEFAULT_CALIBRATIONOUTPUTFILE;
+
+  // Memory accounting
+  MemoryAccount* memoryAccount_;
+  std::vector<MemoryAccount*> outputQueueAccounts_; ///< One for each output queue, in the same order
+  std::vector<QueueOccupancy*> outputQueueOccupancies_; ///< Likewise
 };
 } // namespace afv1_example
 
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       CalibrationOutputWarning,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The recommended queue capacities could not be written: " << reason,
+                       ((std::string)name),
+                       ((std::string)reason))
+
 ERS_DECLARE_ISSUE_BASE(afv1_example,
                        NoOutputQueuesAvailableWarning,
                        appfwk::GeneralDAQModuleIssue,
@@ -81,4 +162,6 @@ ERS_DECLARE_ISSUE_BASE(afv1_example,
 
 } // namespace dunedaq
 
+#include "detail/RandomDataListGenerator.hxx"
+
 #endif // AFV1_EXAMPLE_SRC_RANDOMDATALISTGENERATOR_HPP_
@@ -0,0 +1,22 @@
+/**
+ * @file RandomDataListGeneratorUInt16.cpp RandomDataListGenerator class
+ * instantiation for lists of uint16_t, registered as module type RandomDataListGeneratorUInt16
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "RandomDataListGenerator.hpp"
+
+#include <cstdint>
+
+namespace dunedaq {
+namespace afv1_example {
+
+template class RandomDataListGenerator<uint16_t>;
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+DEFINE_DUNE_DAQ_MODULE(dunedaq::afv1_example::RandomDataListGenerator<uint16_t>)
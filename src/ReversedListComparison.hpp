@@ -0,0 +1,191 @@
+/**
+ * @file ReversedListComparison.hpp
+ *
+ * ReversedListComparison contains the comparison core that is used to check
+ * that one list is the reverse of another, along with the bounded-size
+ * ListMismatchReport that describes how two lists differ when they do not match.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_REVERSEDLISTCOMPARISON_HPP_
+#define AFV1_EXAMPLE_SRC_REVERSEDLISTCOMPARISON_HPP_
+
+#include "ListElement.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief Checks whether the reversed list holds the same elements as the original list,
+ * in the opposite order. The reversed list is read back-to-front, so it does not need
+ * to be re-reversed (or copied) before the comparison.
+ */
+template<typename T>
+bool
+is_reverse_of(const T* original, size_t originalLength, const T* reversed, size_t reversedLength)
+{
+  if (originalLength != reversedLength) {
+    return false;
+  }
+  const T* revPtr = reversed + reversedLength;
+  for (size_t idx = 0; idx < originalLength; ++idx) {
+    if (!(original[idx] == *--revPtr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Checks whether one contiguous container (e.g. std::vector) holds the reverse of another
+ */
+template<typename Container>
+bool
+is_reverse_of(const Container& original, const Container& reversed)
+{
+  return is_reverse_of(original.data(), original.size(), reversed.data(), reversed.size());
+}
+
+/**
+ * @brief Initial value of the hash computed by hash_list()
+ */
+constexpr uint64_t LIST_HASH_INITIAL_VALUE = 14695981039346656037ULL;
+
+/**
+ * @brief Computes a 64-bit FNV-1a hash of the bytes of a list, visiting the elements
+ * either front-to-back or back-to-front. Passing the hash of one list as the initial
+ * value continues that hash, so several lists can be hashed as if they were one.
+ */
+template<typename T>
+uint64_t
+hash_list(const T* data, size_t length, bool backToFront = false, uint64_t hash = LIST_HASH_INITIAL_VALUE)
+{
+  for (size_t idx = 0; idx < length; ++idx) {
+    const T& element = backToFront ? data[length - 1 - idx] : data[idx];
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &element, sizeof(T));
+    for (unsigned char b : bytes) {
+      hash ^= b;
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+/**
+ * @brief ListMismatchReport is a structured, bounded-size description of the differences
+ * between an original list and the list that was expected to be its reverse.
+ *
+ * At most maxReportedDifferences differing positions are stored, regardless of the
+ * length of the lists, so building and formatting a report takes a single pass over
+ * the data and a fixed amount of memory.
+ */
+template<typename T>
+struct ListMismatchReport
+{
+  /**
+   * @brief One position at which the lists differ. The index is given in the order of
+   * the original list; reversedValue is the element that the reversed list holds for it.
+   */
+  struct Difference
+  {
+    size_t index;
+    T originalValue;
+    T reversedValue;
+  };
+
+  static constexpr size_t DEFAULT_MAX_REPORTED_DIFFERENCES = 8;
+
+  size_t originalLength = 0;
+  size_t reversedLength = 0;
+  size_t differenceCount = 0; ///< Total number of differing positions within the common length
+  std::vector<Difference> firstDifferences;
+  uint64_t originalHash = 0;
+  uint64_t reversedHash = 0; ///< Hash of the reversed list read back-to-front, comparable to originalHash
+};
+
+/**
+ * @brief Builds a ListMismatchReport for an original list and its (supposedly) reversed copy
+ */
+template<typename T>
+ListMismatchReport<T>
+make_mismatch_report(const T* original,
+                     size_t originalLength,
+                     const T* reversed,
+                     size_t reversedLength,
+                     size_t maxReportedDifferences = ListMismatchReport<T>::DEFAULT_MAX_REPORTED_DIFFERENCES)
+{
+  ListMismatchReport<T> report;
+  report.originalLength = originalLength;
+  report.reversedLength = reversedLength;
+  report.firstDifferences.reserve(maxReportedDifferences);
+
+  size_t commonLength = originalLength < reversedLength ? originalLength : reversedLength;
+  for (size_t idx = 0; idx < commonLength; ++idx) {
+    const T& revValue = reversed[reversedLength - 1 - idx];
+    if (!(original[idx] == revValue)) {
+      if (report.firstDifferences.size() < maxReportedDifferences) {
+        report.firstDifferences.push_back({ idx, original[idx], revValue });
+      }
+      ++report.differenceCount;
+    }
+  }
+
+  report.originalHash = hash_list(original, originalLength);
+  report.reversedHash = hash_list(reversed, reversedLength, true);
+  return report;
+}
+
+template<typename Container, typename T = typename Container::value_type>
+ListMismatchReport<T>
+make_mismatch_report(const Container& original,
+                     const Container& reversed,
+                     size_t maxReportedDifferences = ListMismatchReport<T>::DEFAULT_MAX_REPORTED_DIFFERENCES)
+{
+  return make_mismatch_report(
+    original.data(), original.size(), reversed.data(), reversed.size(), maxReportedDifferences);
+}
+
+/**
+ * @brief Format a ListMismatchReport to a stream
+ * @param t ostream Instance
+ * @param report Report to format
+ * @return ostream Instance
+ */
+template<typename T>
+std::ostream&
+operator<<(std::ostream& t, const ListMismatchReport<T>& report)
+{
+  t << "original length " << report.originalLength << ", reversed length " << report.reversedLength << ", "
+    << report.differenceCount << " differing position(s)";
+  if (!report.firstDifferences.empty()) {
+    t << ", first differences {";
+    bool first = true;
+    for (auto& diff : report.firstDifferences) {
+      if (!first)
+        t << ", ";
+      first = false;
+      t << "[" << diff.index << "]: ";
+      format_list_element(t, diff.originalValue);
+      t << " vs ";
+      format_list_element(t, diff.reversedValue);
+    }
+    t << "}";
+  }
+  return t << ", original hash 0x" << std::hex << report.originalHash << ", reversed hash 0x" << report.reversedHash
+           << std::dec;
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_REVERSEDLISTCOMPARISON_HPP_
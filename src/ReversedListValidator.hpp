@@ -14,12 +14,20 @@
 #ifndef AFV1_EXAMPLE_SRC_REVERSEDLISTVALIDATOR_HPP_
 #define AFV1_EXAMPLE_SRC_REVERSEDLISTVALIDATOR_HPP_
 
+#include "ListBatch.hpp"
+#include "ListMessage.hpp"
+#include "ListQueue.hpp"
+#include "ListRopeMessage.hpp"
+#include "MemoryAccount.hpp"
+#include "StopSignal.hpp"
+
 #include "appfwk/DAQModule.hpp"
-#include "appfwk/DAQSource.hpp"
 #include "appfwk/ThreadHelper.hpp"
 
 #include <ers/Issue.h>
 
+#include <deque>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -30,10 +38,19 @@ namespace afv1_example {
 /**
  * @brief ReversedListValidator reads lists of integers from two queues
  * and verifies that the lists have the same data, but stored in reverse order.
+ *
+ * The module is a template on the type of the list elements; each explicit instantiation is
+ * registered as a module type of its own (ReversedListValidator for int,
+ * ReversedListValidatorUInt16, ...).
  */
+template<typename T>
 class ReversedListValidator : public dunedaq::appfwk::DAQModule
 {
 public:
+  using message_t = ListMessage<T>;
+  using batch_t = ListBatch<T>;
+  using rope_message_t = ListRopeMessage<T>;
+
   /**
    * @brief ReversedListValidator Constructor
    * @param name Instance name for this ReversedListValidator instance
@@ -58,22 +75,101 @@ private:
 
   // Threading
   dunedaq::appfwk::ThreadHelper thread_;
+  StopSignal stopSignal_; ///< Raised by do_stop(), to wake the worker thread out of its waits
   void do_work(std::atomic<bool>&);
 
+  /**
+   * @brief The body of do_work() for one kind of message: ListMessages, ListBatches in batch mode,
+   * or ListRopeMessages in rope mode. Without an original data queue, the reversed lists are only
+   * checked against the checksums that they carry.
+   */
+  template<typename Message>
+  void process_messages(std::atomic<bool>& running_flag,
+                        ListQueueSource<Message>& reversedDataQueue,
+                        ListQueueSource<Message>* originalDataQueue);
+
+  static bool contents_are_reversed(const message_t& original, const message_t& reversed);
+  static std::string describe_mismatch(const message_t& original, const message_t& reversed);
+
+  static bool same_list_boundaries(const batch_t& original, const batch_t& reversed);
+
+  /**
+   * @brief Checks that two batches have the same list boundaries, and that each list of the
+   * reversed batch holds the elements of the corresponding original list in reverse order
+   */
+  static bool contents_are_reversed(const batch_t& original, const batch_t& reversed);
+  static std::string describe_mismatch(const batch_t& original, const batch_t& reversed);
+
+  static bool contents_are_reversed(const rope_message_t& original, const rope_message_t& reversed);
+  static std::string describe_mismatch(const rope_message_t& original, const rope_message_t& reversed);
+
+  /**
+   * @brief Original lists of a stream that are held while waiting for their reversed copies;
+   * beyond this, the oldest are counted as unpaired
+   */
+  static constexpr size_t MAX_PENDING_ORIGINALS_PER_STREAM = 1024;
+
+  // Configuration defaults
+  const size_t REASONABLE_DEFAULT_MSECBETWEENLATENCYREPORTS = 10000;
+  const bool REASONABLE_DEFAULT_BATCHMODE = false;
+  const bool REASONABLE_DEFAULT_ROPEMODE = false;
+  const size_t REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS = 10000;
+
   // Configuration
-  std::unique_ptr<dunedaq::appfwk::DAQSource<std::vector<int>>> reversedDataQueue_;
-  std::unique_ptr<dunedaq::appfwk::DAQSource<std::vector<int>>> originalDataQueue_;
+  bool batchMode_ = REASONABLE_DEFAULT_BATCHMODE; ///< Whether the queues carry ListBatches instead of ListMessages
+  std::unique_ptr<ListQueueSource<message_t>> reversedDataQueue_;
+  std::unique_ptr<ListQueueSource<message_t>> originalDataQueue_;
+  std::unique_ptr<ListQueueSource<batch_t>> reversedBatchQueue_;
+  std::unique_ptr<ListQueueSource<batch_t>> originalBatchQueue_;
+  bool ropeMode_ = REASONABLE_DEFAULT_ROPEMODE; ///< Whether the queues carry ListRopeMessages instead of ListMessages
+  std::unique_ptr<ListQueueSource<rope_message_t>> reversedRopeQueue_;
+  std::unique_ptr<ListQueueSource<rope_message_t>> originalRopeQueue_;
   std::chrono::milliseconds queueTimeout_;
+  std::chrono::milliseconds latencyReportInterval_;
+  std::string captureFilePrefix_;
+  size_t captureCount_ = 0;
+  std::chrono::milliseconds memoryReportInterval_{ REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS };
+
+  // Memory accounting
+  MemoryAccount* memoryAccount_;
+  MemoryAccount* reversedQueueAccount_ = nullptr;
+  MemoryAccount* originalQueueAccount_ = nullptr;
 };
 } // namespace afv1_example
 
 ERS_DECLARE_ISSUE_BASE(afv1_example,
                        DataMismatchError,
                        appfwk::GeneralDAQModuleIssue,
-                       "Data mismatch when validating lists: doubly-reversed list contents = " << revContents << ", original list contents = " << origContents,
+                       "Data mismatch when validating lists: " << mismatchReport,
+                       ((std::string)name),
+                       ((std::string)mismatchReport))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       ChecksumMismatchError,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The checksum carried by list " << sequenceNumber << " from stream " << streamId
+                                                       << " does not match its contents.",
                        ((std::string)name),
-                       ((std::string)revContents)((std::string)origContents))
+                       ((uint32_t)streamId)((uint64_t)sequenceNumber))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       UnorderedInputsWarning,
+                       appfwk::GeneralDAQModuleIssue,
+                       "The reversed and original lists of each stream are paired up in the order in which they arrive, but queue \""
+                         << queueName << "\" is shared with other modules, so lists that arrive out of order will "
+                         << "have no partner. Leave out original_data_input to check the reversed lists against their checksums instead.",
+                       ((std::string)name),
+                       ((std::string)queueName))
+
+ERS_DECLARE_ISSUE_BASE(afv1_example,
+                       CaptureFileError,
+                       appfwk::GeneralDAQModuleIssue,
+                       "Recording of lists to capture files has been stopped: " << reason,
+                       ((std::string)name),
+                       ((std::string)reason))
 
 } // namespace dunedaq
 
+#include "detail/ReversedListValidator.hxx"
+
 #endif // AFV1_EXAMPLE_SRC_REVERSEDLISTVALIDATOR_HPP_
@@ -0,0 +1,22 @@
+/**
+ * @file ReversedListValidatorUInt64.cpp ReversedListValidator class
+ * instantiation for lists of uint64_t, registered as module type ReversedListValidatorUInt64
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ReversedListValidator.hpp"
+
+#include <cstdint>
+
+namespace dunedaq {
+namespace afv1_example {
+
+template class ReversedListValidator<uint64_t>;
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+DEFINE_DUNE_DAQ_MODULE(dunedaq::afv1_example::ReversedListValidator<uint64_t>)
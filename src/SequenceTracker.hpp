@@ -0,0 +1,182 @@
+/**
+ * @file SequenceTracker.hpp
+ *
+ * SequenceTracker follows the sequence numbers of the lists received on
+ * one input and counts the lists that went missing, arrived late, or
+ * were received more than once.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_SEQUENCETRACKER_HPP_
+#define AFV1_EXAMPLE_SRC_SEQUENCETRACKER_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief SequenceTracker checks per-stream sequence numbers for gaps and duplicates.
+ *
+ * For each stream, the highest sequence number seen so far and a 64-entry window of
+ * the sequence numbers just below it are kept. A number above the highest one opens
+ * a gap for everything in between; a number inside the window either fills part of a
+ * gap (a late arrival) or is a duplicate. A number that is far below the window is taken
+ * to mean that the stream was restarted, and the tracker resynchronizes to it.
+ */
+class SequenceTracker
+{
+public:
+  enum class Result
+  {
+    kInOrder,         ///< The next expected sequence number
+    kGap,             ///< One or more sequence numbers were skipped
+    kLate,            ///< Fills a previously-counted gap
+    kDuplicate,       ///< Already received
+    kStale,           ///< Too far below the window to tell late arrivals from duplicates
+    kResynchronized   ///< First number on a stream, or the stream was restarted
+  };
+
+  struct Counters
+  {
+    uint64_t received = 0;
+    uint64_t missing = 0;     ///< Currently-unfilled gap positions
+    uint64_t late = 0;
+    uint64_t duplicates = 0;
+    uint64_t stale = 0;
+    uint64_t resyncs = 0;
+  };
+
+  static constexpr uint64_t WINDOW_SIZE = 64;
+  static constexpr uint64_t DEFAULT_RESYNC_DISTANCE = 1 << 16;
+
+  explicit SequenceTracker(uint64_t resyncDistance = DEFAULT_RESYNC_DISTANCE)
+    : resyncDistance_(resyncDistance)
+  {}
+
+  /**
+   * @brief Checks one received sequence number
+   * @param gapSize If non-null, receives the number of skipped sequence numbers for kGap
+   */
+  Result check(uint32_t streamId, uint64_t sequenceNumber, uint64_t* gapSize = nullptr)
+  {
+    ++counters_.received;
+    StreamState* state = lastState_;
+    if (state == nullptr || lastStreamId_ != streamId) {
+      auto iter = streams_.find(streamId);
+      if (iter == streams_.end()) {
+        streams_[streamId] = StreamState{ sequenceNumber, 1 };
+        cache(streamId);
+        return Result::kResynchronized;
+      }
+      state = &iter->second;
+      lastStreamId_ = streamId;
+      lastState_ = state;
+    }
+
+    if (sequenceNumber > state->highest) {
+      uint64_t advance = sequenceNumber - state->highest;
+      state->window = advance >= WINDOW_SIZE ? 1 : ((state->window << advance) | 1);
+      state->highest = sequenceNumber;
+      if (advance == 1) {
+        return Result::kInOrder;
+      }
+      counters_.missing += advance - 1;
+      if (gapSize != nullptr) {
+        *gapSize = advance - 1;
+      }
+      return Result::kGap;
+    }
+
+    uint64_t offset = state->highest - sequenceNumber;
+    if (offset >= resyncDistance_) {
+      *state = StreamState{ sequenceNumber, 1 };
+      ++counters_.resyncs;
+      return Result::kResynchronized;
+    }
+    if (offset >= WINDOW_SIZE) {
+      ++counters_.stale;
+      return Result::kStale;
+    }
+    uint64_t bit = 1ULL << offset;
+    if (state->window & bit) {
+      ++counters_.duplicates;
+      return Result::kDuplicate;
+    }
+    state->window |= bit;
+    ++counters_.late;
+    if (counters_.missing > 0) {
+      --counters_.missing;
+    }
+    return Result::kLate;
+  }
+
+  /**
+   * @brief Forgets the state of all streams; the next number on each stream is accepted as-is
+   */
+  void resynchronize()
+  {
+    streams_.clear();
+    lastState_ = nullptr;
+  }
+
+  /**
+   * @brief Forgets the state of one stream
+   */
+  void resynchronize(uint32_t streamId)
+  {
+    streams_.erase(streamId);
+    lastState_ = nullptr;
+  }
+
+  const Counters& counters() const { return counters_; }
+
+  void reset()
+  {
+    resynchronize();
+    counters_ = Counters();
+  }
+
+private:
+  struct StreamState
+  {
+    uint64_t highest;
+    uint64_t window; ///< Bit N set means highest-N has been received
+  };
+
+  void cache(uint32_t streamId)
+  {
+    lastStreamId_ = streamId;
+    lastState_ = &streams_[streamId];
+  }
+
+  uint64_t resyncDistance_;
+  std::unordered_map<uint32_t, StreamState> streams_;
+  uint32_t lastStreamId_ = 0;
+  StreamState* lastState_ = nullptr;
+  Counters counters_;
+};
+
+/**
+ * @brief Format the counters of a SequenceTracker to a stream
+ * @param t ostream Instance
+ * @param counters Counters to format
+ * @return ostream Instance
+ */
+inline std::ostream&
+operator<<(std::ostream& t, const SequenceTracker::Counters& counters)
+{
+  return t << counters.received << " received, " << counters.missing << " missing, " << counters.late << " late, "
+           << counters.duplicates << " duplicate, " << counters.stale << " stale, " << counters.resyncs
+           << " resynchronization(s)";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_SEQUENCETRACKER_HPP_
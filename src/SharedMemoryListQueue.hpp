@@ -0,0 +1,396 @@
+/**
+ * @file SharedMemoryListQueue.hpp
+ *
+ * SharedMemoryListQueue carries list messages between processes on the
+ * same host through a SharedMemoryRing, so that the modules of a pipeline
+ * can run in processes of their own.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_SHAREDMEMORYLISTQUEUE_HPP_
+#define AFV1_EXAMPLE_SRC_SHAREDMEMORYLISTQUEUE_HPP_
+
+#include "ListBufferPool.hpp"
+#include "ListMessageCodec.hpp"
+#include "ListQueueBase.hpp"
+#include "SharedMemoryRing.hpp"
+
+#include <ers/ers.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dunedaq {
+
+ERS_DECLARE_ISSUE(afv1_example,
+                  MessageTooLargeForSlot,
+                  "A message of " << messageBytes << " bytes does not fit in the " << slotBytes
+                                  << "-byte slots of shared-memory queue " << queueName << ", and was dropped.",
+                  ((std::string)queueName)((size_t)messageBytes)((size_t)slotBytes))
+
+ERS_DECLARE_ISSUE(afv1_example,
+                  UndecodableSharedMemoryMessage,
+                  "A message in shared-memory queue " << queueName << " could not be decoded, and was dropped.",
+                  ((std::string)queueName))
+
+ERS_DECLARE_ISSUE(afv1_example,
+                  SharedMemorySlotsSkipped,
+                  count << " slot(s) of shared-memory queue " << queueName << " were held by another process for more than "
+                        << timeoutMsec << " ms, presumably one that died, and were skipped.",
+                  ((std::string)queueName)((size_t)count)((int64_t)timeoutMsec))
+
+ERS_DECLARE_ISSUE(afv1_example,
+                  SharedMemorySlotTakenBack,
+                  "A slot of shared-memory queue " << queueName << " was held by this process for more than " << timeoutMsec
+                                                   << " ms and was taken back by another, so its message was dropped.",
+                  ((std::string)queueName)((int64_t)timeoutMsec))
+
+namespace afv1_example {
+
+/**
+ * @brief SharedMemoryListQueue is a ListQueueBase whose messages are encoded with their
+ * ListMessageCodec into the slots of a SharedMemoryRing by the pushing process, and read back out
+ * of them, into buffers from a pool, by the popping one.
+ *
+ * Each slot holds one message, so the slots must be large enough for the largest message; a
+ * message that does not fit is reported and dropped, and counted as dropped by push_n(). There is no primitive to sleep on that is
+ * shared with the other processes, so a push or pop that has to wait polls the ring, with pauses
+ * that grow from a few microseconds up to a millisecond. The messages that are pushed can be
+ * compressed, which lets larger lists fit in the slots at the cost of the time spent compressing;
+ * the popping process reads any compression. Slots that a process that died left claimed are
+ * skipped after SharedMemoryRing::CLAIM_TIMEOUT, and reported.
+ *
+ * The payload of an uncompressed ListMessage can also be placed in a slot before it is filled in,
+ * with place_payload(), so that pushing it copies nothing: the slot is claimed when the payload is
+ * placed, the push records the header, and the frame is completed around the elements and
+ * published when the last reference to the payload is dropped. The slot is held until then, so the
+ * payload must be dropped well within CLAIM_TIMEOUT; one that is dropped without being pushed is
+ * published empty, and skipped by the popping process.
+ */
+template<typename Message>
+class SharedMemoryListQueue : public ListQueueBase<Message>
+{
+public:
+  using value_type = typename ListQueueBase<Message>::value_type;
+  using duration_type = typename ListQueueBase<Message>::duration_type;
+
+  /**
+   * @param capacity Number of slots, or 0 for those of an existing segment (or a default)
+   * @param slotBytes Size of a slot, or 0 for that of an existing segment (or a default)
+   * @param pool The pool that popped messages take their buffers from
+   * @param compression The compression of the messages that are pushed
+   */
+  SharedMemoryListQueue(const std::string& name,
+                        size_t capacity,
+                        size_t slotBytes,
+                        ListBufferPool* pool,
+                        ListCompression compression = ListCompression::kNone)
+    : ListQueueBase<Message>(name)
+    , ring_(name, capacity, slotBytes, list_message_type_tag<Message>())
+    , pool_(pool)
+    , compression_(compression)
+    , placedPool_(name + ".placed", 0)
+    , placedFrames_(ring_.slot_count())
+  {
+    placedPool_.set_placed_block_handler([this](ListBufferBlock* block) { publish_placed_frame(block); });
+  }
+
+  /**
+   * @brief Creates a payload for size elements in the next free slot, waiting up to the timeout for
+   * one, unless the stop signal, which may be null, is raised first. A message with the payload that
+   * is pushed onto this queue is carried without being copied.
+   * @return An empty payload if the messages are compressed, the elements do not fit in a slot,
+   * or no slot became free
+   */
+  template<typename M = Message>
+  typename M::payload_t place_payload(size_t size, const duration_type& timeout, StopSignal* stopSignal)
+  {
+    static_assert(std::is_same<M, ListMessage<element_t>>::value, "Only the payloads of ListMessages can be placed");
+    size_t elementBytes = codec_detail::padded(size * sizeof(element_t));
+    if (compression_ != ListCompression::kNone || PLACED_ELEMENTS_OFFSET + elementBytes > ring_.slot_bytes()) {
+      return typename M::payload_t();
+    }
+    uint64_t position;
+    SharedMemoryRing::Slot* slot = nullptr;
+    auto attempt = [&] {
+      slot = ring_.begin_push(position);
+      report_skipped_slots();
+      return slot != nullptr;
+    };
+    if (!attempt() && !wait_for(attempt, timeout, stopSignal)) {
+      return typename M::payload_t();
+    }
+    PlacedFrame& frame = placedFrames_[ring_.slot_index(slot)];
+    frame.position = position;
+    frame.isPushed = false;
+    uint8_t* blockMemory = ring_.slot_data(slot) + PLACED_ELEMENTS_OFFSET - sizeof(ListBufferBlock);
+    return M::payload_t::wrap(placedPool_.place<element_t>(blockMemory, size, elementBytes));
+  }
+
+  /**
+   * @brief Pushes a message; throws MessageTooLargeForSlot if it does not fit in a slot
+   */
+  void push(value_type&& val, const duration_type& timeout) override
+  {
+    size_t bytes = 0;
+    PushOutcome outcome = push_one(val, timeout, nullptr, bytes);
+    if (outcome == PushOutcome::kFull) {
+      throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, this->get_name(), "push", timeout.count());
+    }
+    if (outcome == PushOutcome::kTooLarge) {
+      throw MessageTooLargeForSlot(ERS_HERE, this->get_name(), bytes, ring_.slot_bytes());
+    }
+  }
+
+  void pop(value_type& val, const duration_type& timeout) override
+  {
+    if (!try_pop(val) && !wait_for([&] { return try_pop(val); }, timeout, nullptr)) {
+      throw dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, this->get_name(), "pop", timeout.count());
+    }
+  }
+
+  bool can_push() const noexcept override { return ring_.size_approx() < ring_.slot_count(); }
+  bool can_pop() const noexcept override { return ring_.size_approx() > 0; }
+
+  size_t push_n(value_type* values,
+                size_t count,
+                const duration_type& timeout,
+                StopSignal* stopSignal,
+                size_t& droppedCount) override
+  {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t pushed = 0;
+    while (pushed < count) {
+      auto remaining = std::chrono::duration_cast<duration_type>(deadline - std::chrono::steady_clock::now());
+      size_t bytes = 0;
+      PushOutcome outcome = push_one(values[pushed], remaining, stopSignal, bytes);
+      if (outcome == PushOutcome::kFull) {
+        break;
+      }
+      if (outcome == PushOutcome::kTooLarge) {
+        ers::error(MessageTooLargeForSlot(ERS_HERE, this->get_name(), bytes, ring_.slot_bytes()));
+        ++droppedCount;
+      }
+      ++pushed;
+    }
+    return pushed;
+  }
+
+  size_t pop_n(value_type* values, size_t maxCount, const duration_type& timeout, StopSignal* stopSignal) override
+  {
+    if (maxCount == 0 ||
+        (!try_pop(values[0]) && !wait_for([&] { return try_pop(values[0]); }, timeout, stopSignal))) {
+      return 0;
+    }
+    size_t popped = 1;
+    while (popped < maxCount && try_pop(values[popped])) {
+      ++popped;
+    }
+    return popped;
+  }
+
+  bool is_cross_process() const override { return true; }
+
+  const std::string& get_segment_name() const { return ring_.get_segment_name(); }
+  size_t capacity() const override { return ring_.slot_count(); }
+  size_t size_approx() const override { return ring_.size_approx(); }
+  size_t slot_bytes() const { return ring_.slot_bytes(); }
+
+private:
+  enum class PushOutcome
+  {
+    kPushed,
+    kFull,    ///< No slot became free in time
+    kTooLarge ///< The message does not fit in a slot, so it can never be pushed
+  };
+
+  /**
+   * @brief Pushes a message, waiting up to the timeout for a free slot, unless the stop signal,
+   * which may be null, is raised first; bytes is set to its encoded size. The message is described,
+   * and compressed, once, and only the claim of a slot and the copy into it are retried.
+   */
+  PushOutcome push_one(const Message& message, const duration_type& timeout, StopSignal* stopSignal, size_t& bytes)
+  {
+    // the description of the message being pushed, kept from one push to the next to save allocations
+    thread_local std::vector<uint8_t> prefix;
+    thread_local std::vector<ListMessageSpan> bodySpans;
+    if constexpr (std::is_same<Message, ListMessage<element_t>>::value) {
+      if (message.payload.pool() == &placedPool_ && record_placed_push(message, prefix, bodySpans, bytes)) {
+        return PushOutcome::kPushed;
+      }
+    }
+    bytes = describe_list_message(message, prefix, bodySpans, compression_);
+    if (bytes > ring_.slot_bytes()) {
+      return PushOutcome::kTooLarge;
+    }
+    auto attempt = [&] { return try_write(prefix, bodySpans, bytes); };
+    return attempt() || wait_for(attempt, timeout, stopSignal) ? PushOutcome::kPushed : PushOutcome::kFull;
+  }
+
+  /**
+   * @brief Writes a described message into a slot, if there is a free one
+   */
+  bool try_write(const std::vector<uint8_t>& prefix, const std::vector<ListMessageSpan>& bodySpans, size_t bytes)
+  {
+    uint64_t position;
+    SharedMemoryRing::Slot* slot = ring_.begin_push(position);
+    report_skipped_slots();
+    if (slot == nullptr) {
+      return false;
+    }
+    write_list_message(prefix, bodySpans, ring_.slot_data(slot));
+    if (!ring_.end_push(slot, position, bytes)) {
+      ers::warning(SharedMemorySlotTakenBack(ERS_HERE, this->get_name(), SharedMemoryRing::CLAIM_TIMEOUT.count()));
+    }
+    return true;
+  }
+
+  bool try_pop(Message& message)
+  {
+    for (;;) {
+      uint64_t position;
+      SharedMemoryRing::Slot* slot = ring_.begin_pop(position);
+      report_skipped_slots();
+      if (slot == nullptr) {
+        return false;
+      }
+      const SharedMemoryRing::Slot* readSlot = slot;
+      if (ring_.slot_size(readSlot) == 0) {
+        // a placed payload that was dropped without being pushed
+        ring_.end_pop(slot, position);
+        continue;
+      }
+      bool isReadable = read_list_message(ring_.slot_data(readSlot), ring_.slot_size(readSlot), message, pool_);
+      if (!ring_.end_pop(slot, position)) {
+        // a producer may have been writing over the message while it was read
+        ers::warning(SharedMemorySlotTakenBack(ERS_HERE, this->get_name(), SharedMemoryRing::CLAIM_TIMEOUT.count()));
+        message = Message();
+        continue;
+      }
+      if (isReadable) {
+        return true;
+      }
+      // the processes disagree about the layout in a way that the type tag did not catch
+      ers::error(UndecodableSharedMemoryMessage(ERS_HERE, this->get_name()));
+    }
+  }
+
+  /**
+   * @brief Records the push of a message whose payload was placed in a slot, to be published when
+   * the payload is dropped
+   * @return false if the payload has been pushed already, so that the message has to be copied
+   */
+  bool record_placed_push(const Message& message,
+                          std::vector<uint8_t>& prefix,
+                          std::vector<ListMessageSpan>& bodySpans,
+                          size_t& bytes)
+  {
+    auto elements = reinterpret_cast<const uint8_t*>(message.payload.data());
+    uint8_t* data = const_cast<uint8_t*>(elements) - PLACED_ELEMENTS_OFFSET;
+    PlacedFrame& frame = placedFrames_[ring_.slot_index(ring_.data_slot(data))];
+    if (frame.isPushed) {
+      return false;
+    }
+    bytes = describe_list_message(message, prefix, bodySpans, ListCompression::kNone);
+    std::memcpy(frame.prefix, prefix.data(), PLACED_ELEMENTS_OFFSET);
+    frame.bytes = bytes;
+    frame.elementBytes = message.payload.size() * sizeof(element_t);
+    frame.isPushed = true;
+    return true;
+  }
+
+  /**
+   * @brief Completes the frame around a placed payload whose last reference has been dropped, and
+   * publishes it; one that was never pushed is published empty
+   */
+  void publish_placed_frame(ListBufferBlock* block)
+  {
+    uint8_t* data = static_cast<uint8_t*>(block->elements()) - PLACED_ELEMENTS_OFFSET;
+    SharedMemoryRing::Slot* slot = ring_.data_slot(data);
+    PlacedFrame& frame = placedFrames_[ring_.slot_index(slot)];
+    size_t bytes = 0;
+    if (frame.isPushed) {
+      // the block is overwritten by the end of the headers
+      std::memcpy(data, frame.prefix, PLACED_ELEMENTS_OFFSET);
+      std::memset(data + PLACED_ELEMENTS_OFFSET + frame.elementBytes,
+                  0,
+                  frame.bytes - PLACED_ELEMENTS_OFFSET - frame.elementBytes);
+      bytes = frame.bytes;
+      frame.isPushed = false;
+    }
+    if (!ring_.end_push(slot, frame.position, bytes) && bytes > 0) {
+      ers::warning(SharedMemorySlotTakenBack(ERS_HERE, this->get_name(), SharedMemoryRing::CLAIM_TIMEOUT.count()));
+    }
+  }
+
+  void report_skipped_slots()
+  {
+    size_t skipped = ring_.take_skipped_slot_count();
+    if (skipped > 0) {
+      ers::warning(
+        SharedMemorySlotsSkipped(ERS_HERE, this->get_name(), skipped, SharedMemoryRing::CLAIM_TIMEOUT.count()));
+    }
+  }
+
+  template<typename Attempt>
+  bool wait_for(Attempt attempt, const duration_type& timeout, StopSignal* stopSignal)
+  {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::chrono::microseconds pause(2);
+    // a stop is noticed at the latest one pause after it is requested
+    while (std::chrono::steady_clock::now() < deadline && (stopSignal == nullptr || !stopSignal->stop_requested())) {
+      std::this_thread::sleep_for(pause);
+      if (attempt()) {
+        return true;
+      }
+      pause = std::min<std::chrono::microseconds>(2 * pause, std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  using element_t = typename Message::value_type;
+
+  /**
+   * @brief Where the elements of a placed payload start in its slot: after the ListWireHeader, the
+   * ListMessageHeader and the size of an uncompressed ListMessage, with the ListBufferBlock that
+   * holds them in the last bytes of the headers until the frame is published
+   */
+  static constexpr size_t PLACED_ELEMENTS_OFFSET =
+    sizeof(ListWireHeader) + sizeof(ListMessageHeader) + sizeof(uint64_t);
+  static_assert(PLACED_ELEMENTS_OFFSET >= sizeof(ListBufferBlock) &&
+                  (PLACED_ELEMENTS_OFFSET - sizeof(ListBufferBlock)) % alignof(ListBufferBlock) == 0,
+                "A placed payload's ListBufferBlock must fit, aligned, in the headers of its frame");
+
+  /**
+   * @brief The state of a slot that holds a placed payload, which only this process knows about
+   */
+  struct PlacedFrame
+  {
+    uint64_t position = 0;
+    bool isPushed = false;
+    size_t bytes = 0;        ///< Of the frame, once it is pushed
+    size_t elementBytes = 0; ///< Of the elements, without their padding
+    uint8_t prefix[PLACED_ELEMENTS_OFFSET] = {};
+  };
+
+  SharedMemoryRing ring_;
+  ListBufferPool* pool_;
+  ListCompression compression_;
+  ListBufferPool placedPool_;
+  std::vector<PlacedFrame> placedFrames_; ///< By slot index
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_SHAREDMEMORYLISTQUEUE_HPP_
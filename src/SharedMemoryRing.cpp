@@ -0,0 +1,383 @@
+/**
+ * @file SharedMemoryRing.cpp SharedMemoryRing class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "SharedMemoryRing.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dunedaq {
+namespace afv1_example {
+
+namespace {
+
+constexpr uint64_t SEGMENT_MAGIC = 0x4146563152494e47; // "AFV1RING"
+constexpr uint32_t SEGMENT_VERSION = 2;
+constexpr size_t DEFAULT_SLOT_COUNT = 16;
+constexpr size_t DEFAULT_SLOT_BYTES = 1 << 20;
+constexpr auto ATTACH_TIMEOUT = std::chrono::seconds(5);
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the ring's counters must be lock-free to be shared between processes");
+
+size_t
+round_up_to_power_of_two(size_t value)
+{
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+std::string
+segment_name_for(const std::string& name)
+{
+  return "/afv1_example." + name;
+}
+
+std::runtime_error
+system_error(const std::string& what, const std::string& segmentName)
+{
+  return std::runtime_error(what + " shared-memory segment " + segmentName + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+struct SharedMemoryRing::SegmentHeader
+{
+  uint64_t magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t slotCount;
+  uint64_t slotBytes;
+  uint64_t typeTag;
+  std::atomic<uint32_t> initialized; ///< Set by the creating process once the rest is filled in
+  std::atomic<uint32_t> attachCount; ///< Processes that have the segment open; 0 once it is being removed
+  alignas(64) std::atomic<uint64_t> tail;
+  alignas(64) std::atomic<uint64_t> head;
+};
+
+struct alignas(64) SharedMemoryRing::Slot
+{
+  std::atomic<uint64_t> sequence;
+  uint64_t bytes;    ///< Number of bytes of data, which follow the Slot
+};
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name, size_t slotCount, size_t slotBytes, uint64_t typeTag)
+  : segmentName_(segment_name_for(name))
+{
+  // the last process to detach from an existing segment may be about to remove it
+  auto deadline = std::chrono::steady_clock::now() + ATTACH_TIMEOUT;
+  while (!open_segment(slotCount, slotBytes, typeTag)) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      throw std::runtime_error("Shared-memory segment " + segmentName_ +
+                               " is still being removed by the last process that had it open");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+  if (mapping_ != nullptr) {
+    if (header_->attachCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      shm_unlink(segmentName_.c_str());
+    }
+    munmap(mapping_, mappingBytes_);
+  }
+}
+
+bool
+SharedMemoryRing::open_segment(size_t slotCount, size_t slotBytes, uint64_t typeTag)
+{
+  slotCount_ = slotCount == 0 ? 0 : round_up_to_power_of_two(slotCount < 2 ? 2 : slotCount);
+  slotBytes_ = slotBytes;
+
+  int fd = shm_open(segmentName_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  bool isCreator = fd >= 0;
+  if (!isCreator) {
+    if (errno != EEXIST) {
+      throw system_error("Unable to create", segmentName_);
+    }
+    fd = shm_open(segmentName_.c_str(), O_RDWR, 0);
+    if (fd < 0 && errno == ENOENT) {
+      // removed since the attempt to create it
+      return false;
+    }
+    if (fd < 0) {
+      throw system_error("Unable to open", segmentName_);
+    }
+
+    // wait for the creating process to size the segment and fill in its header
+    auto deadline = std::chrono::steady_clock::now() + ATTACH_TIMEOUT;
+    struct stat status;
+    status.st_size = 0;
+    while (fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) < sizeof(SegmentHeader) &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    void* headerMapping = mmap(nullptr, sizeof(SegmentHeader), PROT_READ, MAP_SHARED, fd, 0);
+    if (static_cast<size_t>(status.st_size) < sizeof(SegmentHeader) || headerMapping == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Shared-memory segment " + segmentName_ + " was not set up by the process that created it");
+    }
+    auto* existing = static_cast<SegmentHeader*>(headerMapping);
+    while (existing->initialized.load(std::memory_order_acquire) == 0 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool matches = existing->initialized.load(std::memory_order_acquire) != 0 && existing->magic == SEGMENT_MAGIC &&
+                   existing->version == SEGMENT_VERSION && existing->typeTag == typeTag &&
+                   (slotCount_ == 0 || existing->slotCount == slotCount_) &&
+                   (slotBytes_ == 0 || existing->slotBytes == slotBytes_);
+    if (matches) {
+      slotCount_ = existing->slotCount;
+      slotBytes_ = existing->slotBytes;
+    }
+    munmap(headerMapping, sizeof(SegmentHeader));
+    if (!matches) {
+      close(fd);
+      throw std::runtime_error("Shared-memory segment " + segmentName_ +
+                               " exists with a different layout or message type; remove it from /dev/shm to start afresh");
+    }
+  } else {
+    if (slotCount_ == 0) {
+      slotCount_ = DEFAULT_SLOT_COUNT;
+    }
+    if (slotBytes_ == 0) {
+      slotBytes_ = DEFAULT_SLOT_BYTES;
+    }
+  }
+
+  slotStride_ = sizeof(Slot) + (slotBytes_ + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+  mappingBytes_ = slots_offset() + slotCount_ * slotStride_;
+  if (isCreator && ftruncate(fd, static_cast<off_t>(mappingBytes_)) != 0) {
+    int savedErrno = errno;
+    close(fd);
+    shm_unlink(segmentName_.c_str());
+    errno = savedErrno;
+    throw system_error("Unable to size", segmentName_);
+  }
+  mapping_ = mmap(nullptr, mappingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    if (isCreator) {
+      shm_unlink(segmentName_.c_str());
+    }
+    throw system_error("Unable to map", segmentName_);
+  }
+
+  if (isCreator) {
+    header_ = new (mapping_) SegmentHeader();
+    header_->magic = SEGMENT_MAGIC;
+    header_->version = SEGMENT_VERSION;
+    header_->slotCount = slotCount_;
+    header_->slotBytes = slotBytes_;
+    header_->typeTag = typeTag;
+    header_->attachCount.store(1, std::memory_order_relaxed);
+    header_->tail.store(0, std::memory_order_relaxed);
+    header_->head.store(0, std::memory_order_relaxed);
+    for (size_t idx = 0; idx < slotCount_; ++idx) {
+      Slot* slot = new (slot_at(idx)) Slot();
+      slot->sequence.store(idx, std::memory_order_relaxed);
+    }
+    header_->initialized.store(1, std::memory_order_release);
+    return true;
+  }
+
+  header_ = static_cast<SegmentHeader*>(mapping_);
+  uint32_t attachCount = header_->attachCount.load(std::memory_order_relaxed);
+  do {
+    if (attachCount == 0) {
+      munmap(mapping_, mappingBytes_);
+      mapping_ = nullptr;
+      header_ = nullptr;
+      return false;
+    }
+  } while (!header_->attachCount.compare_exchange_weak(attachCount, attachCount + 1, std::memory_order_acq_rel));
+  return true;
+}
+
+void
+SharedMemoryRing::remove(const std::string& name)
+{
+  shm_unlink(segment_name_for(name).c_str());
+}
+
+size_t
+SharedMemoryRing::slots_offset()
+{
+  return (sizeof(SegmentHeader) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+}
+
+SharedMemoryRing::Slot*
+SharedMemoryRing::slot_at(uint64_t pos) const
+{
+  return reinterpret_cast<Slot*>(static_cast<uint8_t*>(mapping_) + slots_offset() +
+                                 (pos & (slotCount_ - 1)) * slotStride_);
+}
+
+size_t
+SharedMemoryRing::size_approx() const
+{
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  return tail >= head ? tail - head : 0;
+}
+
+SharedMemoryRing::Slot*
+SharedMemoryRing::begin_push(uint64_t& position)
+{
+  uint64_t pos = header_->tail.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot* slot = slot_at(pos);
+    uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+    if (diff == 0) {
+      if (header_->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        position = pos;
+        return slot;
+      }
+    } else if (diff < 0) {
+      // the slot is either waiting to be popped, or popped by a consumer that has not handed it
+      // back yet, and the latter may have died
+      uint64_t popped = pos - slotCount_ + 1;
+      if (seq != popped || header_->head.load(std::memory_order_relaxed) <= pos - slotCount_ ||
+          !pushStall_.has_expired(pos)) {
+        return nullptr;
+      }
+      if (header_->tail.compare_exchange_strong(pos, pos + 1, std::memory_order_relaxed)) {
+        // the slot is this producer's whether the consumer hands it back just now or never does
+        if (slot->sequence.compare_exchange_strong(popped, pos, std::memory_order_acq_rel)) {
+          skippedSlots_.fetch_add(1, std::memory_order_relaxed);
+        }
+        position = pos;
+        return slot;
+      }
+    } else {
+      pos = header_->tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+uint8_t*
+SharedMemoryRing::slot_data(Slot* slot) const
+{
+  return reinterpret_cast<uint8_t*>(slot + 1);
+}
+
+bool
+SharedMemoryRing::end_push(Slot* slot, uint64_t position, size_t bytes)
+{
+  slot->bytes = bytes;
+  return slot->sequence.compare_exchange_strong(
+    position, position + 1, std::memory_order_release, std::memory_order_relaxed);
+}
+
+SharedMemoryRing::Slot*
+SharedMemoryRing::begin_pop(uint64_t& position)
+{
+  uint64_t pos = header_->head.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot* slot = slot_at(pos);
+    uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+    if (diff == 0) {
+      if (header_->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        position = pos;
+        return slot;
+      }
+    } else if (diff < 0) {
+      // the slot is either free, or claimed by a producer that has not published it yet, and the
+      // latter may have died
+      if (seq != pos || header_->tail.load(std::memory_order_relaxed) <= pos || !popStall_.has_expired(pos)) {
+        return nullptr;
+      }
+      if (header_->head.compare_exchange_strong(pos, pos + 1, std::memory_order_relaxed)) {
+        uint64_t claimed = pos;
+        if (!slot->sequence.compare_exchange_strong(claimed, pos + slotCount_, std::memory_order_acq_rel)) {
+          // the producer published the slot just now after all
+          position = pos;
+          return slot;
+        }
+        skippedSlots_.fetch_add(1, std::memory_order_relaxed);
+        ++pos;
+      }
+    } else {
+      pos = header_->head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+const uint8_t*
+SharedMemoryRing::slot_data(const Slot* slot) const
+{
+  return reinterpret_cast<const uint8_t*>(slot + 1);
+}
+
+size_t
+SharedMemoryRing::slot_size(const Slot* slot) const
+{
+  return slot->bytes;
+}
+
+bool
+SharedMemoryRing::end_pop(Slot* slot, uint64_t position)
+{
+  uint64_t published = position + 1;
+  return slot->sequence.compare_exchange_strong(
+    published, position + slotCount_, std::memory_order_release, std::memory_order_relaxed);
+}
+
+SharedMemoryRing::Slot*
+SharedMemoryRing::data_slot(uint8_t* data) const
+{
+  return reinterpret_cast<Slot*>(data) - 1;
+}
+
+size_t
+SharedMemoryRing::slot_index(const Slot* slot) const
+{
+  return static_cast<size_t>(reinterpret_cast<const uint8_t*>(slot) - static_cast<const uint8_t*>(mapping_) -
+                             slots_offset()) /
+         slotStride_;
+}
+
+size_t
+SharedMemoryRing::take_skipped_slot_count()
+{
+  return skippedSlots_.load(std::memory_order_relaxed) == 0 ? 0
+                                                            : skippedSlots_.exchange(0, std::memory_order_relaxed);
+}
+
+bool
+SharedMemoryRing::StallTimer::has_expired(uint64_t pos)
+{
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pos != position_) {
+    position_ = pos;
+    since_ = now;
+    return false;
+  }
+  return now - since_ > CLAIM_TIMEOUT;
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
@@ -0,0 +1,162 @@
+/**
+ * @file SharedMemoryRing.hpp
+ *
+ * SharedMemoryRing is a bounded ring of fixed-size byte slots in a POSIX
+ * shared-memory segment, which processes on the same host can push to and
+ * pop from concurrently.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_SHAREDMEMORYRING_HPP_
+#define AFV1_EXAMPLE_SRC_SHAREDMEMORYRING_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief SharedMemoryRing is an MPMCRing whose slots are byte arrays in a shared-memory segment.
+ *
+ * A push claims a slot with begin_push(), writes up to slot_bytes() bytes into it and publishes it
+ * with end_push(); a pop claims the oldest published slot with begin_pop(), reads it and hands it
+ * back with end_pop(). The segment is created by whichever process opens the ring first, and the
+ * others attach to it; its layout parameters are stored in the segment, and a process that asks
+ * for different ones is refused. The last process to detach removes the segment, and with it any
+ * slots that were not popped; one that is killed before it detaches leaves the segment behind,
+ * for the next processes to attach to, until it is removed with remove() (or from /dev/shm).
+ *
+ * A slot that has been claimed, by a push or a pop, and not been published or handed back after
+ * CLAIM_TIMEOUT is taken to belong to a process that died: the next pop, or push, that is held up
+ * by it skips it, and hands it on to the other side as if it had been finished. Should the
+ * process that claimed it finish after all, end_push() or end_pop() tells it that its slot was
+ * taken.
+ */
+class SharedMemoryRing
+{
+public:
+  struct Slot; // opaque; lives in the segment
+
+  static constexpr std::chrono::milliseconds CLAIM_TIMEOUT{ 1000 };
+
+  /**
+   * @brief Creates or attaches to the segment /afv1_example.<name>. typeTag identifies what the
+   * slots hold, so that processes that disagree about it are refused. A slotCount or slotBytes of
+   * 0 takes the value from the existing segment, or a default when the segment is created. Throws
+   * std::runtime_error if the segment can not be opened, or if it exists with a different layout
+   * or type tag.
+   */
+  SharedMemoryRing(const std::string& name, size_t slotCount, size_t slotBytes, uint64_t typeTag);
+  ~SharedMemoryRing();
+
+  SharedMemoryRing(const SharedMemoryRing&) = delete;
+  SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+  /**
+   * @brief Removes the segment of the given name, if there is one, e.g. one left behind by a
+   * process that was killed; processes that have it open keep using it, and the next ring of that
+   * name gets a new segment
+   */
+  static void remove(const std::string& name);
+
+  const std::string& get_segment_name() const { return segmentName_; }
+  size_t slot_count() const { return slotCount_; }
+  size_t slot_bytes() const { return slotBytes_; }
+
+  /**
+   * @brief Approximate number of published and claimed slots
+   */
+  size_t size_approx() const;
+
+  /**
+   * @brief Claims the next free slot, for the position that is returned in position
+   * @return nullptr if the ring is full
+   */
+  Slot* begin_push(uint64_t& position);
+  uint8_t* slot_data(Slot* slot) const;
+  /**
+   * @brief Publishes a claimed slot holding the given number of bytes
+   * @return false if the slot was held for longer than CLAIM_TIMEOUT and has been skipped, in
+   * which case the bytes are lost
+   */
+  bool end_push(Slot* slot, uint64_t position, size_t bytes);
+
+  /**
+   * @brief Claims the oldest published slot, for the position that is returned in position
+   * @return nullptr if the ring is empty
+   */
+  Slot* begin_pop(uint64_t& position);
+  const uint8_t* slot_data(const Slot* slot) const;
+  size_t slot_size(const Slot* slot) const;
+  /**
+   * @brief Hands a slot that has been read back to the producers
+   * @return false if the slot was held for longer than CLAIM_TIMEOUT and has been taken by a
+   * producer, in which case what was read from it may have been overwritten
+   */
+  bool end_pop(Slot* slot, uint64_t position);
+
+  /**
+   * @brief The slot whose data starts at the given address, and the index of a slot in the ring
+   */
+  Slot* data_slot(uint8_t* data) const;
+  size_t slot_index(const Slot* slot) const;
+
+  /**
+   * @brief The number of slots that this process has skipped since it last asked
+   */
+  size_t take_skipped_slot_count();
+
+private:
+  struct SegmentHeader;
+
+  /**
+   * @brief Times how long the ring has been held up at one position
+   */
+  class StallTimer
+  {
+  public:
+    /**
+     * @brief Whether the ring has been held up at pos for longer than CLAIM_TIMEOUT, as far as
+     * this process has seen
+     */
+    bool has_expired(uint64_t pos);
+
+  private:
+    std::mutex mutex_;
+    uint64_t position_ = UINT64_MAX;
+    std::chrono::steady_clock::time_point since_;
+  };
+
+  /**
+   * @brief Maps and sets up, or checks, the segment; returns false if the segment was being
+   * removed by the last process to detach from it, so that a new one should be created instead
+   */
+  bool open_segment(size_t slotCount, size_t slotBytes, uint64_t typeTag);
+
+  static size_t slots_offset();
+  Slot* slot_at(uint64_t pos) const;
+
+  std::string segmentName_;
+  size_t slotCount_;
+  size_t slotBytes_;
+  size_t slotStride_;
+  size_t mappingBytes_ = 0;
+  void* mapping_ = nullptr;
+  SegmentHeader* header_ = nullptr;
+  StallTimer pushStall_;
+  StallTimer popStall_;
+  std::atomic<size_t> skippedSlots_{ 0 };
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_SHAREDMEMORYRING_HPP_
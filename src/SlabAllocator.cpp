@@ -0,0 +1,399 @@
+/**
+ * @file SlabAllocator.cpp SlabAllocator class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "SlabAllocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace dunedaq {
+namespace afv1_example {
+
+namespace {
+
+/**
+ * @brief Space reserved for the SlabHeader at the start of each slab, so that blocks stay cache-line aligned
+ */
+constexpr size_t SLAB_HEADER_SIZE = 64;
+
+SlabAllocator* g_allocators[SlabAllocator::MAX_ALLOCATORS] = {};
+
+std::atomic<uint64_t> g_nextThreadId{ 1 };
+
+uint64_t
+this_thread_id()
+{
+  thread_local uint64_t id = g_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+// set once a thread's cache has been destroyed, so that blocks freed later on during thread exit bypass it
+thread_local bool t_threadCacheDestroyed = false;
+
+} // namespace
+
+/**
+ * @brief SlabAllocatorThreadCache holds a thread's magazines: a loaded and a previous magazine
+ * for each size class of each allocator. The previous magazine is always either full or empty,
+ * so a thread that alternates between allocating and freeing around a magazine boundary swaps
+ * the two instead of going to the depot every time.
+ */
+struct SlabAllocatorThreadCache
+{
+  using Magazine = SlabAllocator::Magazine;
+
+  struct Slot
+  {
+    Magazine* loaded = nullptr;
+    Magazine* previous = nullptr;
+  };
+
+  std::array<std::array<Slot, SlabAllocator::SIZE_CLASS_COUNT>, SlabAllocator::MAX_ALLOCATORS> slots;
+
+  ~SlabAllocatorThreadCache()
+  {
+    for (size_t idx = 0; idx < SlabAllocator::MAX_ALLOCATORS; ++idx) {
+      for (size_t sizeClass = 0; sizeClass < SlabAllocator::SIZE_CLASS_COUNT; ++sizeClass) {
+        Slot& slot = slots[idx][sizeClass];
+        for (Magazine* magazine : { slot.loaded, slot.previous }) {
+          if (magazine == nullptr) {
+            continue;
+          }
+          if (magazine->count > 0) {
+            g_allocators[idx]->exchange_full_magazine(sizeClass, magazine, false);
+          } else {
+            g_allocators[idx]->exchange_empty_magazine(sizeClass, magazine, false);
+          }
+        }
+      }
+    }
+    t_threadCacheDestroyed = true;
+  }
+};
+
+namespace {
+
+SlabAllocatorThreadCache*
+thread_cache()
+{
+  if (t_threadCacheDestroyed) {
+    return nullptr;
+  }
+  thread_local SlabAllocatorThreadCache cache;
+  return &cache;
+}
+
+} // namespace
+
+SlabAllocator&
+SlabAllocator::get(const std::string& name)
+{
+  // allocators are never destroyed, since blocks from them may be freed at any time until the process exits
+  static std::mutex registryMutex;
+  static auto* registry = new std::map<std::string, std::unique_ptr<SlabAllocator>>();
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto& allocator = (*registry)[name];
+  if (allocator == nullptr) {
+    if (registry->size() > MAX_ALLOCATORS) {
+      registry->erase(name);
+      throw std::length_error("Too many slab allocators; at most " + std::to_string(MAX_ALLOCATORS) +
+                              " can be created");
+    }
+    allocator.reset(new SlabAllocator(name, registry->size() - 1));
+    g_allocators[allocator->index_] = allocator.get();
+  }
+  return *allocator;
+}
+
+SlabAllocator::SlabAllocator(const std::string& name, size_t index)
+  : name_(name)
+  , index_(index)
+{}
+
+size_t
+SlabAllocator::size_class_of(size_t bytes)
+{
+  size_t sizeClass = 0;
+  while (block_size_of(sizeClass) < bytes) {
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+size_t
+SlabAllocator::usable_size(size_t bytes)
+{
+  return bytes > MAX_BLOCK_SIZE ? bytes : block_size_of(size_class_of(bytes));
+}
+
+size_t
+SlabAllocator::rounds_for(size_t sizeClass)
+{
+  // cache about 512 kB per magazine, but no fewer than a handful of blocks
+  return std::max<size_t>(4, std::min<size_t>(MAX_MAGAZINE_ROUNDS, (512 * 1024) / block_size_of(sizeClass)));
+}
+
+void*
+SlabAllocator::allocate(size_t bytes)
+{
+  if (bytes > MAX_BLOCK_SIZE) {
+    largeAllocations_.fetch_add(1, std::memory_order_relaxed);
+    HugePageArena* arena = slabArena_.load(std::memory_order_acquire);
+    if (arena != nullptr) {
+      largeBlocksFromArena_.store(true, std::memory_order_relaxed);
+      return arena->allocate_large(bytes);
+    }
+    return ::operator new(bytes);
+  }
+
+  size_t sizeClass = size_class_of(bytes);
+  sizeClasses_[sizeClass].allocations.fetch_add(1, std::memory_order_relaxed);
+
+  SlabAllocatorThreadCache* cache = thread_cache();
+  if (cache == nullptr) {
+    Magazine* magazine = exchange_empty_magazine(sizeClass, nullptr, true);
+    void* block = magazine->rounds[--magazine->count];
+    if (magazine->count > 0) {
+      exchange_full_magazine(sizeClass, magazine, false);
+    } else {
+      exchange_empty_magazine(sizeClass, magazine, false);
+    }
+    return block;
+  }
+
+  auto& slot = cache->slots[index_][sizeClass];
+  if (slot.loaded == nullptr || slot.loaded->count == 0) {
+    if (slot.previous != nullptr && slot.previous->count > 0) {
+      std::swap(slot.loaded, slot.previous);
+    } else {
+      // hand the empty loaded magazine back and take a non-empty one; the previous magazine stays empty
+      Magazine* empty = slot.previous != nullptr ? slot.loaded : nullptr;
+      if (slot.previous == nullptr) {
+        slot.previous = slot.loaded;
+      }
+      slot.loaded = exchange_empty_magazine(sizeClass, empty, true);
+    }
+  }
+  return slot.loaded->rounds[--slot.loaded->count];
+}
+
+void
+SlabAllocator::deallocate(void* block, size_t bytes)
+{
+  if (block == nullptr) {
+    return;
+  }
+  if (bytes > MAX_BLOCK_SIZE) {
+    largeFrees_.fetch_add(1, std::memory_order_relaxed);
+    // the arena may have been changed since the block was allocated, so it is looked up by address
+    if (!largeBlocksFromArena_.load(std::memory_order_relaxed) || !HugePageArena::deallocate_large(block)) {
+      ::operator delete(block);
+    }
+    return;
+  }
+
+  size_t sizeClass = size_class_of(bytes);
+  SizeClass& cls = sizeClasses_[sizeClass];
+  cls.frees.fetch_add(1, std::memory_order_relaxed);
+  auto* slab = reinterpret_cast<const SlabHeader*>(reinterpret_cast<uintptr_t>(block) & ~(SLAB_SIZE - 1));
+  if (slab->ownerThread != this_thread_id()) {
+    cls.crossThreadFrees.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  SlabAllocatorThreadCache* cache = thread_cache();
+  if (cache == nullptr) {
+    Magazine* magazine = exchange_full_magazine(sizeClass, nullptr, true);
+    magazine->rounds[magazine->count++] = block;
+    exchange_full_magazine(sizeClass, magazine, false);
+    return;
+  }
+
+  auto& slot = cache->slots[index_][sizeClass];
+  if (slot.loaded == nullptr || slot.loaded->count == slot.loaded->capacity) {
+    if (slot.previous != nullptr && slot.previous->count == 0) {
+      std::swap(slot.loaded, slot.previous);
+    } else {
+      // hand the full loaded magazine back and take an empty one; the previous magazine stays full
+      Magazine* full = slot.previous != nullptr ? slot.loaded : nullptr;
+      if (slot.previous == nullptr) {
+        slot.previous = slot.loaded;
+      }
+      slot.loaded = exchange_full_magazine(sizeClass, full, true);
+    }
+  }
+  slot.loaded->rounds[slot.loaded->count++] = block;
+}
+
+SlabAllocator::Magazine*
+SlabAllocator::exchange_empty_magazine(size_t sizeClass, Magazine* empty, bool wantFull)
+{
+  SizeClass& cls = sizeClasses_[sizeClass];
+  std::lock_guard<std::mutex> lock(cls.mutex);
+  if (empty != nullptr) {
+    cls.emptyMagazines.push_back(empty);
+  }
+  if (!wantFull) {
+    return nullptr;
+  }
+  if (!cls.fullMagazines.empty()) {
+    Magazine* full = cls.fullMagazines.back();
+    cls.fullMagazines.pop_back();
+    return full;
+  }
+  Magazine* magazine = take_empty_magazine(cls, sizeClass);
+  carve_blocks(cls, sizeClass, magazine);
+  return magazine;
+}
+
+SlabAllocator::Magazine*
+SlabAllocator::exchange_full_magazine(size_t sizeClass, Magazine* full, bool wantEmpty)
+{
+  SizeClass& cls = sizeClasses_[sizeClass];
+  std::lock_guard<std::mutex> lock(cls.mutex);
+  if (full != nullptr) {
+    cls.fullMagazines.push_back(full);
+  }
+  if (!wantEmpty) {
+    return nullptr;
+  }
+  return take_empty_magazine(cls, sizeClass);
+}
+
+SlabAllocator::Magazine*
+SlabAllocator::take_empty_magazine(SizeClass& cls, size_t sizeClass)
+{
+  if (!cls.emptyMagazines.empty()) {
+    Magazine* magazine = cls.emptyMagazines.back();
+    cls.emptyMagazines.pop_back();
+    return magazine;
+  }
+  auto* magazine = new Magazine;
+  magazine->capacity = static_cast<uint32_t>(rounds_for(sizeClass));
+  return magazine;
+}
+
+void
+SlabAllocator::carve_blocks(SizeClass& cls, size_t sizeClass, Magazine* magazine)
+{
+  const size_t blockSize = block_size_of(sizeClass);
+  const size_t blocksPerSlab = (SLAB_SIZE - SLAB_HEADER_SIZE) / blockSize;
+  while (magazine->count < magazine->capacity) {
+    if (cls.currentSlab == nullptr || cls.nextBlockInSlab == blocksPerSlab) {
+      auto* header = new (allocate_slab()) SlabHeader;
+      header->sizeClass = static_cast<uint32_t>(sizeClass);
+      header->blockCount = static_cast<uint32_t>(blocksPerSlab);
+      header->ownerThread = this_thread_id();
+      cls.currentSlab = reinterpret_cast<char*>(header);
+      cls.nextBlockInSlab = 0;
+      ++cls.slabs;
+      cls.blocksInSlabs += blocksPerSlab;
+    }
+    magazine->rounds[magazine->count++] = cls.currentSlab + SLAB_HEADER_SIZE + cls.nextBlockInSlab * blockSize;
+    ++cls.nextBlockInSlab;
+    ++cls.blocksCarved;
+  }
+}
+
+void
+SlabAllocator::use_huge_pages(HugePageArena::PageSize pageSize)
+{
+  slabArena_.store(pageSize == HugePageArena::PageSize::kNormal ? nullptr : &HugePageArena::get(pageSize),
+                   std::memory_order_release);
+}
+
+bool
+SlabAllocator::request_huge_pages(HugePageArena::PageSize pageSize,
+                                  const std::string& module,
+                                  std::string& decidingModule,
+                                  HugePageArena::PageSize& decidedPageSize)
+{
+  std::lock_guard<std::mutex> lock(hugePageRequestMutex_);
+  if (!hugePageModule_.empty() && hugePageModule_ != module && hugePageSize_ != pageSize) {
+    decidingModule = hugePageModule_;
+    decidedPageSize = hugePageSize_;
+    return false;
+  }
+  if (hugePageModule_.empty()) {
+    hugePageModule_ = module;
+  }
+  hugePageSize_ = pageSize;
+  use_huge_pages(pageSize);
+  return true;
+}
+
+void*
+SlabAllocator::allocate_slab()
+{
+  static_assert(HugePageArena::CHUNK_SIZE == SLAB_SIZE, "Slabs must be exactly one arena chunk");
+  HugePageArena* arena = slabArena_.load(std::memory_order_acquire);
+  if (arena != nullptr) {
+    return arena->allocate_chunk();
+  }
+  void* slab = std::aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+  if (slab == nullptr) {
+    throw std::bad_alloc();
+  }
+  return slab;
+}
+
+SlabAllocator::Statistics
+SlabAllocator::get_statistics() const
+{
+  Statistics stats;
+  for (size_t sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass) {
+    auto& cls = sizeClasses_[sizeClass];
+    auto& classStats = stats.sizeClasses[sizeClass];
+    classStats.blockSize = block_size_of(sizeClass);
+    {
+      std::lock_guard<std::mutex> lock(cls.mutex);
+      classStats.slabs = cls.slabs;
+      classStats.blocksCarved = cls.blocksCarved;
+      classStats.blocksInSlabs = cls.blocksInSlabs;
+    }
+    classStats.allocations = cls.allocations.load(std::memory_order_relaxed);
+    classStats.frees = cls.frees.load(std::memory_order_relaxed);
+    classStats.crossThreadFrees = cls.crossThreadFrees.load(std::memory_order_relaxed);
+  }
+  stats.largeAllocations = largeAllocations_.load(std::memory_order_relaxed);
+  stats.largeFrees = largeFrees_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+std::ostream&
+operator<<(std::ostream& t, const SlabAllocator::Statistics& stats)
+{
+  bool first = true;
+  for (auto& classStats : stats.sizeClasses) {
+    if (classStats.slabs == 0) {
+      continue;
+    }
+    if (!first)
+      t << "; ";
+    first = false;
+    uint64_t live = classStats.allocations >= classStats.frees ? classStats.allocations - classStats.frees : 0;
+    t << classStats.blockSize << "-byte blocks: " << classStats.slabs << " slab(s), " << live << " of "
+      << classStats.blocksInSlabs << " blocks in use ("
+      << (classStats.blocksInSlabs > 0 ? 100.0 * live / classStats.blocksInSlabs : 0.0) << "% occupancy, "
+      << classStats.blocksCarved << " carved), " << classStats.crossThreadFrees << " of " << classStats.frees
+      << " frees cross-thread";
+  }
+  if (first) {
+    t << "no slabs";
+  }
+  return t << "; " << stats.largeAllocations << " large allocation(s), " << stats.largeFrees << " large free(s)";
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
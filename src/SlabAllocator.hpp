@@ -0,0 +1,205 @@
+/**
+ * @file SlabAllocator.hpp
+ *
+ * SlabAllocator is a memory allocator for list payloads that carves large,
+ * aligned slabs into blocks of power-of-two size classes and caches free
+ * blocks in per-thread magazines.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_SLABALLOCATOR_HPP_
+#define AFV1_EXAMPLE_SRC_SLABALLOCATOR_HPP_
+
+#include "HugePageArena.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief SlabAllocator hands out blocks whose sizes are powers of two between MIN_BLOCK_SIZE
+ * and MAX_BLOCK_SIZE; larger requests are passed on to operator new, or to the HugePageArena.
+ *
+ * Memory is obtained in SLAB_SIZE slabs, aligned to SLAB_SIZE, each dedicated to one size class.
+ * Every thread keeps a magazine (a small stack of free blocks) per size class, so allocating and
+ * freeing are normally a few instructions on thread-private data. When a thread's magazine runs
+ * empty or full, it is exchanged with the size class's depot of magazines, under a per-class
+ * mutex; new slabs are only carved when the depot has no blocks left. This matters when one
+ * thread allocates lists and another one frees them: the freeing thread's full magazines flow
+ * back to the allocating thread through the depot, a magazine at a time.
+ *
+ * Slabs come from the C++ heap unless use_huge_pages() has been called, after which new slabs
+ * are taken from a HugePageArena, and so are larger blocks, each in a mapping of its own. Allocators are looked up by name with get(), so that all of
+ * the modules in a process share them; they live until the process exits.
+ */
+class SlabAllocator
+{
+public:
+  static constexpr size_t SLAB_SIZE = 2 * 1024 * 1024;
+  static constexpr unsigned MIN_BLOCK_SHIFT = 6;  // 64 bytes
+  static constexpr unsigned MAX_BLOCK_SHIFT = 17; // 128 kB
+  static constexpr size_t MIN_BLOCK_SIZE = size_t(1) << MIN_BLOCK_SHIFT;
+  static constexpr size_t MAX_BLOCK_SIZE = size_t(1) << MAX_BLOCK_SHIFT;
+  static constexpr size_t SIZE_CLASS_COUNT = MAX_BLOCK_SHIFT - MIN_BLOCK_SHIFT + 1;
+  static constexpr size_t MAX_MAGAZINE_ROUNDS = 64;
+  static constexpr size_t MAX_ALLOCATORS = 8;
+
+  struct SizeClassStatistics
+  {
+    size_t blockSize = 0;
+    uint64_t slabs = 0;
+    uint64_t blocksCarved = 0;   ///< Blocks that have been cut from this class's slabs so far
+    uint64_t blocksInSlabs = 0;  ///< Blocks that this class's slabs can hold in total
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t crossThreadFrees = 0; ///< Frees by a thread other than the one that carved the block's slab
+  };
+
+  struct Statistics
+  {
+    std::array<SizeClassStatistics, SIZE_CLASS_COUNT> sizeClasses;
+    uint64_t largeAllocations = 0;
+    uint64_t largeFrees = 0;
+  };
+
+  /**
+   * @brief Returns the allocator with the given name, creating it if necessary
+   */
+  static SlabAllocator& get(const std::string& name = "default");
+
+  SlabAllocator(const SlabAllocator&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+  const std::string& get_name() const { return name_; }
+
+  /**
+   * @brief Takes slabs that are created from now on, and blocks larger than MAX_BLOCK_SIZE, from
+   * the HugePageArena for the given page size (or from the C++ heap again, for PageSize::kNormal).
+   * Existing slabs and blocks stay where they are.
+   */
+  void use_huge_pages(HugePageArena::PageSize pageSize);
+
+  /**
+   * @brief Calls use_huge_pages() on behalf of a module. The allocator is shared by all the modules
+   * of the process, so the first module to ask decides the page size, and only it can change it
+   * again; a request from another module for a different page size is refused.
+   * @return false if the request was refused, with decidingModule and decidedPageSize set to the
+   * module that decided and the page size that it asked for
+   */
+  bool request_huge_pages(HugePageArena::PageSize pageSize,
+                          const std::string& module,
+                          std::string& decidingModule,
+                          HugePageArena::PageSize& decidedPageSize);
+
+  /**
+   * @brief The arena that new slabs are taken from, or nullptr if they come from the C++ heap
+   */
+  HugePageArena* get_arena() const { return slabArena_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Size of the block that a request for the given number of bytes is served from
+   */
+  static size_t usable_size(size_t bytes);
+
+  /**
+   * @brief Allocates at least the given number of bytes, aligned to 64 bytes for slab blocks
+   * (and to the operator new alignment, or to a huge page, for larger requests)
+   */
+  void* allocate(size_t bytes);
+
+  /**
+   * @brief Frees a block; bytes must be the size that was passed to allocate()
+   */
+  void deallocate(void* block, size_t bytes);
+
+  Statistics get_statistics() const;
+
+private:
+  struct Magazine
+  {
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+    void* rounds[MAX_MAGAZINE_ROUNDS];
+  };
+
+  struct SlabHeader
+  {
+    uint32_t sizeClass;
+    uint32_t blockCount;
+    uint64_t ownerThread; ///< Identifies the thread that carved the slab
+  };
+
+  struct alignas(64) SizeClass
+  {
+    mutable std::mutex mutex;
+    std::vector<Magazine*> fullMagazines; ///< Non-empty magazines, available to any thread
+    std::vector<Magazine*> emptyMagazines;
+    char* currentSlab = nullptr;
+    size_t nextBlockInSlab = 0;
+    uint64_t slabs = 0;
+    uint64_t blocksCarved = 0;
+    uint64_t blocksInSlabs = 0;
+    alignas(64) std::atomic<uint64_t> allocations{ 0 };
+    alignas(64) std::atomic<uint64_t> frees{ 0 };
+    std::atomic<uint64_t> crossThreadFrees{ 0 };
+  };
+
+  friend struct SlabAllocatorThreadCache;
+
+  SlabAllocator(const std::string& name, size_t index);
+
+  static size_t size_class_of(size_t bytes);
+  static size_t block_size_of(size_t sizeClass) { return MIN_BLOCK_SIZE << sizeClass; }
+  static size_t rounds_for(size_t sizeClass);
+
+  /**
+   * @brief Puts an empty magazine (if any) into the depot and, if wantFull, returns a non-empty one,
+   * carving new blocks into it if the depot has none
+   */
+  Magazine* exchange_empty_magazine(size_t sizeClass, Magazine* empty, bool wantFull);
+
+  /**
+   * @brief Puts a non-empty magazine (if any) into the depot and, if wantEmpty, returns an empty one
+   */
+  Magazine* exchange_full_magazine(size_t sizeClass, Magazine* full, bool wantEmpty);
+
+  static Magazine* take_empty_magazine(SizeClass& cls, size_t sizeClass);
+  void carve_blocks(SizeClass& cls, size_t sizeClass, Magazine* magazine);
+  void* allocate_slab();
+
+  std::string name_;
+  size_t index_;
+  std::array<SizeClass, SIZE_CLASS_COUNT> sizeClasses_;
+  std::atomic<HugePageArena*> slabArena_{ nullptr };
+  std::mutex hugePageRequestMutex_;
+  std::string hugePageModule_; ///< The module whose request decided the page size, if any has asked
+  HugePageArena::PageSize hugePageSize_ = HugePageArena::PageSize::kNormal;
+  std::atomic<uint64_t> largeAllocations_{ 0 };
+  std::atomic<uint64_t> largeFrees_{ 0 };
+  std::atomic<bool> largeBlocksFromArena_{ false }; ///< Whether a large block may have to be freed to an arena
+};
+
+/**
+ * @brief Format the statistics of a SlabAllocator to a stream, one entry per size class in use
+ * @param t ostream Instance
+ * @param stats Statistics to format
+ * @return ostream Instance
+ */
+std::ostream&
+operator<<(std::ostream& t, const SlabAllocator::Statistics& stats);
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_SLABALLOCATOR_HPP_
@@ -0,0 +1,57 @@
+/**
+ * @file SlabHugePageSetting.hpp
+ *
+ * The "slabHugePages" setting, which any of the DAQModules in this package
+ * can be configured with, chooses the pages that the list buffers of the
+ * whole process are taken from.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_SLABHUGEPAGESETTING_HPP_
+#define AFV1_EXAMPLE_SRC_SLABHUGEPAGESETTING_HPP_
+
+#include "CommonIssues.hpp"
+#include "HugePageArena.hpp"
+#include "SlabAllocator.hpp"
+
+#include <ers/ers.h>
+#include <nlohmann/json.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief Applies the "slabHugePages" setting of a module's configuration, if it has one, to the
+ * default SlabAllocator, which all the modules of the process share: the first module with the
+ * setting decides, and any other that asks for different pages is warned that it is ignored
+ */
+inline void
+apply_slab_huge_page_setting(const std::string& moduleName, const nlohmann::json& config)
+{
+  if (!config.contains("slabHugePages")) {
+    return;
+  }
+  std::string setting = config["slabHugePages"].get<std::string>();
+  HugePageArena::PageSize pageSize = HugePageArena::PageSize::kNormal;
+  if (!HugePageArena::parse_page_size(setting, pageSize)) {
+    ers::warning(InvalidHugePageSettingWarning(ERS_HERE, moduleName, setting));
+  }
+  std::string decidingModule;
+  HugePageArena::PageSize decidedPageSize;
+  if (!SlabAllocator::get().request_huge_pages(pageSize, moduleName, decidingModule, decidedPageSize)) {
+    std::ostringstream oss_pages;
+    oss_pages << decidedPageSize;
+    ers::warning(ConflictingHugePageSettingWarning(ERS_HERE, moduleName, setting, oss_pages.str(), decidingModule));
+  }
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_SLABHUGEPAGESETTING_HPP_
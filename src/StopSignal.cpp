@@ -0,0 +1,90 @@
+/**
+ * @file StopSignal.cpp StopSignal class implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "StopSignal.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace dunedaq {
+namespace afv1_example {
+
+StopSignal::Listener::Listener(StopSignal* signal, std::mutex& mutex, std::condition_variable& condition)
+  : signal_(signal)
+{
+  if (signal_ != nullptr) {
+    std::lock_guard<std::mutex> lock(signal_->mutex_);
+    entry_ = signal_->listeners_.insert(signal_->listeners_.end(), ListenerEntry{ &mutex, &condition });
+  }
+}
+
+StopSignal::Listener::~Listener()
+{
+  if (signal_ != nullptr) {
+    std::lock_guard<std::mutex> lock(signal_->mutex_);
+    signal_->listeners_.erase(entry_);
+  }
+}
+
+StopSignal::StopSignal()
+  : fd_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+  if (fd_ < 0) {
+    throw std::runtime_error(std::string("Unable to create an eventfd for a stop signal: ") + std::strerror(errno));
+  }
+}
+
+StopSignal::~StopSignal()
+{
+  ::close(fd_);
+}
+
+void
+StopSignal::request_stop()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopRequested_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  // each waiter checks the flag with its mutex held, so taking the mutex here means that it is
+  // either still to check, or already asleep and woken by the notification
+  for (auto& entry : listeners_) {
+    std::lock_guard<std::mutex> listenerLock(*entry.mutex);
+    entry.condition->notify_all();
+  }
+  stopped_.notify_all();
+  uint64_t one = 1;
+  while (::write(fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+}
+
+void
+StopSignal::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t count;
+  while (::read(fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
+  stopRequested_.store(false, std::memory_order_release);
+}
+
+bool
+StopSignal::sleep_for(std::chrono::steady_clock::duration duration)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !stopped_.wait_for(lock, duration, [&] { return stop_requested(); });
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
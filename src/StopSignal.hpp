@@ -0,0 +1,103 @@
+/**
+ * @file StopSignal.hpp
+ *
+ * StopSignal lets a module's do_stop() wake its worker thread out of
+ * whatever it is waiting in, so that a stop does not have to wait for the
+ * timeouts of the worker's waits to expire.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_STOPSIGNAL_HPP_
+#define AFV1_EXAMPLE_SRC_STOPSIGNAL_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+
+namespace dunedaq {
+namespace afv1_example {
+
+/**
+ * @brief StopSignal is raised by request_stop(), and lowered again by reset().
+ *
+ * A thread can wait for it in three ways: sleep_for() sleeps until a time has passed or the
+ * signal is raised; a Listener wakes a condition variable that the thread waits on for something
+ * else, whose predicate also checks stop_requested(); and get_fd() is an eventfd that is readable
+ * while the signal is raised, to poll() along with sockets. Waits that can not be woken, such as
+ * those of appfwk queues, are cut into short ones, with stop_requested() checked in between.
+ *
+ * Throws std::runtime_error from the constructor if the eventfd can not be created.
+ */
+class StopSignal
+{
+  struct ListenerEntry
+  {
+    std::mutex* mutex;
+    std::condition_variable* condition;
+  };
+
+public:
+  /**
+   * @brief Wakes a condition variable when the signal is raised, for as long as it exists.
+   * Create it before taking the mutex of the condition variable, which request_stop() takes to
+   * notify it. A null signal is never raised.
+   */
+  class Listener
+  {
+  public:
+    Listener(StopSignal* signal, std::mutex& mutex, std::condition_variable& condition);
+    ~Listener();
+    Listener(const Listener&) = delete;
+    Listener& operator=(const Listener&) = delete;
+
+  private:
+    StopSignal* signal_;
+    std::list<ListenerEntry>::iterator entry_;
+  };
+
+  StopSignal();
+  ~StopSignal();
+
+  StopSignal(const StopSignal&) = delete;
+  StopSignal& operator=(const StopSignal&) = delete;
+
+  /**
+   * @brief Raises the signal, and wakes every thread that waits for it
+   */
+  void request_stop();
+
+  /**
+   * @brief Lowers the signal, before the worker thread is started again
+   */
+  void reset();
+
+  bool stop_requested() const noexcept { return stopRequested_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Sleeps for the duration, unless the signal is raised first
+   * @return false if the signal was raised
+   */
+  bool sleep_for(std::chrono::steady_clock::duration duration);
+
+  /**
+   * @brief An eventfd that is readable while the signal is raised
+   */
+  int get_fd() const noexcept { return fd_; }
+
+private:
+  std::atomic<bool> stopRequested_{ false };
+  std::mutex mutex_;
+  std::condition_variable stopped_;
+  std::list<ListenerEntry> listeners_;
+  int fd_ = -1;
+};
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+#endif // AFV1_EXAMPLE_SRC_STOPSIGNAL_HPP_
@@ -0,0 +1,400 @@
+/**
+ * @file ListReceiver.hxx ListReceiver class template
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_DETAIL_LISTRECEIVER_HXX_
+#define AFV1_EXAMPLE_SRC_DETAIL_LISTRECEIVER_HXX_
+
+#include "CommonIssues.hpp"
+#include "IssueStormLimiter.hpp"
+#include "ListMessageCodec.hpp"
+#include "SlabHugePageSetting.hpp"
+
+#include <ers/ers.h>
+#include "TRACE/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "ListReceiver" // NOLINT
+#define TLVL_ENTER_EXIT_METHODS 10
+#define TLVL_LIST_TRANSPORT 15
+
+namespace dunedaq {
+namespace afv1_example {
+
+template<typename T>
+ListReceiver<T>::ListReceiver(const std::string& name)
+  : DAQModule(name)
+  , thread_(std::bind(&ListReceiver::do_work, this, std::placeholders::_1))
+  , queueTimeout_(100)
+  , memoryAccount_(&MemoryAccount::get(MemoryAccount::Kind::kModule, name))
+{
+  register_command("start", &ListReceiver::do_start);
+  register_command("stop", &ListReceiver::do_stop);
+}
+
+template<typename T>
+void
+ListReceiver<T>::init()
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering init() method";
+  batchMode_ = get_config().value<bool>("batchMode", REASONABLE_DEFAULT_BATCHMODE);
+  ropeMode_ = get_config().value<bool>("ropeMode", REASONABLE_DEFAULT_ROPEMODE);
+  if (batchMode_ && ropeMode_)
+  {
+    ers::warning(ConflictingSettingsWarning(ERS_HERE, get_name(), "batchMode", "ropeMode"));
+    ropeMode_ = false;
+  }
+  try
+  {
+    if (batchMode_)
+    {
+      batchOutputQueue_.reset(new ListQueueSink<batch_t>(get_config()["output"], &stopSignal_));
+    }
+    else if (ropeMode_)
+    {
+      ropeOutputQueue_.reset(new ListQueueSink<rope_message_t>(get_config()["output"], &stopSignal_));
+    }
+    else
+    {
+      outputQueue_.reset(new ListQueueSink<message_t>(get_config()["output"], &stopSignal_));
+    }
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidQueueFatalError(ERS_HERE, get_name(), "output", excpt);
+  }
+
+  // listening from init() on lets the senders connect as soon as they are started, in any order
+  address_ = get_config().value<std::string>("address", REASONABLE_DEFAULT_ADDRESS);
+  try
+  {
+    listener_ = ListSocket::listen(
+      address_, get_config().value<size_t>("socketBufferBytes", REASONABLE_DEFAULT_SOCKETBUFFERBYTES));
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidSocketFatalError(ERS_HERE, get_name(), address_, excpt);
+  }
+
+  outputQueueAccount_ = &MemoryAccount::get(MemoryAccount::Kind::kQueue, ListQueueReference::name_of(get_config()["output"]));
+  outputQueueOccupancy_ = &QueueOccupancy::get(ListQueueReference::name_of(get_config()["output"]));
+  bufferPool_ = &ListBufferPool::get(get_config().value<std::string>("bufferPoolName", REASONABLE_DEFAULT_BUFFERPOOLNAME));
+  receiveBufferBytes_ = std::max<size_t>(
+    sizeof(ListStreamPreamble), get_config().value<size_t>("receiveBufferBytes", REASONABLE_DEFAULT_RECEIVEBUFFERBYTES));
+  maxMessageBytes_ = get_config().value<size_t>("maxMessageBytes", REASONABLE_DEFAULT_MAXMESSAGEBYTES);
+  memoryReportInterval_ = std::chrono::milliseconds(get_config().value<size_t>(
+    "memoryReportIntervalMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS)));
+  apply_slab_huge_page_setting(get_name(), get_config());
+
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
+}
+
+template<typename T>
+void
+ListReceiver<T>::do_start(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
+  stopSignal_.reset();
+  thread_.start_working_thread();
+  ERS_LOG(get_name() << " successfully started");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
+}
+
+template<typename T>
+void
+ListReceiver<T>::do_stop(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
+  stopSignal_.request_stop();
+  thread_.stop_working_thread();
+  ERS_LOG(get_name() << " successfully stopped");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_stop() method";
+}
+
+template<typename T>
+void
+ListReceiver<T>::do_work(std::atomic<bool>& running_flag)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_work() method";
+  if (batchMode_)
+  {
+    process_messages(running_flag, *batchOutputQueue_);
+  }
+  else if (ropeMode_)
+  {
+    process_messages(running_flag, *ropeOutputQueue_);
+  }
+  else
+  {
+    process_messages(running_flag, *outputQueue_);
+  }
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_work() method";
+}
+
+template<typename T>
+template<typename Message>
+bool
+ListReceiver<T>::decode_messages(Connection& connection, std::vector<Message>& messages)
+{
+  const uint8_t* data = connection.buffer.data();
+  size_t offset = 0;
+  std::string problem;
+  if (!connection.preambleSeen && connection.filled >= sizeof(ListStreamPreamble))
+  {
+    ListStreamPreamble preamble;
+    std::memcpy(&preamble, data, sizeof(preamble));
+    if (preamble != ListStreamPreamble::for_messages<Message>())
+    {
+      problem = "the stream starts with an unknown preamble, or one for a different kind of message";
+    }
+    connection.preambleSeen = true;
+    offset = sizeof(ListStreamPreamble);
+  }
+  while (problem.empty() && connection.preambleSeen && connection.filled - offset >= sizeof(ListWireHeader))
+  {
+    ListWireHeader wireHeader;
+    if (!read_wire_header(data + offset, wireHeader))
+    {
+      problem = "a message does not start with a header of the expected version";
+      break;
+    }
+    if (wireHeader.frameBytes > maxMessageBytes_)
+    {
+      problem = "a message of " + std::to_string(wireHeader.frameBytes) + " bytes is larger than the maximum of " +
+                std::to_string(maxMessageBytes_);
+      break;
+    }
+    if (connection.filled - offset < wireHeader.frameBytes)
+    {
+      // make room for the rest of a message that is larger than the buffer
+      if (wireHeader.frameBytes > connection.buffer.size())
+      {
+        connection.buffer.resize(wireHeader.frameBytes);
+        data = connection.buffer.data();
+      }
+      break;
+    }
+    // the frames stay aligned in the buffer, since the preamble and each frame are whole multiples
+    // of the alignment and the buffer is compacted to its start
+    messages.emplace_back();
+    if (!read_list_message(data + offset, wireHeader.frameBytes, messages.back(), bufferPool_))
+    {
+      messages.pop_back();
+      problem = "a message could not be decoded";
+      break;
+    }
+    offset += wireHeader.frameBytes;
+  }
+  if (!problem.empty())
+  {
+    ers::error(InvalidStreamData(ERS_HERE, get_name(), address_, problem));
+    return false;
+  }
+  // keep the start of the next message at the front of the buffer
+  if (offset > 0)
+  {
+    std::memmove(connection.buffer.data(), connection.buffer.data() + offset, connection.filled - offset);
+    connection.filled -= offset;
+  }
+  return true;
+}
+
+template<typename T>
+template<typename Message>
+void
+ListReceiver<T>::process_messages(std::atomic<bool>& running_flag, ListQueueSink<Message>& outputQueue)
+{
+  size_t receivedCount = 0;
+  size_t sentCount = 0;
+  size_t droppedCount = 0;
+  size_t tooLargeCount = 0;
+  size_t receivedBytes = 0;
+  size_t readCount = 0;
+  size_t acceptedCount = 0;
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::vector<const ListSocket*> sockets;
+  std::vector<Message> workingMessages;
+  std::vector<size_t> footprints;
+  IssueStormLimiter pushTimeoutLimiter;
+  auto report_suppressed_issues = [&](bool flush) {
+    pushTimeoutLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "push timeout on output queue",
+                                             suppressedCount, totalCount));
+      },
+      flush);
+  };
+  auto report_memory = [&]() {
+    std::ostringstream oss_mem;
+    oss_mem << "Memory accounting: " << *memoryAccount_ << "; " << *outputQueueAccount_;
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_mem.str()));
+    std::ostringstream oss_occ;
+    oss_occ << "Queue occupancy: " << *outputQueueOccupancy_;
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_occ.str()));
+  };
+  auto lastMemoryReportTime = std::chrono::steady_clock::now();
+
+  while (running_flag.load() && !stopSignal_.stop_requested())
+  {
+    report_suppressed_issues(false);
+    if (std::chrono::steady_clock::now() - lastMemoryReportTime >= memoryReportInterval_)
+    {
+      report_memory();
+      lastMemoryReportTime = std::chrono::steady_clock::now();
+    }
+
+    sockets.clear();
+    sockets.push_back(&listener_);
+    for (auto& connection : connections)
+    {
+      sockets.push_back(&connection->socket);
+    }
+    std::vector<size_t> readyIndices;
+    try
+    {
+      readyIndices = ListSocket::wait_readable(sockets, queueTimeout_, stopSignal_.get_fd());
+    }
+    catch (const std::runtime_error& excpt)
+    {
+      ers::warning(ProgressUpdate(ERS_HERE, get_name(), excpt.what()));
+      continue;
+    }
+
+    for (size_t readyIndex : readyIndices)
+    {
+      if (readyIndex == 0)
+      {
+        for (ListSocket accepted = listener_.accept(); accepted.is_open(); accepted = listener_.accept())
+        {
+          std::unique_ptr<Connection> connection(new Connection());
+          connection->socket = std::move(accepted);
+          connection->buffer.resize(receiveBufferBytes_);
+          connections.push_back(std::move(connection));
+          ++acceptedCount;
+          ers::info(ProgressUpdate(ERS_HERE, get_name(), "Accepted a connection on " + address_));
+        }
+        continue;
+      }
+
+      Connection& connection = *connections[readyIndex - 1];
+      size_t bytesRead = 0;
+      try
+      {
+        bytesRead = connection.socket.read_some(connection.buffer.data() + connection.filled,
+                                                connection.buffer.size() - connection.filled);
+      }
+      catch (const std::runtime_error& excpt)
+      {
+        ers::warning(ProgressUpdate(ERS_HERE, get_name(), excpt.what()));
+      }
+      ++readCount;
+      receivedBytes += bytesRead;
+      if (bytesRead == 0)
+      {
+        std::ostringstream oss_closed;
+        oss_closed << "A connection on " << address_ << " was closed";
+        if (connection.filled > 0)
+        {
+          oss_closed << ", part of the way through a message";
+        }
+        ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_closed.str()));
+        connection.socket.close();
+        continue;
+      }
+      connection.filled += bytesRead;
+      size_t decodedBefore = workingMessages.size();
+      if (!decode_messages(connection, workingMessages))
+      {
+        connection.socket.close();
+      }
+      for (size_t msgIdx = decodedBefore; msgIdx < workingMessages.size(); ++msgIdx)
+      {
+        // the lists were read into buffers that this module now holds
+        memoryAccount_->record_allocation(workingMessages[msgIdx].memory_footprint());
+      }
+    }
+    connections.erase(std::remove_if(connections.begin(),
+                                     connections.end(),
+                                     [](const std::unique_ptr<Connection>& connection) {
+                                       return !connection->socket.is_open();
+                                     }),
+                      connections.end());
+    if (workingMessages.empty())
+    {
+      continue;
+    }
+
+    receivedCount += workingMessages.size();
+    footprints.clear();
+    for (auto& message : workingMessages)
+    {
+      footprints.push_back(message.memory_footprint());
+    }
+    size_t pushedCount = 0;
+    while (pushedCount < workingMessages.size() && running_flag.load() && !stopSignal_.stop_requested())
+    {
+      report_suppressed_issues(false);
+      TLOG(TLVL_LIST_TRANSPORT) << get_name() << ": Pushing " << workingMessages.size() - pushedCount
+                                << " received message(s) onto the output queue";
+      size_t previouslyTooLargeCount = tooLargeCount;
+      size_t newlyPushedCount = outputQueue.push_n(
+        workingMessages.data() + pushedCount, workingMessages.size() - pushedCount, queueTimeout_, tooLargeCount);
+      for (size_t msgIdx = pushedCount; msgIdx < pushedCount + newlyPushedCount; ++msgIdx)
+      {
+        if (!outputQueue.is_cross_process())
+        {
+          outputQueueAccount_->record_receipt(footprints[msgIdx]);
+        }
+      }
+      pushedCount += newlyPushedCount;
+      sentCount += newlyPushedCount - (tooLargeCount - previouslyTooLargeCount);
+      if (pushedCount < workingMessages.size() && !stopSignal_.stop_requested() && pushTimeoutLimiter.record())
+      {
+        std::ostringstream oss_warn;
+        oss_warn << "push to output queue \"" << outputQueue.get_name() << "\"";
+        ers::warning(dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, get_name(), oss_warn.str(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(queueTimeout_).count()));
+      }
+    }
+    droppedCount += workingMessages.size() - pushedCount;
+    for (size_t msgIdx = 0; msgIdx < workingMessages.size(); ++msgIdx)
+    {
+      memoryAccount_->record_release(footprints[msgIdx]);
+    }
+    workingMessages.clear();
+  }
+  report_suppressed_issues(true);
+  report_memory();
+
+  std::ostringstream oss_summ;
+  oss_summ << ": Exiting do_work() method, received " << receivedCount << (batchMode_ ? " batches" : " lists")
+           << " (" << receivedBytes << " bytes in " << readCount << " read(s)) on " << acceptedCount
+           << " connection(s) to " << address_ << ", and successfully sent " << sentCount << ". " << droppedCount
+           << " were dropped when the module was stopped, and " << tooLargeCount
+           << " because the output queue can not hold them. ";
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_summ.str()));
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+// the TRACE settings above are for this file alone, not for the files that include it
+#undef TRACE_NAME
+#undef TLVL_ENTER_EXIT_METHODS
+#undef TLVL_LIST_TRANSPORT
+
+#endif // AFV1_EXAMPLE_SRC_DETAIL_LISTRECEIVER_HXX_
@@ -0,0 +1,406 @@
+/**
+ * @file ListReverser.hxx ListReverser class template
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_DETAIL_LISTREVERSER_HXX_
+#define AFV1_EXAMPLE_SRC_DETAIL_LISTREVERSER_HXX_
+
+#include "CommonIssues.hpp"
+#include "IssueStormLimiter.hpp"
+#include "SequenceTracker.hpp"
+#include "SlabHugePageSetting.hpp"
+#include "ListReversalKernels.hpp"
+
+#include <ers/ers.h>
+#include "TRACE/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "ListReverser" // NOLINT
+#define TLVL_ENTER_EXIT_METHODS 10
+#define TLVL_LIST_REVERSAL 15
+
+namespace dunedaq {
+namespace afv1_example {
+
+template<typename T>
+ListReverser<T>::ListReverser(const std::string& name)
+  : DAQModule(name)
+  , thread_(std::bind(&ListReverser::do_work, this, std::placeholders::_1))
+  , inputQueue_(nullptr)
+  , outputQueue_(nullptr)
+  , queueTimeout_(100)
+  , memoryAccount_(&MemoryAccount::get(MemoryAccount::Kind::kModule, name))
+{
+  register_command("start", &ListReverser::do_start);
+  register_command("stop", &ListReverser::do_stop);
+}
+
+template<typename T>
+void
+ListReverser<T>::init()
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering init() method";
+  batchMode_ = get_config().value<bool>("batchMode", REASONABLE_DEFAULT_BATCHMODE);
+  ropeMode_ = get_config().value<bool>("ropeMode", REASONABLE_DEFAULT_ROPEMODE);
+  if (batchMode_ && ropeMode_)
+  {
+    ers::warning(ConflictingSettingsWarning(ERS_HERE, get_name(), "batchMode", "ropeMode"));
+    ropeMode_ = false;
+  }
+  try
+  {
+    if (batchMode_)
+    {
+      batchInputQueue_.reset(new ListQueueSource<batch_t>(get_config()["input"], &stopSignal_));
+    }
+    else if (ropeMode_)
+    {
+      ropeInputQueue_.reset(new ListQueueSource<rope_message_t>(get_config()["input"], &stopSignal_));
+    }
+    else
+    {
+      inputQueue_.reset(new ListQueueSource<message_t>(get_config()["input"], &stopSignal_));
+    }
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidQueueFatalError(ERS_HERE, get_name(), "input", excpt);
+  }
+
+  try
+  {
+    if (batchMode_)
+    {
+      batchOutputQueue_.reset(new ListQueueSink<batch_t>(get_config()["output"], &stopSignal_));
+    }
+    else if (ropeMode_)
+    {
+      ropeOutputQueue_.reset(new ListQueueSink<rope_message_t>(get_config()["output"], &stopSignal_));
+    }
+    else
+    {
+      outputQueue_.reset(new ListQueueSink<message_t>(get_config()["output"], &stopSignal_));
+    }
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidQueueFatalError(ERS_HERE, get_name(), "output", excpt);
+  }
+
+  inputQueueAccount_ = &MemoryAccount::get(MemoryAccount::Kind::kQueue, ListQueueReference::name_of(get_config()["input"]));
+  outputQueueAccount_ = &MemoryAccount::get(MemoryAccount::Kind::kQueue, ListQueueReference::name_of(get_config()["output"]));
+  outputQueueOccupancy_ = &QueueOccupancy::get(ListQueueReference::name_of(get_config()["output"]));
+  memoryReportInterval_ = std::chrono::milliseconds(get_config().value<size_t>(
+    "memoryReportIntervalMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS)));
+  apply_slab_huge_page_setting(get_name(), get_config());
+  popBatchSize_ = std::max<size_t>(1, get_config().value<size_t>("popBatchSize", REASONABLE_DEFAULT_POPBATCHSIZE));
+
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
+}
+
+template<typename T>
+void
+ListReverser<T>::do_start(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
+  stopSignal_.reset();
+  thread_.start_working_thread();
+  ERS_LOG(get_name() << " successfully started");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
+}
+
+template<typename T>
+void
+ListReverser<T>::do_stop(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
+  stopSignal_.request_stop();
+  thread_.stop_working_thread();
+  ERS_LOG(get_name() << " successfully stopped");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_stop() method";
+}
+
+template<typename T>
+void
+ListReverser<T>::reverse_contents(message_t& message)
+{
+  if (message.payload_is_exclusive())
+  {
+    std::reverse(message.payload.begin(), message.payload.end());
+  }
+  else
+  {
+    // the (spilled) payload is shared with other consumers, e.g. the validator's copy of
+    // the original list, so the reversed list is written into a buffer of its own, taken
+    // from the same pool as the original
+    const typename message_t::payload_t& original = message.data();
+    typename message_t::payload_t reversed = message_t::payload_t::allocate(original.size(), original.pool(), 0);
+    std::reverse_copy(original.begin(), original.end(), reversed.begin());
+    message.payload = std::move(reversed);
+  }
+}
+
+template<typename T>
+void
+ListReverser<T>::reverse_contents(batch_t& batch)
+{
+  if (batch.payload_is_exclusive())
+  {
+    reverse_lists(batch.payload.data(), batch.payload.data(), batch.offsets.data(), batch.list_count());
+  }
+  else
+  {
+    const typename batch_t::payload_t& original = batch.data();
+    typename batch_t::payload_t reversed = batch_t::payload_t::allocate(original.size(), original.pool());
+    reverse_lists(original.data(), reversed.data(), batch.offsets.data(), batch.list_count());
+    batch.payload = std::move(reversed);
+  }
+}
+
+template<typename T>
+void
+ListReverser<T>::reverse_contents(rope_message_t& message)
+{
+  message.payload.reverse();
+}
+
+template<typename T>
+void
+ListReverser<T>::do_work(std::atomic<bool>& running_flag)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_work() method";
+  if (batchMode_)
+  {
+    process_messages(running_flag, *batchInputQueue_, *batchOutputQueue_);
+  }
+  else if (ropeMode_)
+  {
+    process_messages(running_flag, *ropeInputQueue_, *ropeOutputQueue_);
+  }
+  else
+  {
+    process_messages(running_flag, *inputQueue_, *outputQueue_);
+  }
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_work() method";
+}
+
+template<typename T>
+template<typename Message>
+void
+ListReverser<T>::process_messages(std::atomic<bool>& running_flag,
+                                  ListQueueSource<Message>& inputQueue,
+                                  ListQueueSink<Message>& outputQueue)
+{
+  int receivedCount = 0;
+  int sentCount = 0;
+  int expiredCount = 0;
+  size_t tooLargeCount = 0;
+  size_t reversedListCount = 0;
+  // messages are popped, reversed and pushed on in groups of up to popBatchSize
+  std::vector<Message> workingMessages(popBatchSize_);
+  std::vector<size_t> footprints(popBatchSize_);
+  SequenceTracker inputSequence;
+  // when several modules share the input queue, each sees only some of the sequence numbers
+  bool checkInputSequence = !inputQueue.is_shared();
+  IssueStormLimiter pushTimeoutLimiter;
+  IssueStormLimiter sequenceGapLimiter;
+  IssueStormLimiter duplicateSequenceLimiter;
+  auto report_suppressed_issues = [&](bool flush) {
+    pushTimeoutLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "push timeout on output queue",
+                                             suppressedCount, totalCount));
+      },
+      flush);
+    sequenceGapLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "sequence gap on input queue",
+                                             suppressedCount, totalCount));
+      },
+      flush);
+    duplicateSequenceLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "duplicate sequence number on input queue",
+                                             suppressedCount, totalCount));
+      },
+      flush);
+  };
+  // the output queue is reported here, and the input queue by the module that pushes onto it
+  auto report_memory = [&]() {
+    std::ostringstream oss_mem;
+    oss_mem << "Memory accounting: " << *memoryAccount_ << "; " << *outputQueueAccount_;
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_mem.str()));
+    std::ostringstream oss_occ;
+    oss_occ << "Queue occupancy: " << *outputQueueOccupancy_;
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_occ.str()));
+  };
+  auto lastMemoryReportTime = std::chrono::steady_clock::now();
+
+  while (running_flag.load() && !stopSignal_.stop_requested()) {
+    report_suppressed_issues(false);
+    if (std::chrono::steady_clock::now() - lastMemoryReportTime >= memoryReportInterval_)
+    {
+      report_memory();
+      lastMemoryReportTime = std::chrono::steady_clock::now();
+    }
+
+    TLOG(TLVL_LIST_REVERSAL) << get_name() << ": Going to receive data from input queue";
+    size_t poppedCount = inputQueue.pop_n(workingMessages.data(), workingMessages.size(), queueTimeout_);
+    if (poppedCount == 0)
+    {
+      // it is perfectly reasonable that there might be no data in the queue 
+      // some fraction of the times that we check, so we just continue on and try again
+      continue;
+    }
+
+    // messages past their deadline are dropped as they are taken, and the rest are moved up to
+    // keep them together; each is checked against the time of the pop, so a whole group is judged alike
+    auto now = Message::clock_t::now();
+    size_t keptCount = 0;
+    for (size_t msgIdx = 0; msgIdx < poppedCount; ++msgIdx)
+    {
+      Message& workingMessage = workingMessages[msgIdx];
+      ++receivedCount;
+      size_t footprint = workingMessage.memory_footprint();
+      if (inputQueue.is_cross_process())
+      {
+        // the message was copied in from another process, into buffers that this module now holds
+        memoryAccount_->record_allocation(footprint);
+      }
+      else
+      {
+        inputQueueAccount_->record_release(footprint);
+        memoryAccount_->record_receipt(footprint);
+      }
+      uint64_t gapSize = 0;
+      switch (checkInputSequence
+                ? inputSequence.check(workingMessage.header.streamId, workingMessage.header.sequenceNumber, &gapSize)
+                : SequenceTracker::Result::kInOrder)
+      {
+        case SequenceTracker::Result::kGap:
+          if (sequenceGapLimiter.record())
+          {
+            ers::warning(SequenceGapDetected(ERS_HERE, get_name(), "input queue", workingMessage.header.streamId,
+                                             workingMessage.header.sequenceNumber, gapSize));
+          }
+          break;
+        case SequenceTracker::Result::kDuplicate:
+          if (duplicateSequenceLimiter.record())
+          {
+            ers::warning(DuplicateSequenceNumber(ERS_HERE, get_name(), "input queue", workingMessage.header.streamId,
+                                                 workingMessage.header.sequenceNumber));
+          }
+          break;
+        default:
+          break;
+      }
+      if (workingMessage.header.is_expired(now))
+      {
+        ++expiredCount;
+        workingMessage = Message();
+        memoryAccount_->record_release(footprint);
+        continue;
+      }
+
+      TLOG(TLVL_LIST_REVERSAL) << get_name() << ": Received message #" << receivedCount << " with "
+                               << workingMessage.list_count() << " list(s) and " << workingMessage.data().size()
+                               << " values. Reversing its contents";
+      bool reversedInPlace = workingMessage.payload_is_exclusive();
+      size_t originalPayloadFootprint = workingMessage.payload.buffer_footprint();
+      reverse_contents(workingMessage);
+      reversedListCount += workingMessage.list_count();
+      if (!reversedInPlace)
+      {
+        // the reversed list went into a new buffer, and this module's reference to the original was dropped
+        memoryAccount_->record_allocation(workingMessage.payload.buffer_footprint());
+        memoryAccount_->record_release(originalPayloadFootprint);
+        footprint = workingMessage.memory_footprint();
+      }
+
+      std::ostringstream oss_prog;
+      oss_prog << "Reversed list #" << receivedCount << ", new contents " << workingMessage.data()
+               << " and size " << workingMessage.data().size() << ". ";
+      ers::debug(ProgressUpdate(ERS_HERE, get_name(), oss_prog.str()));
+
+      footprints[keptCount] = footprint;
+      if (keptCount != msgIdx)
+      {
+        workingMessages[keptCount] = std::move(workingMessage);
+      }
+      ++keptCount;
+    }
+
+    size_t pushedCount = 0;
+    while (pushedCount < keptCount && running_flag.load() && !stopSignal_.stop_requested())
+    {
+      report_suppressed_issues(false);
+      TLOG(TLVL_LIST_REVERSAL) << get_name() << ": Pushing " << keptCount - pushedCount
+                               << " reversed list(s) onto the output queue";
+      size_t previouslyTooLargeCount = tooLargeCount;
+      size_t newlyPushedCount =
+        outputQueue.push_n(workingMessages.data() + pushedCount, keptCount - pushedCount, queueTimeout_, tooLargeCount);
+      for (size_t msgIdx = pushedCount; msgIdx < pushedCount + newlyPushedCount; ++msgIdx)
+      {
+        if (!outputQueue.is_cross_process())
+        {
+          outputQueueAccount_->record_receipt(footprints[msgIdx]);
+        }
+      }
+      pushedCount += newlyPushedCount;
+      sentCount += newlyPushedCount - (tooLargeCount - previouslyTooLargeCount);
+      if (pushedCount < keptCount && !stopSignal_.stop_requested() && pushTimeoutLimiter.record())
+      {
+        std::ostringstream oss_warn;
+        oss_warn << "push to output queue \"" << outputQueue.get_name() << "\"";
+        ers::warning(dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, get_name(), oss_warn.str(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(queueTimeout_).count()));
+      }
+    }
+    // release this module's references to the payloads, so that the downstream stages hold the only ones
+    for (size_t msgIdx = 0; msgIdx < keptCount; ++msgIdx)
+    {
+      workingMessages[msgIdx] = Message();
+      memoryAccount_->record_release(footprints[msgIdx]);
+    }
+    TLOG(TLVL_LIST_REVERSAL) << get_name() << ": End of do_work loop";
+  }
+  report_suppressed_issues(true);
+  report_memory();
+
+  std::ostringstream oss_summ;
+  oss_summ << ": Exiting do_work() method, received " << receivedCount << (batchMode_ ? " batches" : " lists")
+           << " and successfully sent " << sentCount << " (" << reversedListCount << " lists reversed), after dropping "
+           << expiredCount << " that were past their deadline and " << tooLargeCount
+           << " that the output queue can not hold. Input sequence numbers: ";
+  if (checkInputSequence)
+  {
+    oss_summ << inputSequence.counters() << ". ";
+  }
+  else
+  {
+    oss_summ << "not checked, since the input queue is shared with other modules. ";
+  }
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_summ.str()));
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+// the TRACE settings above are for this file alone, not for the files that include it
+#undef TRACE_NAME
+#undef TLVL_ENTER_EXIT_METHODS
+#undef TLVL_LIST_REVERSAL
+
+#endif // AFV1_EXAMPLE_SRC_DETAIL_LISTREVERSER_HXX_
@@ -0,0 +1,355 @@
+/**
+ * @file ListSender.hxx ListSender class template
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_DETAIL_LISTSENDER_HXX_
+#define AFV1_EXAMPLE_SRC_DETAIL_LISTSENDER_HXX_
+
+#include "CommonIssues.hpp"
+#include "ListMessageCodec.hpp"
+#include "SlabHugePageSetting.hpp"
+
+#include <ers/ers.h>
+#include "TRACE/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <sys/uio.h>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "ListSender" // NOLINT
+#define TLVL_ENTER_EXIT_METHODS 10
+#define TLVL_LIST_TRANSPORT 15
+
+namespace dunedaq {
+namespace afv1_example {
+
+template<typename T>
+ListSender<T>::ListSender(const std::string& name)
+  : DAQModule(name)
+  , thread_(std::bind(&ListSender::do_work, this, std::placeholders::_1))
+  , queueTimeout_(100)
+  , memoryAccount_(&MemoryAccount::get(MemoryAccount::Kind::kModule, name))
+{
+  register_command("start", &ListSender::do_start);
+  register_command("stop", &ListSender::do_stop);
+}
+
+template<typename T>
+void
+ListSender<T>::init()
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering init() method";
+  batchMode_ = get_config().value<bool>("batchMode", REASONABLE_DEFAULT_BATCHMODE);
+  ropeMode_ = get_config().value<bool>("ropeMode", REASONABLE_DEFAULT_ROPEMODE);
+  if (batchMode_ && ropeMode_)
+  {
+    ers::warning(ConflictingSettingsWarning(ERS_HERE, get_name(), "batchMode", "ropeMode"));
+    ropeMode_ = false;
+  }
+  try
+  {
+    if (batchMode_)
+    {
+      batchInputQueue_.reset(new ListQueueSource<batch_t>(get_config()["input"], &stopSignal_));
+    }
+    else if (ropeMode_)
+    {
+      ropeInputQueue_.reset(new ListQueueSource<rope_message_t>(get_config()["input"], &stopSignal_));
+    }
+    else
+    {
+      inputQueue_.reset(new ListQueueSource<message_t>(get_config()["input"], &stopSignal_));
+    }
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidQueueFatalError(ERS_HERE, get_name(), "input", excpt);
+  }
+
+  address_ = get_config().value<std::string>("address", REASONABLE_DEFAULT_ADDRESS);
+  try
+  {
+    ListSocket::check_address(address_);
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidSocketFatalError(ERS_HERE, get_name(), address_, excpt);
+  }
+
+  inputQueueAccount_ = &MemoryAccount::get(MemoryAccount::Kind::kQueue, ListQueueReference::name_of(get_config()["input"]));
+  sendBatchSize_ = std::max<size_t>(1, get_config().value<size_t>("sendBatchSize", REASONABLE_DEFAULT_SENDBATCHSIZE));
+  try
+  {
+    compression_ = parse_list_compression(get_config().value<std::string>("compression", REASONABLE_DEFAULT_COMPRESSION));
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidSettingFatalError(ERS_HERE, get_name(), "compression", excpt);
+  }
+  socketBufferBytes_ = get_config().value<size_t>("socketBufferBytes", REASONABLE_DEFAULT_SOCKETBUFFERBYTES);
+  connectInterval_ = std::chrono::milliseconds(get_config().value<size_t>(
+    "connectIntervalMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENCONNECTATTEMPTS)));
+  sendTimeout_ = std::chrono::milliseconds(
+    get_config().value<size_t>("sendTimeoutMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECSENDTIMEOUT)));
+  memoryReportInterval_ = std::chrono::milliseconds(get_config().value<size_t>(
+    "memoryReportIntervalMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS)));
+  apply_slab_huge_page_setting(get_name(), get_config());
+
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
+}
+
+template<typename T>
+void
+ListSender<T>::do_start(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
+  stopSignal_.reset();
+  thread_.start_working_thread();
+  ERS_LOG(get_name() << " successfully started");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
+}
+
+template<typename T>
+void
+ListSender<T>::do_stop(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
+  stopSignal_.request_stop();
+  thread_.stop_working_thread();
+  ERS_LOG(get_name() << " successfully stopped");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_stop() method";
+}
+
+template<typename T>
+void
+ListSender<T>::do_work(std::atomic<bool>& running_flag)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_work() method";
+  if (batchMode_)
+  {
+    process_messages(running_flag, *batchInputQueue_);
+  }
+  else if (ropeMode_)
+  {
+    process_messages(running_flag, *ropeInputQueue_);
+  }
+  else
+  {
+    process_messages(running_flag, *inputQueue_);
+  }
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_work() method";
+}
+
+template<typename T>
+template<typename Message>
+bool
+ListSender<T>::connect(std::atomic<bool>& running_flag,
+                       ListSocket& connection,
+                       IssueStormLimiter& connectFailureLimiter,
+                       const std::function<void(bool)>& reportSuppressedIssues)
+{
+  while (running_flag.load() && !stopSignal_.stop_requested())
+  {
+    reportSuppressedIssues(false);
+    try
+    {
+      connection = ListSocket::connect(address_, socketBufferBytes_, connectInterval_, stopSignal_.get_fd());
+      ListStreamPreamble preamble = ListStreamPreamble::for_messages<Message>();
+      iovec piece{ &preamble, sizeof(preamble) };
+      connection.write_all(&piece, 1, sendTimeout_, stopSignal_.get_fd());
+      ers::info(ProgressUpdate(ERS_HERE, get_name(), "Connected to " + address_));
+      return true;
+    }
+    catch (const std::runtime_error& excpt)
+    {
+      connection.close();
+      if (!stopSignal_.stop_requested() && connectFailureLimiter.record())
+      {
+        ers::warning(ConnectionFailed(ERS_HERE, get_name(), address_, excpt.what()));
+      }
+    }
+    // wait before the next attempt, unless the module is stopped first
+    stopSignal_.sleep_for(connectInterval_);
+  }
+  return false;
+}
+
+template<typename T>
+template<typename Message>
+void
+ListSender<T>::process_messages(std::atomic<bool>& running_flag, ListQueueSource<Message>& inputQueue)
+{
+  size_t receivedCount = 0;
+  size_t sentCount = 0;
+  size_t droppedCount = 0;
+  size_t expiredCount = 0;
+  size_t sentBytes = 0;
+  size_t writeCount = 0;
+  uint64_t systemCallCount = 0;
+  // messages are popped and sent in groups of up to sendBatchSize; for each one, its prefix and
+  // the pieces of the write are kept until the write is complete
+  std::vector<Message> workingMessages(sendBatchSize_);
+  std::vector<size_t> footprints(sendBatchSize_);
+  std::vector<std::vector<uint8_t>> prefixes(sendBatchSize_);
+  std::vector<ListMessageSpan> bodySpans;
+  std::vector<iovec> pieces;
+  ListCompressionStats compressionStats;
+  ListSocket connection;
+  IssueStormLimiter connectFailureLimiter;
+  IssueStormLimiter connectionLostLimiter;
+  auto report_suppressed_issues = [&](bool flush) {
+    connectFailureLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "connection failure", suppressedCount, totalCount));
+      },
+      flush);
+    connectionLostLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "lost connection", suppressedCount, totalCount));
+      },
+      flush);
+  };
+  // the input queue is reported by the module that pushes onto it
+  auto report_memory = [&]() {
+    std::ostringstream oss_mem;
+    oss_mem << "Memory accounting: " << *memoryAccount_;
+    if (!compressionStats.empty())
+    {
+      oss_mem << "; " << list_compression_name(compression_) << " compression: " << compressionStats;
+    }
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_mem.str()));
+  };
+  auto lastMemoryReportTime = std::chrono::steady_clock::now();
+
+  while (running_flag.load() && !stopSignal_.stop_requested())
+  {
+    report_suppressed_issues(false);
+    if (std::chrono::steady_clock::now() - lastMemoryReportTime >= memoryReportInterval_)
+    {
+      report_memory();
+      lastMemoryReportTime = std::chrono::steady_clock::now();
+    }
+    if (!connection.is_open() && !connect<Message>(running_flag, connection, connectFailureLimiter, report_suppressed_issues))
+    {
+      break;
+    }
+
+    TLOG(TLVL_LIST_TRANSPORT) << get_name() << ": Going to receive data from input queue";
+    size_t poppedCount = inputQueue.pop_n(workingMessages.data(), workingMessages.size(), queueTimeout_);
+    if (poppedCount == 0)
+    {
+      continue;
+    }
+
+    pieces.clear();
+    size_t batchBytes = 0;
+    // messages past their deadline are not worth the bandwidth, and are released with the rest below
+    auto now = Message::clock_t::now();
+    size_t liveCount = 0;
+    for (size_t msgIdx = 0; msgIdx < poppedCount; ++msgIdx)
+    {
+      Message& workingMessage = workingMessages[msgIdx];
+      ++receivedCount;
+      footprints[msgIdx] = workingMessage.memory_footprint();
+      if (inputQueue.is_cross_process())
+      {
+        memoryAccount_->record_allocation(footprints[msgIdx]);
+      }
+      else
+      {
+        inputQueueAccount_->record_release(footprints[msgIdx]);
+        memoryAccount_->record_receipt(footprints[msgIdx]);
+      }
+      if (workingMessage.header.is_expired(now))
+      {
+        ++expiredCount;
+        continue;
+      }
+      ++liveCount;
+
+      size_t uncompressedBytes = 0;
+      size_t frameBytes = describe_list_message(workingMessage, prefixes[msgIdx], bodySpans, compression_, &uncompressedBytes);
+      if (compression_ != ListCompression::kNone)
+      {
+        compressionStats.record(workingMessage.header.streamId, uncompressedBytes, frameBytes);
+      }
+      batchBytes += frameBytes;
+      pieces.push_back({ prefixes[msgIdx].data(), prefixes[msgIdx].size() });
+      for (auto& span : bodySpans)
+      {
+        pieces.push_back({ const_cast<void*>(span.data), span.bytes });
+      }
+    }
+
+    if (liveCount > 0)
+    {
+      TLOG(TLVL_LIST_TRANSPORT) << get_name() << ": Sending " << liveCount << " message(s), " << batchBytes
+                                << " bytes in " << pieces.size() << " pieces";
+      uint64_t systemCallsBefore = connection.write_call_count();
+      bool writeFailed = false;
+      try
+      {
+        connection.write_all(pieces.data(), pieces.size(), sendTimeout_, stopSignal_.get_fd());
+        sentCount += liveCount;
+        sentBytes += batchBytes;
+        ++writeCount;
+      }
+      catch (const std::runtime_error& excpt)
+      {
+        writeFailed = true;
+        droppedCount += liveCount;
+        // a write that the stop cut short is counted as dropped, but the connection was not lost
+        if (!stopSignal_.stop_requested() && connectionLostLimiter.record())
+        {
+          ers::error(ConnectionLost(ERS_HERE, get_name(), address_, excpt.what(), liveCount));
+        }
+      }
+      systemCallCount += connection.write_call_count() - systemCallsBefore;
+      if (writeFailed)
+      {
+        // the write may have stopped part of the way through a message, so the stream can not be resumed
+        connection.close();
+      }
+    }
+
+    // release this module's references to the payloads, whether or not they were sent
+    for (size_t msgIdx = 0; msgIdx < poppedCount; ++msgIdx)
+    {
+      workingMessages[msgIdx] = Message();
+      memoryAccount_->record_release(footprints[msgIdx]);
+    }
+  }
+  report_suppressed_issues(true);
+  report_memory();
+
+  std::ostringstream oss_summ;
+  oss_summ << ": Exiting do_work() method, received " << receivedCount << (batchMode_ ? " batches" : " lists")
+           << " and sent " << sentCount << " (" << sentBytes << " bytes) to " << address_ << " in " << writeCount
+           << " write(s) of up to " << sendBatchSize_ << " message(s), with " << systemCallCount << " system call(s). "
+           << droppedCount << " were dropped when the connection failed, and " << expiredCount
+           << " past their deadline. ";
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_summ.str()));
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+// the TRACE settings above are for this file alone, not for the files that include it
+#undef TRACE_NAME
+#undef TLVL_ENTER_EXIT_METHODS
+#undef TLVL_LIST_TRANSPORT
+
+#endif // AFV1_EXAMPLE_SRC_DETAIL_LISTSENDER_HXX_
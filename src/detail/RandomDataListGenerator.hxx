@@ -0,0 +1,483 @@
+/**
+ * @file RandomDataListGenerator.hxx RandomDataListGenerator class template
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_DETAIL_RANDOMDATALISTGENERATOR_HXX_
+#define AFV1_EXAMPLE_SRC_DETAIL_RANDOMDATALISTGENERATOR_HXX_
+
+#include "CommonIssues.hpp"
+#include "IssueStormLimiter.hpp"
+#include "SlabAllocator.hpp"
+#include "SlabHugePageSetting.hpp"
+
+#include <ers/ers.h>
+#include <TRACE/trace.h>
+
+#include <chrono>
+#include <thread>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "RandomDataListGenerator" // NOLINT
+#define TLVL_ENTER_EXIT_METHODS 10
+#define TLVL_LIST_GENERATION 15
+
+namespace dunedaq {
+namespace afv1_example {
+
+template<typename T>
+RandomDataListGenerator<T>::RandomDataListGenerator(const std::string& name)
+  : dunedaq::appfwk::DAQModule(name)
+  , thread_(std::bind(&RandomDataListGenerator::do_work, this, std::placeholders::_1))
+  , outputQueues_()
+  , queueTimeout_(100)
+  , memoryAccount_(&MemoryAccount::get(MemoryAccount::Kind::kModule, name))
+{
+  register_command("configure", &RandomDataListGenerator::do_configure);
+  register_command("start",  &RandomDataListGenerator::do_start);
+  register_command("stop",  &RandomDataListGenerator::do_stop);
+  register_command("unconfigure",  &RandomDataListGenerator::do_unconfigure);
+}
+
+template<typename T>
+void
+RandomDataListGenerator<T>::init()
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering init() method";
+  // the type of message that the queues carry is fixed when they are attached, so batch mode is set here
+  listsPerBatch_ = get_config().value<size_t>("listsPerBatch", REASONABLE_DEFAULT_LISTSPERBATCH);
+  ropeChunkSize_ = get_config().value<size_t>("ropeChunkSize", REASONABLE_DEFAULT_ROPECHUNKSIZE);
+  if (listsPerBatch_ > 0 && ropeChunkSize_ > 0)
+  {
+    ers::warning(ConflictingSettingsWarning(ERS_HERE, get_name(), "listsPerBatch", "ropeChunkSize"));
+    ropeChunkSize_ = 0;
+  }
+  for (auto& output : get_config()["outputs"]) {
+    try
+    {
+      if (listsPerBatch_ > 0)
+      {
+        batchOutputQueues_.emplace_back(new ListQueueSink<batch_t>(output, &stopSignal_));
+      }
+      else if (ropeChunkSize_ > 0)
+      {
+        ropeOutputQueues_.emplace_back(new ListQueueSink<rope_message_t>(output, &stopSignal_));
+      }
+      else
+      {
+        outputQueues_.emplace_back(new ListQueueSink<message_t>(output, &stopSignal_));
+      }
+    }
+    catch (const std::exception& excpt)
+    {
+      throw InvalidQueueFatalError(ERS_HERE, get_name(), ListQueueReference::name_of(output), excpt);
+    }
+    outputQueueAccounts_.push_back(&MemoryAccount::get(MemoryAccount::Kind::kQueue, ListQueueReference::name_of(output)));
+    outputQueueOccupancies_.push_back(&QueueOccupancy::get(ListQueueReference::name_of(output)));
+  }
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
+}
+
+template<typename T>
+void
+RandomDataListGenerator<T>::do_configure(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_configure() method";
+  nIntsPerList_ = get_config().value<size_t>("nIntsPerList", static_cast<size_t>(REASONABLE_DEFAULT_INTSPERLIST));
+  waitBetweenSendsMsec_ = get_config().value<size_t>("waitBetweenSendsMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENSENDS));
+  streamId_ = get_config().value<uint32_t>("streamId", static_cast<uint32_t>(REASONABLE_DEFAULT_STREAMID));
+  priority_ = get_config().value<uint32_t>("priority", REASONABLE_DEFAULT_PRIORITY);
+  deadline_ = std::chrono::milliseconds(
+    get_config().value<size_t>("deadlineMsec", static_cast<size_t>(REASONABLE_DEFAULT_DEADLINEMSEC)));
+  computeChecksums_ = get_config().value<bool>("computeChecksums", REASONABLE_DEFAULT_COMPUTECHECKSUMS);
+  bufferPool_ = &ListBufferPool::get(
+    get_config().value<std::string>("bufferPoolName", REASONABLE_DEFAULT_BUFFERPOOLNAME),
+    get_config().value<size_t>("bufferPoolFreeListCapacity", ListBufferPool::DEFAULT_FREE_LIST_CAPACITY));
+  inlineListThreshold_ = get_config().value<size_t>("inlineListThreshold", message_t::payload_t::INLINE_CAPACITY);
+  // the budget belongs to the pool, so it covers the buffers of every module that uses the pool
+  bufferPool_->get_budget().set_limit(
+    get_config().value<size_t>("inFlightByteLimit", REASONABLE_DEFAULT_INFLIGHTBYTELIMIT));
+  memoryReportInterval_ = std::chrono::milliseconds(get_config().value<size_t>(
+    "memoryReportIntervalMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS)));
+  calibrationInterval_ = std::chrono::milliseconds(
+    get_config().value<size_t>("calibrationMsec", static_cast<size_t>(REASONABLE_DEFAULT_CALIBRATIONMSEC)));
+  calibrationTargetRate_ = get_config().value<double>("calibrationTargetRate", REASONABLE_DEFAULT_CALIBRATIONTARGETRATE);
+  calibrationOutputFile_ =
+    get_config().value<std::string>("calibrationOutputFile", REASONABLE_DEFAULT_CALIBRATIONOUTPUTFILE);
+
+  apply_slab_huge_page_setting(get_name(), get_config());
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_configure() method";
+}
+
+template<typename T>
+void
+RandomDataListGenerator<T>::do_start(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
+  stopSignal_.reset();
+  thread_.start_working_thread();
+  ERS_LOG(get_name() << " successfully started");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
+}
+
+template<typename T>
+void
+RandomDataListGenerator<T>::do_stop(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
+  stopSignal_.request_stop();
+  thread_.stop_working_thread();
+  ERS_LOG(get_name() << " successfully stopped");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_stop() method";
+}
+
+template<typename T>
+void
+RandomDataListGenerator<T>::do_unconfigure(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_unconfigure() method";
+  nIntsPerList_ = REASONABLE_DEFAULT_INTSPERLIST;
+  waitBetweenSendsMsec_ = REASONABLE_DEFAULT_MSECBETWEENSENDS;
+  streamId_ = REASONABLE_DEFAULT_STREAMID;
+  priority_ = REASONABLE_DEFAULT_PRIORITY;
+  deadline_ = std::chrono::milliseconds(REASONABLE_DEFAULT_DEADLINEMSEC);
+  computeChecksums_ = REASONABLE_DEFAULT_COMPUTECHECKSUMS;
+  bufferPool_->get_budget().set_limit(REASONABLE_DEFAULT_INFLIGHTBYTELIMIT);
+  memoryReportInterval_ = std::chrono::milliseconds(REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS);
+  calibrationInterval_ = std::chrono::milliseconds(REASONABLE_DEFAULT_CALIBRATIONMSEC);
+  calibrationTargetRate_ = REASONABLE_DEFAULT_CALIBRATIONTARGETRATE;
+  calibrationOutputFile_ = REASONABLE_DEFAULT_CALIBRATIONOUTPUTFILE;
+  bufferPool_ = &ListBufferPool::get(REASONABLE_DEFAULT_BUFFERPOOLNAME);
+  inlineListThreshold_ = message_t::payload_t::INLINE_CAPACITY;
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_unconfigure() method";
+}
+
+template<typename T>
+void
+RandomDataListGenerator<T>::do_work(std::atomic<bool>& running_flag)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_work() method";
+  size_t generatedCount = 0;
+  size_t sentCount = 0;
+  size_t droppedCount = 0;
+  IssueStormLimiter pushTimeoutLimiter;
+  IssueStormLimiter noOutputQueuesAvailableLimiter;
+  auto report_suppressed_issues = [&](bool flush) {
+    pushTimeoutLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "push timeout on output queue",
+                                             suppressedCount, totalCount));
+      },
+      flush);
+    noOutputQueuesAvailableLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "no output queues available",
+                                             suppressedCount, totalCount));
+      },
+      flush);
+  };
+  // the queues are reported by the module that pushes onto them, so that each is reported once
+  auto report_memory = [&]() {
+    std::ostringstream oss_mem;
+    oss_mem << "Memory accounting: " << *memoryAccount_;
+    for (auto* queueAccount : outputQueueAccounts_)
+    {
+      oss_mem << "; " << *queueAccount;
+    }
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_mem.str()));
+    std::ostringstream oss_occ;
+    oss_occ << "Queue occupancy: ";
+    for (size_t idx = 0; idx < outputQueueOccupancies_.size(); ++idx)
+    {
+      oss_occ << (idx > 0 ? "; " : "") << *outputQueueOccupancies_[idx];
+    }
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_occ.str()));
+  };
+  auto lastMemoryReportTime = std::chrono::steady_clock::now();
+
+  // the calibration covers every queue of the process, not only the outputs of this module
+  QueueCapacityCalibration calibration(calibrationTargetRate_);
+  bool calibrating = calibrationInterval_.count() > 0;
+  if (calibrating)
+  {
+    calibration.start();
+  }
+  auto calibrationStartTime = std::chrono::steady_clock::now();
+  auto finish_calibration = [&]() {
+    auto recommendations = calibration.recommend();
+    for (auto& recommendation : recommendations)
+    {
+      std::ostringstream oss_cal;
+      oss_cal << "Queue capacity calibration: " << recommendation;
+      ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_cal.str()));
+    }
+    if (!calibrationOutputFile_.empty())
+    {
+      try
+      {
+        QueueCapacityCalibration::write(calibrationOutputFile_, recommendations);
+      }
+      catch (const std::exception& excpt)
+      {
+        ers::warning(CalibrationOutputWarning(ERS_HERE, get_name(), excpt.what()));
+      }
+    }
+    calibrating = false;
+  };
+
+  while (running_flag.load() && !stopSignal_.stop_requested()) {
+    report_suppressed_issues(false);
+    if (std::chrono::steady_clock::now() - lastMemoryReportTime >= memoryReportInterval_)
+    {
+      report_memory();
+      lastMemoryReportTime = std::chrono::steady_clock::now();
+    }
+    if (calibrating && std::chrono::steady_clock::now() - calibrationStartTime >= calibrationInterval_)
+    {
+      finish_calibration();
+    }
+
+    // wait for the downstream modules to release enough list data before generating more;
+    // lists that are stored inline take no buffer, and are bounded by the queue capacities
+    size_t requiredBytes = 0;
+    if (listsPerBatch_ > 0)
+    {
+      requiredBytes = ListBufferPool::footprint<T>(listsPerBatch_ * nIntsPerList_) +
+                      ListBufferPool::footprint<int>(listsPerBatch_ + 1);
+    }
+    else if (ropeChunkSize_ > 0)
+    {
+      size_t chunkCount = (nIntsPerList_ + ropeChunkSize_ - 1) / ropeChunkSize_;
+      requiredBytes = chunkCount * ListBufferPool::footprint<T>(ropeChunkSize_);
+    }
+    else if (nIntsPerList_ > inlineListThreshold_)
+    {
+      requiredBytes = ListBufferPool::footprint<T>(nIntsPerList_);
+    }
+    if (requiredBytes > 0 && !bufferPool_->get_budget().wait_for_room(requiredBytes, queueTimeout_, &stopSignal_))
+    {
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Still waiting for " << requiredBytes
+                                 << " bytes of in-flight budget";
+      continue;
+    }
+
+    size_t outputQueueCount = 0;
+    if (listsPerBatch_ > 0)
+    {
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Creating a batch of " << listsPerBatch_ << " lists of length "
+                                 << nIntsPerList_;
+      batch_t theBatch = batch_t::allocate(listsPerBatch_, nIntsPerList_, bufferPool_);
+      for (auto& value : theBatch.payload)
+      {
+        value = random_list_element<T>();
+      }
+      theBatch.header.streamId = streamId_;
+      theBatch.header.priority = priority_;
+      theBatch.header.sequenceNumber = generatedCount;
+      if (computeChecksums_)
+      {
+        theBatch.set_checksum();
+      }
+      theBatch.header.creationTime = batch_t::clock_t::now();
+      if (deadline_.count() > 0)
+      {
+        theBatch.header.set_deadline(theBatch.header.creationTime + deadline_);
+      }
+      generatedCount++;
+
+      size_t footprint = theBatch.memory_footprint();
+      memoryAccount_->record_allocation(footprint);
+
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Pushing batch onto " << batchOutputQueues_.size() << " outputQueues";
+      sentCount += push_to_outputs(batchOutputQueues_, theBatch, droppedCount, running_flag, pushTimeoutLimiter, report_suppressed_issues);
+      outputQueueCount = batchOutputQueues_.size();
+      memoryAccount_->record_release(footprint);
+    }
+    else if (ropeChunkSize_ > 0)
+    {
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Creating a rope of length " << nIntsPerList_
+                                 << " in chunks of " << ropeChunkSize_;
+      rope_message_t theMessage;
+      theMessage.payload = rope_message_t::payload_t::allocate(nIntsPerList_, ropeChunkSize_, bufferPool_);
+      for (size_t chunkIdx = 0; chunkIdx < theMessage.payload.chunk_count(); ++chunkIdx)
+      {
+        T* chunkData = theMessage.payload.chunk_data(chunkIdx);
+        for (size_t idx = 0, chunkSize = theMessage.payload.chunk(chunkIdx).buffer.size(); idx < chunkSize; ++idx)
+        {
+          chunkData[idx] = random_list_element<T>();
+        }
+      }
+      theMessage.header.streamId = streamId_;
+      theMessage.header.priority = priority_;
+      theMessage.header.sequenceNumber = generatedCount;
+      if (computeChecksums_)
+      {
+        theMessage.set_checksum();
+      }
+      theMessage.header.creationTime = rope_message_t::clock_t::now();
+      if (deadline_.count() > 0)
+      {
+        theMessage.header.set_deadline(theMessage.header.creationTime + deadline_);
+      }
+      generatedCount++;
+      size_t footprint = theMessage.memory_footprint();
+      memoryAccount_->record_allocation(footprint);
+
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Pushing rope onto " << ropeOutputQueues_.size() << " outputQueues";
+      sentCount += push_to_outputs(ropeOutputQueues_, theMessage, droppedCount, running_flag, pushTimeoutLimiter, report_suppressed_issues);
+      outputQueueCount = ropeOutputQueues_.size();
+      memoryAccount_->record_release(footprint);
+    }
+    else
+    {
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Creating list of length " << nIntsPerList_;
+      message_t theMessage;
+      // a list for a single output queue is created where that queue carries it, if it can be
+      theMessage.payload =
+        outputQueues_.size() == 1
+          ? outputQueues_.front()->allocate_payload(nIntsPerList_, bufferPool_, inlineListThreshold_, queueTimeout_)
+          : message_t::payload_t::allocate(nIntsPerList_, bufferPool_, inlineListThreshold_);
+      typename message_t::payload_t& theList = theMessage.payload;
+
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Start of fill loop";
+      for (size_t idx = 0; idx < nIntsPerList_; ++idx)
+      {
+        theList[idx] = random_list_element<T>();
+      }
+      theMessage.header.streamId = streamId_;
+      theMessage.header.priority = priority_;
+      theMessage.header.sequenceNumber = generatedCount;
+      if (computeChecksums_)
+      {
+        theMessage.set_checksum();
+      }
+      theMessage.header.creationTime = message_t::clock_t::now();
+      if (deadline_.count() > 0)
+      {
+        theMessage.header.set_deadline(theMessage.header.creationTime + deadline_);
+      }
+      generatedCount++;
+      std::ostringstream oss_prog;
+      oss_prog << "Generated list #" << generatedCount << " with contents " << theList
+               << " and size " << theList.size() << ". ";
+      ers::debug(ProgressUpdate(ERS_HERE, get_name(), oss_prog.str()));
+      size_t footprint = theMessage.memory_footprint();
+      memoryAccount_->record_allocation(footprint);
+
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Pushing list onto " << outputQueues_.size() << " outputQueues";
+      sentCount += push_to_outputs(outputQueues_, theMessage, droppedCount, running_flag, pushTimeoutLimiter, report_suppressed_issues);
+      outputQueueCount = outputQueues_.size();
+      memoryAccount_->record_release(footprint);
+    }
+    if (outputQueueCount == 0 && noOutputQueuesAvailableLimiter.record())
+    {
+      ers::warning(NoOutputQueuesAvailableWarning(ERS_HERE, get_name()));
+    }
+
+    TLOG(TLVL_LIST_GENERATION) << get_name() << ": Start of sleep between sends";
+    stopSignal_.sleep_for(std::chrono::milliseconds(waitBetweenSendsMsec_));
+    TLOG(TLVL_LIST_GENERATION) << get_name() << ": End of do_work loop";
+  }
+  report_suppressed_issues(true);
+  if (calibrating)
+  {
+    // a run that is stopped early still gets recommendations from the part that it ran
+    finish_calibration();
+  }
+
+  std::ostringstream oss_summ;
+  oss_summ << ": Exiting the do_work() method, generated " << generatedCount
+           << (listsPerBatch_ > 0 ? " batches" : " lists") << " and successfully sent " << sentCount << " copies, after " << droppedCount
+           << " were dropped by queues that can not hold them. ";
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_summ.str()));
+
+  report_memory();
+
+  std::ostringstream oss_pool;
+  oss_pool << "List buffer pool \"" << bufferPool_->get_name() << "\": " << bufferPool_->get_statistics() << ". ";
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_pool.str()));
+
+  std::ostringstream oss_budget;
+  oss_budget << "In-flight byte budget of list buffer pool \"" << bufferPool_->get_name()
+             << "\": " << bufferPool_->get_budget().get_statistics() << ". ";
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_budget.str()));
+
+  SlabAllocator& slabAllocator = SlabAllocator::get();
+  std::ostringstream oss_slab;
+  oss_slab << "Slab allocator \"" << slabAllocator.get_name() << "\": " << slabAllocator.get_statistics() << ". ";
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_slab.str()));
+  if (slabAllocator.get_arena() != nullptr) {
+    std::ostringstream oss_arena;
+    oss_arena << "Huge page arena: " << slabAllocator.get_arena()->get_statistics() << ". ";
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_arena.str()));
+  }
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_work() method";
+}
+
+template<typename T>
+template<typename Message>
+size_t
+RandomDataListGenerator<T>::push_to_outputs(std::vector<std::unique_ptr<ListQueueSink<Message>>>& outputQueues,
+                                            const Message& message,
+                                            size_t& droppedCount,
+                                            std::atomic<bool>& running_flag,
+                                            IssueStormLimiter& pushTimeoutLimiter,
+                                            const std::function<void(bool)>& reportSuppressedIssues)
+{
+  size_t sentCount = 0;
+  size_t footprint = message.memory_footprint();
+  for (size_t queueIndex = 0; queueIndex < outputQueues.size(); ++queueIndex)
+  {
+    auto& outQueue = outputQueues[queueIndex];
+    std::string thisQueueName = outQueue->get_name();
+    bool successfullyWasSent = false;
+    while (!successfullyWasSent && running_flag.load() && !stopSignal_.stop_requested())
+    {
+      reportSuppressedIssues(false);
+      TLOG(TLVL_LIST_GENERATION) << get_name() << ": Pushing the generated message onto queue " << thisQueueName;
+      try
+      {
+        if (outQueue->push(message, queueTimeout_))
+        {
+          if (!outQueue->is_cross_process())
+          {
+            outputQueueAccounts_[queueIndex]->record_receipt(footprint);
+          }
+          ++sentCount;
+        }
+        else
+        {
+          ++droppedCount;
+        }
+        successfullyWasSent = true;
+      }
+      catch (const dunedaq::appfwk::QueueTimeoutExpired& excpt)
+      {
+        if (!stopSignal_.stop_requested() && pushTimeoutLimiter.record())
+        {
+          std::ostringstream oss_warn;
+          oss_warn << "push to output queue \"" << thisQueueName << "\"";
+          ers::warning(dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, get_name(), oss_warn.str(),
+                       std::chrono::duration_cast<std::chrono::milliseconds>(queueTimeout_).count()));
+        }
+      }
+    }
+  }
+  return sentCount;
+}
+
+} // namespace afv1_example 
+} // namespace dunedaq
+
+// the TRACE settings above are for this file alone, not for the files that include it
+#undef TRACE_NAME
+#undef TLVL_ENTER_EXIT_METHODS
+#undef TLVL_LIST_GENERATION
+
+#endif // AFV1_EXAMPLE_SRC_DETAIL_RANDOMDATALISTGENERATOR_HXX_
@@ -0,0 +1,670 @@
+/**
+ * @file ReversedListValidator.hxx ReversedListValidator class template
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef AFV1_EXAMPLE_SRC_DETAIL_REVERSEDLISTVALIDATOR_HXX_
+#define AFV1_EXAMPLE_SRC_DETAIL_REVERSEDLISTVALIDATOR_HXX_
+
+#include "CommonIssues.hpp"
+#include "IssueStormLimiter.hpp"
+#include "LatencyHistogram.hpp"
+#include "ListCaptureFile.hpp"
+#include "ListReversalKernels.hpp"
+#include "ReversedListComparison.hpp"
+#include "SequenceTracker.hpp"
+#include "SlabHugePageSetting.hpp"
+
+#include <ers/ers.h>
+#include "TRACE/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+/**
+ * @brief Name used by TRACE TLOG calls from this source file
+ */
+#define TRACE_NAME "ReversedListValidator" // NOLINT
+#define TLVL_ENTER_EXIT_METHODS 10
+#define TLVL_LIST_VALIDATION 15
+
+namespace dunedaq {
+namespace afv1_example {
+
+template<typename T>
+ReversedListValidator<T>::ReversedListValidator(const std::string& name)
+  : DAQModule(name)
+  , thread_(std::bind(&ReversedListValidator::do_work, this, std::placeholders::_1))
+  , reversedDataQueue_(nullptr)
+  , originalDataQueue_(nullptr)
+  , queueTimeout_(100)
+  , latencyReportInterval_(REASONABLE_DEFAULT_MSECBETWEENLATENCYREPORTS)
+  , memoryAccount_(&MemoryAccount::get(MemoryAccount::Kind::kModule, name))
+{
+  register_command("start", &ReversedListValidator::do_start);
+  register_command("stop", &ReversedListValidator::do_stop);
+}
+
+template<typename T>
+void
+ReversedListValidator<T>::init()
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering init() method";
+  batchMode_ = get_config().value<bool>("batchMode", REASONABLE_DEFAULT_BATCHMODE);
+  ropeMode_ = get_config().value<bool>("ropeMode", REASONABLE_DEFAULT_ROPEMODE);
+  if (batchMode_ && ropeMode_)
+  {
+    ers::warning(ConflictingSettingsWarning(ERS_HERE, get_name(), "batchMode", "ropeMode"));
+    ropeMode_ = false;
+  }
+
+  try
+  {
+    if (batchMode_)
+    {
+      reversedBatchQueue_.reset(new ListQueueSource<batch_t>(get_config()["reversed_data_input"], &stopSignal_));
+    }
+    else if (ropeMode_)
+    {
+      reversedRopeQueue_.reset(new ListQueueSource<rope_message_t>(get_config()["reversed_data_input"], &stopSignal_));
+    }
+    else
+    {
+      reversedDataQueue_.reset(new ListQueueSource<message_t>(get_config()["reversed_data_input"], &stopSignal_));
+    }
+  }
+  catch (const std::exception& excpt)
+  {
+    throw InvalidQueueFatalError(ERS_HERE, get_name(), "reversed data input", excpt);
+  }
+
+  // without an original data input, the reversed lists are only checked against their checksums,
+  // which lets several validators share the output of several reversers
+  if (get_config().contains("original_data_input"))
+  {
+    try
+    {
+      if (batchMode_)
+      {
+        originalBatchQueue_.reset(new ListQueueSource<batch_t>(get_config()["original_data_input"], &stopSignal_));
+      }
+      else if (ropeMode_)
+      {
+        originalRopeQueue_.reset(new ListQueueSource<rope_message_t>(get_config()["original_data_input"], &stopSignal_));
+      }
+      else
+      {
+        originalDataQueue_.reset(new ListQueueSource<message_t>(get_config()["original_data_input"], &stopSignal_));
+      }
+    }
+    catch (const std::exception& excpt)
+    {
+      throw InvalidQueueFatalError(ERS_HERE, get_name(), "original data input", excpt);
+    }
+  }
+
+  latencyReportInterval_ = std::chrono::milliseconds(get_config().value<size_t>(
+    "latencyReportIntervalMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENLATENCYREPORTS)));
+  captureFilePrefix_ = get_config().value<std::string>("captureFilePrefix", "");
+  memoryReportInterval_ = std::chrono::milliseconds(get_config().value<size_t>(
+    "memoryReportIntervalMsec", static_cast<size_t>(REASONABLE_DEFAULT_MSECBETWEENMEMORYREPORTS)));
+  apply_slab_huge_page_setting(get_name(), get_config());
+  reversedQueueAccount_ =
+    &MemoryAccount::get(MemoryAccount::Kind::kQueue, ListQueueReference::name_of(get_config()["reversed_data_input"]));
+  if (get_config().contains("original_data_input"))
+  {
+    originalQueueAccount_ =
+      &MemoryAccount::get(MemoryAccount::Kind::kQueue, ListQueueReference::name_of(get_config()["original_data_input"]));
+  }
+
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
+}
+
+template<typename T>
+void
+ReversedListValidator<T>::do_start(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
+  stopSignal_.reset();
+  thread_.start_working_thread();
+  ERS_LOG(get_name() << " successfully started");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
+}
+
+template<typename T>
+void
+ReversedListValidator<T>::do_stop(const std::vector<std::string>& /*args*/)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
+  stopSignal_.request_stop();
+  thread_.stop_working_thread();
+  ERS_LOG(get_name() << " successfully stopped");
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_stop() method";
+}
+
+template<typename T>
+bool
+ReversedListValidator<T>::contents_are_reversed(const message_t& original, const message_t& reversed)
+{
+  return is_reverse_of(original.data(), reversed.data());
+}
+
+template<typename T>
+bool
+ReversedListValidator<T>::same_list_boundaries(const batch_t& original, const batch_t& reversed)
+{
+  return original.offsets.size() == reversed.offsets.size() &&
+         std::equal(original.offsets.begin(), original.offsets.end(), reversed.offsets.begin()) &&
+         original.data().size() == reversed.data().size();
+}
+
+template<typename T>
+bool
+ReversedListValidator<T>::contents_are_reversed(const batch_t& original, const batch_t& reversed)
+{
+  if (!same_list_boundaries(original, reversed))
+  {
+    return false;
+  }
+  return first_unreversed_list(original.data().data(), reversed.data().data(), original.offsets.data(),
+                               original.list_count()) == original.list_count();
+}
+
+template<typename T>
+std::string
+ReversedListValidator<T>::describe_mismatch(const message_t& original, const message_t& reversed)
+{
+  std::ostringstream oss_report;
+  oss_report << make_mismatch_report(original.data(), reversed.data());
+  return oss_report.str();
+}
+
+template<typename T>
+std::string
+ReversedListValidator<T>::describe_mismatch(const batch_t& original, const batch_t& reversed)
+{
+  std::ostringstream oss_report;
+  if (!same_list_boundaries(original, reversed))
+  {
+    oss_report << "the list boundaries of the batches differ: the original batch has " << original.list_count()
+               << " list(s) with " << original.data().size() << " values, the reversed batch "
+               << reversed.list_count() << " list(s) with " << reversed.data().size() << " values";
+    return oss_report.str();
+  }
+  size_t idx = first_unreversed_list(original.data().data(), reversed.data().data(), original.offsets.data(),
+                                     original.list_count());
+  oss_report << "list " << idx << " of " << original.list_count() << " in the batch: "
+             << make_mismatch_report(original.list_data(idx), original.list_size(idx), reversed.list_data(idx),
+                                     reversed.list_size(idx));
+  return oss_report.str();
+}
+
+template<typename T>
+bool
+ReversedListValidator<T>::contents_are_reversed(const rope_message_t& original, const rope_message_t& reversed)
+{
+  return is_reverse_of(original.data(), reversed.data());
+}
+
+template<typename T>
+std::string
+ReversedListValidator<T>::describe_mismatch(const rope_message_t& original, const rope_message_t& reversed)
+{
+  // mismatches are rare, so the elements are simply gathered into contiguous lists to be reported on
+  std::ostringstream oss_report;
+  oss_report << make_mismatch_report(original.data().to_vector(), reversed.data().to_vector());
+  return oss_report.str();
+}
+
+template<typename T>
+void
+ReversedListValidator<T>::do_work(std::atomic<bool>& running_flag)
+{
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_work() method";
+  if (batchMode_)
+  {
+    process_messages(running_flag, *reversedBatchQueue_, originalBatchQueue_.get());
+  }
+  else if (ropeMode_)
+  {
+    process_messages(running_flag, *reversedRopeQueue_, originalRopeQueue_.get());
+  }
+  else
+  {
+    process_messages(running_flag, *reversedDataQueue_, originalDataQueue_.get());
+  }
+  TLOG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_work() method";
+}
+
+template<typename T>
+template<typename Message>
+void
+ReversedListValidator<T>::process_messages(std::atomic<bool>& running_flag,
+                                           ListQueueSource<Message>& reversedDataQueue,
+                                           ListQueueSource<Message>* originalDataQueue)
+{
+  int reversedCount = 0;
+  int comparisonCount = 0;
+  int failureCount = 0;
+  int checksumFailureCount = 0;
+  int unpairedReversedCount = 0;
+  int unpairedOriginalCount = 0;
+  int uncheckableCount = 0;
+  int expiredReversedCount = 0;
+  int expiredOriginalCount = 0;
+  size_t validatedListCount = 0;
+  Message reversedMessage;
+  Message originalMessage;
+  LatencyHistogram intervalLatencies;
+  LatencyHistogram runLatencies;
+  auto lastLatencyReportTime = Message::clock_t::now();
+  SequenceTracker reversedSequence;
+  SequenceTracker originalSequence;
+  IssueStormLimiter mismatchLimiter;
+  IssueStormLimiter checksumLimiter;
+  IssueStormLimiter originalTimeoutLimiter;
+  IssueStormLimiter sequenceGapLimiter;
+  IssueStormLimiter duplicateSequenceLimiter;
+  // when several modules share a queue, each sees only some of the sequence numbers, and not
+  // necessarily in order, so they are not checked
+  bool checkReversedSequence = !reversedDataQueue.is_shared();
+  bool checkOriginalSequence = originalDataQueue != nullptr && !originalDataQueue->is_shared();
+  if (originalDataQueue != nullptr && (!checkReversedSequence || !checkOriginalSequence))
+  {
+    ers::warning(UnorderedInputsWarning(ERS_HERE, get_name(),
+                                        checkReversedSequence ? originalDataQueue->get_name() : reversedDataQueue.get_name()));
+  }
+  auto check_sequence = [&](SequenceTracker& tracker, const Message& message, const std::string& inputDescription) {
+    uint64_t gapSize = 0;
+    switch (tracker.check(message.header.streamId, message.header.sequenceNumber, &gapSize))
+    {
+      case SequenceTracker::Result::kGap:
+        if (sequenceGapLimiter.record())
+        {
+          ers::warning(SequenceGapDetected(ERS_HERE, get_name(), inputDescription, message.header.streamId,
+                                           message.header.sequenceNumber, gapSize));
+        }
+        break;
+      case SequenceTracker::Result::kDuplicate:
+        if (duplicateSequenceLimiter.record())
+        {
+          ers::warning(DuplicateSequenceNumber(ERS_HERE, get_name(), inputDescription, message.header.streamId,
+                                               message.header.sequenceNumber));
+        }
+        break;
+      default:
+        break;
+    }
+  };
+  auto report_suppressed_issues = [&](bool flush) {
+    mismatchLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::error(SuppressedIssuesSummary(ERS_HERE, get_name(), "data mismatch", suppressedCount, totalCount));
+      },
+      flush);
+    checksumLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::error(SuppressedIssuesSummary(ERS_HERE, get_name(), "checksum mismatch", suppressedCount, totalCount));
+      },
+      flush);
+    originalTimeoutLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "pop timeout on original data queue",
+                                             suppressedCount, totalCount));
+      },
+      flush);
+    sequenceGapLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(SuppressedIssuesSummary(ERS_HERE, get_name(), "sequence gap", suppressedCount, totalCount));
+      },
+      flush);
+    duplicateSequenceLimiter.report_summary_if_due(
+      [&](size_t suppressedCount, size_t totalCount) {
+        ers::warning(
+          SuppressedIssuesSummary(ERS_HERE, get_name(), "duplicate sequence number", suppressedCount, totalCount));
+      },
+      flush);
+  };
+
+  // When a capture file prefix is configured, every list received on each input is
+  // recorded, so that the run can be validated again offline by validate_list_captures
+  std::unique_ptr<ListCaptureWriter> originalCapture;
+  std::unique_ptr<ListCaptureWriter> reversedCapture;
+  if (!captureFilePrefix_.empty() && batchMode_)
+  {
+    ers::warning(CaptureFileError(ERS_HERE, get_name(), "capture files can only be written for individual lists, not in batch mode"));
+  }
+  else if (!captureFilePrefix_.empty())
+  {
+    std::string fileStem = captureFilePrefix_ + "_" + std::to_string(captureCount_++);
+    try
+    {
+      originalCapture.reset(new ListCaptureWriter(fileStem + "_original.lists", sizeof(T)));
+      reversedCapture.reset(new ListCaptureWriter(fileStem + "_reversed.lists", sizeof(T)));
+    }
+    catch (const std::exception& excpt)
+    {
+      ers::error(CaptureFileError(ERS_HERE, get_name(), excpt.what()));
+      originalCapture.reset();
+      reversedCapture.reset();
+    }
+  }
+  auto capture = [&](std::unique_ptr<ListCaptureWriter>& writer, const Message& message) {
+    if (writer == nullptr)
+    {
+      return;
+    }
+    try
+    {
+      if constexpr (std::is_same<Message, rope_message_t>::value)
+      {
+        std::vector<T> elements = message.data().to_vector();
+        writer->write(message.header.streamId, message.header.sequenceNumber, elements.data(), elements.size());
+      }
+      else
+      {
+        writer->write(message.header.streamId, message.header.sequenceNumber, message.data().data(), message.data().size());
+      }
+    }
+    catch (const std::exception& excpt)
+    {
+      ers::error(CaptureFileError(ERS_HERE, get_name(), excpt.what()));
+      originalCapture.reset();
+      reversedCapture.reset();
+    }
+  };
+
+  // Original lists that have been received but not yet paired with a reversed list, by stream and
+  // oldest first. The lists of each stream are in the same order on both inputs, but the streams
+  // may be interleaved differently on each, so originals of other streams are set aside here
+  // until the reversed lists of their stream come along.
+  struct PendingOriginal
+  {
+    Message message;
+    size_t footprint;
+  };
+  std::map<uint32_t, std::deque<PendingOriginal>> pendingOriginals;
+
+  // the bytes of the message that each of the working messages holds, as recorded in this module's account
+  size_t reversedFootprint = 0;
+  size_t originalFootprint = 0;
+  auto take_from_queue = [&](const ListQueueSource<Message>& queue, MemoryAccount& queueAccount,
+                             const Message& message, size_t& footprint) {
+    footprint = message.memory_footprint();
+    if (queue.is_cross_process()) {
+      // the message was copied in from another process, into buffers that this module now holds
+      memoryAccount_->record_allocation(footprint);
+    } else {
+      queueAccount.record_release(footprint);
+      memoryAccount_->record_receipt(footprint);
+    }
+  };
+  auto drop = [&](size_t& footprint) {
+    memoryAccount_->record_release(footprint);
+    footprint = 0;
+  };
+  // the input queues are reported by the modules that push onto them
+  auto report_memory = [&]() {
+    std::ostringstream oss_mem;
+    oss_mem << "Memory accounting: " << *memoryAccount_;
+    ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_mem.str()));
+  };
+  auto lastMemoryReportTime = std::chrono::steady_clock::now();
+  auto record_latency = [&](const Message& message) {
+    auto now = Message::clock_t::now();
+    intervalLatencies.record(now - message.header.creationTime);
+    if (now - lastLatencyReportTime >= latencyReportInterval_)
+    {
+      std::ostringstream oss_lat;
+      oss_lat << "Generation-to-validation latency for the " << intervalLatencies.count()
+              << " lists validated since the previous report: " << intervalLatencies;
+      ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_lat.str()));
+      runLatencies.merge(intervalLatencies);
+      intervalLatencies.reset();
+      lastLatencyReportTime = now;
+    }
+  };
+
+  while (running_flag.load() && !stopSignal_.stop_requested()) {
+    report_suppressed_issues(false);
+    if (std::chrono::steady_clock::now() - lastMemoryReportTime >= memoryReportInterval_)
+    {
+      report_memory();
+      lastMemoryReportTime = std::chrono::steady_clock::now();
+    }
+
+    TLOG(TLVL_LIST_VALIDATION) << get_name() << ": Going to receive data from the reversed list queue";
+    try
+    {
+      reversedDataQueue.pop(reversedMessage, queueTimeout_);
+    }
+    catch (const dunedaq::appfwk::QueueTimeoutExpired& excpt)
+    {
+      // it is perfectly reasonable that there might be no reversed data in the queue 
+      // some fraction of the times that we check, so we just continue on and try again
+      continue;
+    }
+    ++reversedCount;
+    take_from_queue(reversedDataQueue, *reversedQueueAccount_, reversedMessage, reversedFootprint);
+    if (checkReversedSequence)
+    {
+      check_sequence(reversedSequence, reversedMessage, "reversed data queue");
+    }
+    // a list and its reversed copy have the same deadline, so the originals are judged at the
+    // time of this pop too, and a pair is either validated or dropped as a whole
+    auto popTime = Message::clock_t::now();
+    if (reversedMessage.header.is_expired(popTime))
+    {
+      ++expiredReversedCount;
+      reversedMessage = Message();
+      drop(reversedFootprint);
+      continue;
+    }
+    capture(reversedCapture, reversedMessage);
+
+    if (originalDataQueue == nullptr)
+    {
+      // the checksum in the header was computed from the original list, so it is checked with
+      // the reversed list read back-to-front
+      if (!(reversedMessage.header.flags & ListMessageHeader::kHasChecksum))
+      {
+        ++uncheckableCount;
+      }
+      else
+      {
+        ++comparisonCount;
+        if (!reversedMessage.checksum_matches(true))
+        {
+          if (checksumLimiter.record())
+          {
+            ers::error(ChecksumMismatchError(ERS_HERE, get_name(), reversedMessage.header.streamId,
+                                             reversedMessage.header.sequenceNumber));
+          }
+          ++checksumFailureCount;
+        }
+        validatedListCount += reversedMessage.list_count();
+        record_latency(reversedMessage);
+      }
+      reversedMessage = Message();
+      drop(reversedFootprint);
+      continue;
+    }
+
+    TLOG(TLVL_LIST_VALIDATION) << get_name() << ": Received reversed list #" << reversedCount
+                             << ". It has size " << reversedMessage.data().size()
+                             << ". Now going to receive data from the original data queue.";
+    bool originalWasSuccessfullyReceived = false;
+    while (!originalWasSuccessfullyReceived && running_flag.load() && !stopSignal_.stop_requested())
+    {
+      report_suppressed_issues(false);
+      auto& pendingOfStream = pendingOriginals[reversedMessage.header.streamId];
+      if (!pendingOfStream.empty())
+      {
+        // resynchronize the two inputs using the sequence numbers within the stream: originals
+        // that are older than the reversed list lost their reversed copy, and a reversed list that
+        // is older than the oldest pending original has no original to be compared with
+        PendingOriginal& pending = pendingOfStream.front();
+        if (pending.message.header.sequenceNumber < reversedMessage.header.sequenceNumber)
+        {
+          ++unpairedOriginalCount;
+          drop(pending.footprint);
+          pendingOfStream.pop_front();
+        }
+        else if (pending.message.header.sequenceNumber > reversedMessage.header.sequenceNumber)
+        {
+          ++unpairedReversedCount;
+          break;
+        }
+        else
+        {
+          originalMessage = std::move(pending.message);
+          originalFootprint = pending.footprint;
+          pendingOfStream.pop_front();
+          originalWasSuccessfullyReceived = true;
+          ++comparisonCount;
+        }
+        continue;
+      }
+
+      TLOG(TLVL_LIST_VALIDATION) << get_name() << ": Popping the next element off the original data queue";
+      try
+      {
+        originalDataQueue->pop(originalMessage, queueTimeout_);
+        take_from_queue(*originalDataQueue, *originalQueueAccount_, originalMessage, originalFootprint);
+        if (checkOriginalSequence)
+        {
+          check_sequence(originalSequence, originalMessage, "original data queue");
+        }
+        if (originalMessage.header.is_expired(popTime))
+        {
+          ++expiredOriginalCount;
+          originalMessage = Message();
+          drop(originalFootprint);
+          continue;
+        }
+        capture(originalCapture, originalMessage);
+        auto& pendingOfOriginalStream = pendingOriginals[originalMessage.header.streamId];
+        if (pendingOfOriginalStream.size() >= MAX_PENDING_ORIGINALS_PER_STREAM)
+        {
+          // the reversed lists of this stream have stopped coming, or fallen too far behind
+          ++unpairedOriginalCount;
+          drop(pendingOfOriginalStream.front().footprint);
+          pendingOfOriginalStream.pop_front();
+        }
+        pendingOfOriginalStream.push_back(PendingOriginal{ std::move(originalMessage), originalFootprint });
+        originalFootprint = 0;
+      }
+      catch (const dunedaq::appfwk::QueueTimeoutExpired& excpt)
+      {
+        if (!stopSignal_.stop_requested() && originalTimeoutLimiter.record())
+        {
+          std::ostringstream oss_warn;
+          oss_warn << "pop from original data queue";
+          ers::warning(dunedaq::appfwk::QueueTimeoutExpired(ERS_HERE, get_name(), oss_warn.str(),
+                       std::chrono::duration_cast<std::chrono::milliseconds>(queueTimeout_).count()));
+        }
+      }
+    }
+
+    if (originalWasSuccessfullyReceived)
+    {
+      std::ostringstream oss_prog;
+      oss_prog << "Validating list #" << reversedCount << ", original contents " << originalMessage.data()
+               << " and reversed contents " << reversedMessage.data() << ". ";
+      ers::debug(ProgressUpdate(ERS_HERE, get_name(), oss_prog.str()));
+
+      if (!originalMessage.checksum_matches() || !reversedMessage.checksum_matches(true))
+      {
+        if (checksumLimiter.record())
+        {
+          ers::error(ChecksumMismatchError(ERS_HERE, get_name(), originalMessage.header.streamId,
+                                           originalMessage.header.sequenceNumber));
+        }
+        ++checksumFailureCount;
+      }
+
+      TLOG(TLVL_LIST_VALIDATION) << get_name() << ": Comparing the reversed list, read back-to-front, with the original list";
+      if (!contents_are_reversed(originalMessage, reversedMessage))
+      {
+        if (mismatchLimiter.record())
+        {
+          ers::error(DataMismatchError(ERS_HERE, get_name(), describe_mismatch(originalMessage, reversedMessage)));
+        }
+        ++failureCount;
+      }
+      validatedListCount += originalMessage.list_count();
+
+      record_latency(originalMessage);
+
+      // this is the last stage to use the lists, so dropping the payloads here is what
+      // returns their buffers to the pool that the generator takes them from
+      originalMessage = Message();
+      drop(originalFootprint);
+    }
+    reversedMessage = Message();
+    drop(reversedFootprint);
+    TLOG(TLVL_LIST_VALIDATION) << get_name() << ": End of do_work loop";
+  }
+  report_suppressed_issues(true);
+  for (auto& streamAndPending : pendingOriginals)
+  {
+    for (auto& pending : streamAndPending.second)
+    {
+      drop(pending.footprint);
+    }
+  }
+  pendingOriginals.clear();
+  originalMessage = Message();
+  drop(originalFootprint);
+  report_memory();
+
+  std::ostringstream oss_summ;
+  const char* unit = batchMode_ ? " batches" : " lists";
+  oss_summ << ": Exiting do_work() method, received " << reversedCount << " reversed" << unit << ", ";
+  if (originalDataQueue == nullptr)
+  {
+    oss_summ << "checked " << comparisonCount << " of them (" << validatedListCount
+             << " lists) against their checksums, and found " << checksumFailureCount << " checksum failures. "
+             << uncheckableCount << " reversed" << unit << " carried no checksum and could not be validated. ";
+  }
+  else
+  {
+    oss_summ << "compared " << comparisonCount << " of them (" << validatedListCount
+             << " lists) to their original data, and found " << failureCount << " mismatches and "
+             << checksumFailureCount << " checksum failures. " << unpairedReversedCount << " reversed" << unit
+             << " and " << unpairedOriginalCount << " original" << unit << " had no partner to be compared with. "
+             << expiredOriginalCount << " original" << unit << " were dropped past their deadline. ";
+  }
+  oss_summ << expiredReversedCount << " reversed" << unit << " were dropped past their deadline. ";
+  if (checkReversedSequence)
+  {
+    oss_summ << "Reversed data sequence numbers: " << reversedSequence.counters() << ". ";
+  }
+  if (checkOriginalSequence)
+  {
+    oss_summ << "Original data sequence numbers: " << originalSequence.counters() << ". ";
+  }
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_summ.str()));
+
+  runLatencies.merge(intervalLatencies);
+  std::ostringstream oss_lat;
+  oss_lat << "Generation-to-validation latency for all lists validated in this run: " << runLatencies;
+  ers::info(ProgressUpdate(ERS_HERE, get_name(), oss_lat.str()));
+}
+
+} // namespace afv1_example
+} // namespace dunedaq
+
+// the TRACE settings above are for this file alone, not for the files that include it
+#undef TRACE_NAME
+#undef TLVL_ENTER_EXIT_METHODS
+#undef TLVL_LIST_VALIDATION
+
+#endif // AFV1_EXAMPLE_SRC_DETAIL_REVERSEDLISTVALIDATOR_HXX_
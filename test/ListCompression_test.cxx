@@ -0,0 +1,278 @@
+/**
+ * @file ListCompression_test.cxx
+ *
+ * Unit tests of the integer codecs that list messages are compressed with.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#define BOOST_TEST_MODULE ListCompression_test // NOLINT
+
+#include "ListCompression.hpp"
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace dunedaq::afv1_example;
+
+namespace {
+
+using word_types = boost::mpl::list<uint16_t, uint32_t, uint64_t>;
+using lane_word_types = boost::mpl::list<uint16_t, uint32_t>;
+
+const ListCompression kCompressions[] = { ListCompression::kBitPacking,
+                                          ListCompression::kDelta,
+                                          ListCompression::kVarint };
+
+/**
+ * @brief Counts that fill whole blocks of the bit-packing, leave a partial one at the end, or
+ * leave only a partial one
+ */
+const size_t kCounts[] = { 0, 1, 5, compression_detail::BLOCK_WORDS - 1, compression_detail::BLOCK_WORDS,
+                           compression_detail::BLOCK_WORDS + 1, 3 * compression_detail::BLOCK_WORDS + 17 };
+
+template<typename W>
+std::vector<W>
+compress_and_decompress(const std::vector<W>& words, ListCompression compression, std::vector<uint8_t>& compressed)
+{
+  compressed.clear();
+  compress_words(words.data(), words.size(), compression, compressed);
+  BOOST_REQUIRE_LE(words.size(), max_decompressed_words(compressed.size()));
+  std::vector<W> decompressed(words.size());
+  BOOST_REQUIRE(decompress_words(compressed.data(), compressed.size(), compression, decompressed.data(), words.size()));
+  return decompressed;
+}
+
+/**
+ * @brief Words of the given kind: random over the whole range, small, close to the largest word,
+ * increasing, alternately up and down, or all the same
+ */
+template<typename W>
+std::vector<W>
+make_words(size_t count, int kind, std::mt19937_64& random)
+{
+  constexpr W kMax = std::numeric_limits<W>::max();
+  std::vector<W> words(count);
+  for (size_t idx = 0; idx < count; ++idx) {
+    switch (kind) {
+      case 0:
+        words[idx] = static_cast<W>(random());
+        break;
+      case 1:
+        words[idx] = static_cast<W>(random() % 1000);
+        break;
+      case 2:
+        words[idx] = static_cast<W>(kMax - random() % 50);
+        break;
+      case 3:
+        words[idx] = static_cast<W>(idx * 3);
+        break;
+      case 4:
+        words[idx] = idx % 2 == 0 ? W(0) : kMax;
+        break;
+      default:
+        words[idx] = static_cast<W>(42);
+        break;
+    }
+  }
+  return words;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ListCompression_test)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(RoundTrip, W, word_types)
+{
+  std::mt19937_64 random(20201);
+  std::vector<uint8_t> compressed;
+  for (ListCompression compression : kCompressions) {
+    for (size_t count : kCounts) {
+      for (int kind = 0; kind < 6; ++kind) {
+        std::vector<W> words = make_words<W>(count, kind, random);
+        std::vector<W> decompressed = compress_and_decompress(words, compression, compressed);
+        BOOST_TEST_CONTEXT(list_compression_name(compression) << ", " << count << " words of kind " << kind)
+        {
+          BOOST_CHECK_EQUAL_COLLECTIONS(decompressed.begin(), decompressed.end(), words.begin(), words.end());
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(FullBitWidth, W, word_types)
+{
+  // a block that spans every value of the word packs at the full width, 64 bits for uint64_t
+  std::vector<W> words = { 0, std::numeric_limits<W>::max(), 1, std::numeric_limits<W>::max() - 1, 12345 };
+  std::vector<uint8_t> compressed;
+  std::vector<W> decompressed = compress_and_decompress(words, ListCompression::kBitPacking, compressed);
+  BOOST_CHECK_EQUAL(compressed[0], 8 * sizeof(W));
+  BOOST_CHECK_EQUAL(compressed.size(), 1 + sizeof(W) + words.size() * sizeof(W));
+  BOOST_CHECK_EQUAL_COLLECTIONS(decompressed.begin(), decompressed.end(), words.begin(), words.end());
+
+  // and words that all differ by the full range in their varints
+  for (ListCompression compression : { ListCompression::kDelta, ListCompression::kVarint }) {
+    decompressed = compress_and_decompress(words, compression, compressed);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decompressed.begin(), decompressed.end(), words.begin(), words.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(ConstantBlocks, W, word_types)
+{
+  // a block of equal words packs as just its bit width of 0 and its reference
+  std::vector<W> words(2 * compression_detail::BLOCK_WORDS + 3, static_cast<W>(7));
+  std::vector<uint8_t> compressed;
+  std::vector<W> decompressed = compress_and_decompress(words, ListCompression::kBitPacking, compressed);
+  BOOST_CHECK_EQUAL(compressed.size(), 3 * (1 + sizeof(W)));
+  BOOST_CHECK_EQUAL_COLLECTIONS(decompressed.begin(), decompressed.end(), words.begin(), words.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(CorruptInput, W, word_types)
+{
+  std::mt19937_64 random(7);
+  std::vector<W> words = make_words<W>(2 * compression_detail::BLOCK_WORDS + 9, 0, random);
+  std::vector<W> out(words.size() + 1);
+
+  for (ListCompression compression : kCompressions) {
+    BOOST_TEST_CONTEXT(list_compression_name(compression))
+    {
+      std::vector<uint8_t> compressed;
+      compress_words(words.data(), words.size(), compression, compressed);
+      BOOST_REQUIRE(decompress_words(compressed.data(), compressed.size(), compression, out.data(), words.size()));
+
+      // the bytes run out before the words do
+      for (size_t bytes : { size_t(0), size_t(1), compressed.size() / 2, compressed.size() - 1 }) {
+        BOOST_CHECK(!decompress_words(compressed.data(), bytes, compression, out.data(), words.size()));
+      }
+      // more words than the bytes hold
+      BOOST_CHECK(!decompress_words(compressed.data(), compressed.size(), compression, out.data(), words.size() + 1));
+      // bytes left over after the words
+      std::vector<uint8_t> trailing = compressed;
+      trailing.push_back(0);
+      BOOST_CHECK(!decompress_words(trailing.data(), trailing.size(), compression, out.data(), words.size()));
+    }
+  }
+
+  // a bit width wider than the word
+  std::vector<uint8_t> compressed;
+  compress_words(words.data(), words.size(), ListCompression::kBitPacking, compressed);
+  compressed[0] = static_cast<uint8_t>(8 * sizeof(W) + 1);
+  BOOST_CHECK(!decompress_words(compressed.data(), compressed.size(), ListCompression::kBitPacking, out.data(), words.size()));
+
+  // a varint of a value too large for the word, and one that never ends
+  std::vector<uint8_t> tooLarge;
+  compression_detail::append_varint(tooLarge, sizeof(W) < 8 ? uint64_t(std::numeric_limits<W>::max()) + 1 : 0);
+  std::vector<uint8_t> endless(11, 0xff);
+  for (ListCompression compression : { ListCompression::kDelta, ListCompression::kVarint }) {
+    if (sizeof(W) < 8) {
+      BOOST_CHECK(!decompress_words(tooLarge.data(), tooLarge.size(), compression, out.data(), 1));
+    }
+    BOOST_CHECK(!decompress_words(endless.data(), endless.size(), compression, out.data(), 1));
+  }
+
+  // uncompressed words of the wrong size, and a compression that does not exist
+  BOOST_CHECK(!decompress_words(endless.data(), sizeof(W) + 1, ListCompression::kNone, out.data(), 1));
+  BOOST_CHECK(!decompress_words(endless.data(), sizeof(W), static_cast<ListCompression>(9), out.data(), 1));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(LaneKernels, W, lane_word_types)
+{
+  using namespace compression_detail;
+  constexpr size_t kLanes = 16 / sizeof(W);
+  std::mt19937_64 random(128);
+
+  for (unsigned bits = 0; bits <= 8 * sizeof(W); ++bits) {
+    BOOST_TEST_CONTEXT(bits << " bits")
+    {
+      W mask = static_cast<W>(bits == 8 * sizeof(W) ? ~uint64_t(0) : (uint64_t(1) << bits) - 1);
+      std::vector<W> offsets(BLOCK_WORDS);
+      for (W& offset : offsets) {
+        offset = static_cast<W>(random()) & mask;
+      }
+      offsets[BLOCK_WORDS / 2] = mask;
+
+      std::vector<uint8_t> packed(16 * bits + 16, 0xa5);
+      pack_lanes_scalar(offsets.data(), bits, packed.data());
+      std::vector<W> unpacked(BLOCK_WORDS);
+      unpack_lanes_scalar(packed.data(), bits, W(3), unpacked.data());
+      for (size_t idx = 0; idx < BLOCK_WORDS; ++idx) {
+        BOOST_CHECK_EQUAL(unpacked[idx], static_cast<W>(offsets[idx] + 3));
+      }
+      // the block takes exactly one vector per bit, and nothing after it is touched
+      BOOST_CHECK_EQUAL(packed[16 * bits], 0xa5);
+
+      // at the full width each lane holds one word per vector, so the layout is the words' own
+      if (bits == 8 * sizeof(W)) {
+        BOOST_CHECK_EQUAL(std::memcmp(packed.data(), offsets.data(), BLOCK_WORDS * sizeof(W)), 0);
+      }
+      // and below it, word i is in lane i % kLanes: its lowest bits are the lowest bits of that lane
+      if (bits > 0 && bits < 8 * sizeof(W)) {
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+          W laneWord;
+          std::memcpy(&laneWord, packed.data() + lane * sizeof(W), sizeof(W));
+          BOOST_CHECK_EQUAL(static_cast<W>(laneWord & mask), offsets[lane]);
+        }
+      }
+
+#if defined(__SSE2__)
+      // the SSE2 kernels write and read exactly the same bytes as the scalar ones
+      std::vector<uint8_t> vectorPacked(packed.size(), 0xa5);
+      pack_lanes_sse2(offsets.data(), bits, vectorPacked.data());
+      BOOST_CHECK_EQUAL_COLLECTIONS(vectorPacked.begin(), vectorPacked.end(), packed.begin(), packed.end());
+      if (bits > 0) {
+        std::vector<W> vectorUnpacked(BLOCK_WORDS);
+        unpack_lanes_sse2(packed.data(), bits, W(3), vectorUnpacked.data());
+        BOOST_CHECK_EQUAL_COLLECTIONS(vectorUnpacked.begin(), vectorUnpacked.end(), unpacked.begin(), unpacked.end());
+      }
+#endif
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(WholeBlocksPackInLanes, W, word_types)
+{
+  // whole blocks of 16-bit and 32-bit words are packed in lanes, the partial block after them and
+  // 64-bit words one word after another; both read back, at the same size
+  std::mt19937_64 random(3);
+  std::vector<W> words = make_words<W>(2 * compression_detail::BLOCK_WORDS + 5, 1, random);
+  std::vector<uint8_t> compressed;
+  std::vector<W> decompressed = compress_and_decompress(words, ListCompression::kBitPacking, compressed);
+  BOOST_CHECK_EQUAL_COLLECTIONS(decompressed.begin(), decompressed.end(), words.begin(), words.end());
+  BOOST_CHECK(compression_detail::packs_in_lanes<W>(compression_detail::BLOCK_WORDS) == (sizeof(W) < 8));
+  BOOST_CHECK(!compression_detail::packs_in_lanes<W>(5));
+
+  unsigned bits = compressed[0];
+  std::vector<uint8_t> expected(16 * bits);
+  std::vector<W> offsets(compression_detail::BLOCK_WORDS);
+  W reference = *std::min_element(words.begin(), words.begin() + compression_detail::BLOCK_WORDS);
+  for (size_t idx = 0; idx < offsets.size(); ++idx) {
+    offsets[idx] = static_cast<W>(words[idx] - reference);
+  }
+  if constexpr (sizeof(W) < 8) {
+    compression_detail::pack_lanes_scalar(offsets.data(), bits, expected.data());
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+      compressed.begin() + 1 + sizeof(W), compressed.begin() + 1 + sizeof(W) + expected.size(), expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CompressionNames)
+{
+  for (ListCompression compression : kCompressions) {
+    BOOST_CHECK(parse_list_compression(list_compression_name(compression)) == compression);
+  }
+  BOOST_CHECK(parse_list_compression("none") == ListCompression::kNone);
+  BOOST_CHECK_THROW(parse_list_compression("zstd"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
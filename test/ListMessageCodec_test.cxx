@@ -0,0 +1,439 @@
+/**
+ * @file ListMessageCodec_test.cxx
+ *
+ * Unit tests of the encoding of the list messages, ListBatches and
+ * ListRopeMessages, and of the frames that their decoders reject.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#define BOOST_TEST_MODULE ListMessageCodec_test // NOLINT
+
+#include "ListBatch.hpp"
+#include "ListBufferPool.hpp"
+#include "ListMessage.hpp"
+#include "ListMessageCodec.hpp"
+#include "ListRopeMessage.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::afv1_example;
+
+namespace {
+
+constexpr size_t kBodyOffset = sizeof(ListWireHeader) + sizeof(ListMessageHeader);
+
+/**
+ * @brief An encoded message, in a buffer that is aligned as the decoders require
+ */
+struct Frame
+{
+  std::vector<uint64_t> words;
+  size_t bytes = 0;
+
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(words.data()); }
+
+  ListWireHeader& wire_header() { return *reinterpret_cast<ListWireHeader*>(data()); }
+
+  /**
+   * @brief The count, offset or chunk table entry at the given index of the body
+   */
+  template<typename V>
+  V& body_value(size_t byteOffset)
+  {
+    return *reinterpret_cast<V*>(data() + kBodyOffset + byteOffset);
+  }
+
+  /**
+   * @brief Cuts the frame short, keeping its header consistent, so that only the body is wrong
+   */
+  void truncate(size_t newBytes)
+  {
+    bytes = newBytes;
+    wire_header().frameBytes = newBytes;
+  }
+};
+
+template<typename Message>
+Frame
+encode(const Message& message, ListCompression compression = ListCompression::kNone)
+{
+  std::vector<uint8_t> prefix;
+  std::vector<ListMessageSpan> bodySpans;
+  Frame frame;
+  frame.bytes = describe_list_message(message, prefix, bodySpans, compression);
+  frame.words.resize(frame.bytes / sizeof(uint64_t) + 1);
+  write_list_message(prefix, bodySpans, frame.data());
+  return frame;
+}
+
+template<typename Message>
+bool
+can_view(Frame& frame)
+{
+  typename ListMessageCodec<Message>::view_t view;
+  return view_list_message<Message>(frame.data(), frame.bytes, view);
+}
+
+template<typename Message>
+bool
+can_read(Frame& frame)
+{
+  Message message;
+  return read_list_message(frame.data(), frame.bytes, message, &ListBufferPool::get("default"));
+}
+
+void
+fill_header(ListMessageHeader& header, uint64_t sequenceNumber)
+{
+  header.sequenceNumber = sequenceNumber;
+  header.streamId = 3;
+  header.priority = 2;
+  header.creationTime = ListMessageHeader::clock_t::now();
+}
+
+void
+check_header(const ListMessageHeader& decoded, const ListMessageHeader& original)
+{
+  BOOST_CHECK_EQUAL(decoded.sequenceNumber, original.sequenceNumber);
+  BOOST_CHECK_EQUAL(decoded.streamId, original.streamId);
+  BOOST_CHECK_EQUAL(decoded.priority, original.priority);
+  BOOST_CHECK_EQUAL(decoded.flags, original.flags);
+  BOOST_CHECK_EQUAL(decoded.checksum, original.checksum);
+  BOOST_CHECK(decoded.creationTime == original.creationTime);
+}
+
+ListMessage<uint32_t>
+make_message(size_t size)
+{
+  ListMessage<uint32_t> message;
+  fill_header(message.header, size);
+  message.payload = ListMessage<uint32_t>::payload_t::allocate(size, &ListBufferPool::get("default"));
+  for (size_t idx = 0; idx < size; ++idx) {
+    message.payload.data()[idx] = static_cast<uint32_t>(idx * 2654435761u);
+  }
+  message.set_checksum();
+  return message;
+}
+
+ListBatch<uint16_t>
+make_batch(size_t listCount, size_t listLength)
+{
+  ListBatch<uint16_t> batch = ListBatch<uint16_t>::allocate(listCount, listLength, &ListBufferPool::get("default"));
+  fill_header(batch.header, listCount);
+  for (size_t idx = 0; idx < batch.payload.size(); ++idx) {
+    batch.payload.data()[idx] = static_cast<uint16_t>(idx * 7 + 1);
+  }
+  batch.set_checksum();
+  return batch;
+}
+
+/**
+ * @brief A rope of the given size in chunks of chunkSize, reversed so that its chunks are held
+ * back-to-front
+ */
+ListRopeMessage<uint64_t>
+make_rope(size_t size, size_t chunkSize)
+{
+  ListRopeMessage<uint64_t> message;
+  fill_header(message.header, size);
+  message.payload = ListRope<uint64_t>::allocate(size, chunkSize, &ListBufferPool::get("default"));
+  uint64_t value = 0;
+  for (size_t chunk = 0; chunk < message.payload.chunk_count(); ++chunk) {
+    for (size_t idx = 0; idx < message.payload.chunk(chunk).buffer.size(); ++idx) {
+      message.payload.chunk_data(chunk)[idx] = value++ * 0x9e3779b97f4a7c15ULL;
+    }
+  }
+  message.set_checksum();
+  message.payload.reverse();
+  return message;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ListMessageCodec_test)
+
+BOOST_AUTO_TEST_CASE(MessageRoundTrip)
+{
+  // sizes that leave the elements unpadded, padded, and absent
+  for (size_t size : { 0, 1, 3, 4, 1000 }) {
+    ListMessage<uint32_t> original = make_message(size);
+    Frame frame = encode(original);
+    BOOST_REQUIRE_EQUAL(frame.bytes % ListWireHeader::ALIGNMENT, 0);
+
+    ListMessageView<uint32_t> view;
+    BOOST_REQUIRE(view_list_message<ListMessage<uint32_t>>(frame.data(), frame.bytes, view));
+    check_header(view.header, original.header);
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+      view.list.begin(), view.list.end(), original.payload.data(), original.payload.data() + size);
+    BOOST_CHECK(view.checksum_matches());
+
+    ListMessage<uint32_t> decoded;
+    BOOST_REQUIRE(read_list_message(frame.data(), frame.bytes, decoded, &ListBufferPool::get("default")));
+    check_header(decoded.header, original.header);
+    BOOST_REQUIRE_EQUAL(decoded.payload.size(), size);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.payload.data(),
+                                  decoded.payload.data() + size,
+                                  original.payload.data(),
+                                  original.payload.data() + size);
+    BOOST_CHECK(decoded.checksum_matches());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BatchRoundTrip)
+{
+  // an odd number of offsets and of values leaves both padded
+  for (auto shape : { std::make_pair(0, 0), std::make_pair(1, 0), std::make_pair(3, 5), std::make_pair(8, 64) }) {
+    ListBatch<uint16_t> original = make_batch(shape.first, shape.second);
+    Frame frame = encode(original);
+
+    ListBatchView<uint16_t> view;
+    BOOST_REQUIRE(view_list_message<ListBatch<uint16_t>>(frame.data(), frame.bytes, view));
+    check_header(view.header, original.header);
+    BOOST_REQUIRE_EQUAL(view.list_count(), original.list_count());
+    for (size_t list = 0; list < view.list_count(); ++list) {
+      BOOST_CHECK_EQUAL_COLLECTIONS(view.list(list).begin(),
+                                    view.list(list).end(),
+                                    original.list_data(list),
+                                    original.list_data(list) + original.list_size(list));
+    }
+
+    ListBatch<uint16_t> decoded;
+    BOOST_REQUIRE(read_list_message(frame.data(), frame.bytes, decoded, &ListBufferPool::get("default")));
+    check_header(decoded.header, original.header);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.offsets.data(),
+                                  decoded.offsets.data() + decoded.offsets.size(),
+                                  original.offsets.data(),
+                                  original.offsets.data() + original.offsets.size());
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.payload.data(),
+                                  decoded.payload.data() + decoded.payload.size(),
+                                  original.payload.data(),
+                                  original.payload.data() + original.payload.size());
+    BOOST_CHECK(decoded.checksum_matches());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(RopeRoundTrip)
+{
+  // chunks that divide the size, a short last chunk, and an empty rope
+  for (auto shape : { std::make_pair(64, 16), std::make_pair(100, 32), std::make_pair(7, 64), std::make_pair(0, 8) }) {
+    ListRopeMessage<uint64_t> original = make_rope(shape.first, shape.second);
+    Frame frame = encode(original);
+
+    ListRopeView<uint64_t> view;
+    BOOST_REQUIRE(view_list_message<ListRopeMessage<uint64_t>>(frame.data(), frame.bytes, view));
+    check_header(view.header, original.header);
+    BOOST_REQUIRE_EQUAL(view.size, original.payload.size());
+    BOOST_REQUIRE_EQUAL(view.chunkCount, original.payload.chunk_count());
+    std::vector<uint64_t> viewed;
+    view.for_each_chunk([&](const ListView<uint64_t>& chunk, bool reversed) {
+      BOOST_CHECK(reversed);
+      viewed.insert(viewed.end(), chunk.begin(), chunk.end());
+      std::reverse(viewed.end() - chunk.size(), viewed.end());
+    });
+    std::vector<uint64_t> expected = original.payload.to_vector();
+    BOOST_CHECK_EQUAL_COLLECTIONS(viewed.begin(), viewed.end(), expected.begin(), expected.end());
+
+    ListRopeMessage<uint64_t> decoded;
+    BOOST_REQUIRE(read_list_message(frame.data(), frame.bytes, decoded, &ListBufferPool::get("default")));
+    check_header(decoded.header, original.header);
+    std::vector<uint64_t> read = decoded.payload.to_vector();
+    BOOST_CHECK_EQUAL_COLLECTIONS(read.begin(), read.end(), expected.begin(), expected.end());
+    BOOST_CHECK(decoded.checksum_matches(true));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CompressedRoundTrip)
+{
+  for (ListCompression compression : { ListCompression::kBitPacking, ListCompression::kDelta, ListCompression::kVarint }) {
+    // a batch of small values compresses, so it is sent compressed
+    ListBatch<uint16_t> original = make_batch(16, 128);
+    size_t uncompressedBytes = encode(original).bytes;
+    Frame frame = encode(original, compression);
+    BOOST_CHECK_LT(frame.bytes, uncompressedBytes);
+    BOOST_CHECK_EQUAL(frame.wire_header().compression, static_cast<uint8_t>(compression));
+    BOOST_CHECK(!can_view<ListBatch<uint16_t>>(frame));
+
+    ListBatch<uint16_t> decoded;
+    BOOST_REQUIRE(read_list_message(frame.data(), frame.bytes, decoded, &ListBufferPool::get("default")));
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.payload.data(),
+                                  decoded.payload.data() + decoded.payload.size(),
+                                  original.payload.data(),
+                                  original.payload.data() + original.payload.size());
+    BOOST_CHECK(decoded.checksum_matches());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TruncatedFrames)
+{
+  Frame message = encode(make_message(37));
+  Frame batch = encode(make_batch(3, 5));
+  Frame rope = encode(make_rope(100, 32));
+
+  for (size_t bytes = 0; bytes < message.bytes; bytes += ListWireHeader::ALIGNMENT) {
+    // fewer bytes than the frame says it has
+    Frame shortened = message;
+    shortened.bytes = bytes;
+    BOOST_CHECK(!can_view<ListMessage<uint32_t>>(shortened));
+    BOOST_CHECK(!can_read<ListMessage<uint32_t>>(shortened));
+    // and a frame that says it has fewer bytes than its body needs
+    if (bytes >= sizeof(ListWireHeader)) {
+      shortened.truncate(bytes);
+      BOOST_CHECK(!can_view<ListMessage<uint32_t>>(shortened));
+      BOOST_CHECK(!can_read<ListMessage<uint32_t>>(shortened));
+    }
+  }
+  for (size_t bytes = sizeof(ListWireHeader); bytes < batch.bytes; bytes += ListWireHeader::ALIGNMENT) {
+    Frame shortened = batch;
+    shortened.truncate(bytes);
+    BOOST_CHECK(!can_view<ListBatch<uint16_t>>(shortened));
+    BOOST_CHECK(!can_read<ListBatch<uint16_t>>(shortened));
+  }
+  for (size_t bytes = sizeof(ListWireHeader); bytes < rope.bytes; bytes += ListWireHeader::ALIGNMENT) {
+    Frame shortened = rope;
+    shortened.truncate(bytes);
+    BOOST_CHECK(!can_view<ListRopeMessage<uint64_t>>(shortened));
+    BOOST_CHECK(!can_read<ListRopeMessage<uint64_t>>(shortened));
+  }
+
+  // a compressed body that is cut short
+  Frame compressed = encode(make_batch(16, 128), ListCompression::kBitPacking);
+  BOOST_REQUIRE(compressed.wire_header().compression != 0);
+  for (size_t bytes = kBodyOffset; bytes < compressed.bytes; bytes += ListWireHeader::ALIGNMENT) {
+    Frame shortened = compressed;
+    shortened.truncate(bytes);
+    BOOST_CHECK(!can_read<ListBatch<uint16_t>>(shortened));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BadBatchOffsets)
+{
+  using offset_t = ListBatchView<uint16_t>::offset_t;
+  // the offsets follow the numbers of offsets and of values
+  const size_t offsetsStart = 2 * sizeof(uint64_t);
+  Frame original = encode(make_batch(3, 5));
+  BOOST_REQUIRE(can_view<ListBatch<uint16_t>>(original));
+
+  Frame decreasing = original;
+  std::swap(decreasing.body_value<offset_t>(offsetsStart + sizeof(offset_t)),
+            decreasing.body_value<offset_t>(offsetsStart + 2 * sizeof(offset_t)));
+  BOOST_CHECK(!can_view<ListBatch<uint16_t>>(decreasing));
+  BOOST_CHECK(!can_read<ListBatch<uint16_t>>(decreasing));
+
+  Frame notFromZero = original;
+  notFromZero.body_value<offset_t>(offsetsStart) = 1;
+  BOOST_CHECK(!can_view<ListBatch<uint16_t>>(notFromZero));
+
+  Frame pastTheValues = original;
+  pastTheValues.body_value<offset_t>(offsetsStart + 3 * sizeof(offset_t)) = 16;
+  BOOST_CHECK(!can_view<ListBatch<uint16_t>>(pastTheValues));
+
+  Frame shortOfTheValues = original;
+  shortOfTheValues.body_value<offset_t>(offsetsStart + 3 * sizeof(offset_t)) = 14;
+  BOOST_CHECK(!can_view<ListBatch<uint16_t>>(shortOfTheValues));
+
+  Frame negative = original;
+  negative.body_value<offset_t>(offsetsStart + sizeof(offset_t)) = -1;
+  BOOST_CHECK(!can_view<ListBatch<uint16_t>>(negative));
+
+  Frame valuesWithoutOffsets = encode(make_batch(0, 0));
+  valuesWithoutOffsets.body_value<uint64_t>(sizeof(uint64_t)) = 1;
+  BOOST_CHECK(!can_view<ListBatch<uint16_t>>(valuesWithoutOffsets));
+}
+
+BOOST_AUTO_TEST_CASE(BadRopeChunkTables)
+{
+  // the chunk table follows the size, the largest chunk size and the number of chunks
+  const size_t tableStart = 3 * sizeof(uint64_t);
+  Frame original = encode(make_rope(100, 32));
+  BOOST_REQUIRE(can_view<ListRopeMessage<uint64_t>>(original));
+  BOOST_REQUIRE_EQUAL(original.body_value<uint64_t>(2 * sizeof(uint64_t)), 4);
+
+  // lengths that add up to less or more than the size, with the chunks where they were
+  Frame sizeTooLarge = original;
+  sizeTooLarge.body_value<uint64_t>(0) = 101;
+  BOOST_CHECK(!can_view<ListRopeMessage<uint64_t>>(sizeTooLarge));
+  BOOST_CHECK(!can_read<ListRopeMessage<uint64_t>>(sizeTooLarge));
+
+  Frame sizeTooSmall = original;
+  sizeTooSmall.body_value<uint64_t>(0) = 99;
+  BOOST_CHECK(!can_view<ListRopeMessage<uint64_t>>(sizeTooSmall));
+
+  // a chunk that is shorter than its place in the frame
+  Frame chunkTooShort = original;
+  chunkTooShort.body_value<uint64_t>(tableStart) -= 2;
+  BOOST_CHECK(!can_view<ListRopeMessage<uint64_t>>(chunkTooShort));
+  BOOST_CHECK(!can_read<ListRopeMessage<uint64_t>>(chunkTooShort));
+
+  Frame chunkLargerThanChunkSize = original;
+  chunkLargerThanChunkSize.body_value<uint64_t>(sizeof(uint64_t)) = 16;
+  BOOST_CHECK(!can_view<ListRopeMessage<uint64_t>>(chunkLargerThanChunkSize));
+
+  Frame tooManyChunks = original;
+  tooManyChunks.body_value<uint64_t>(2 * sizeof(uint64_t)) = 1u << 30;
+  BOOST_CHECK(!can_view<ListRopeMessage<uint64_t>>(tooManyChunks));
+
+  Frame elementsWithoutChunkSize = original;
+  elementsWithoutChunkSize.body_value<uint64_t>(sizeof(uint64_t)) = 0;
+  BOOST_CHECK(!can_view<ListRopeMessage<uint64_t>>(elementsWithoutChunkSize));
+}
+
+BOOST_AUTO_TEST_CASE(OtherVersionsAndKinds)
+{
+  Frame original = encode(make_message(10));
+  BOOST_REQUIRE(can_view<ListMessage<uint32_t>>(original));
+
+  for (uint16_t version : { 0, ListWireHeader::CURRENT_VERSION + 1, 0xffff }) {
+    Frame otherVersion = original;
+    otherVersion.wire_header().version = version;
+    BOOST_CHECK(!can_view<ListMessage<uint32_t>>(otherVersion));
+    BOOST_CHECK(!can_read<ListMessage<uint32_t>>(otherVersion));
+  }
+
+  Frame otherByteOrder = original;
+  otherByteOrder.wire_header().magic = __builtin_bswap32(ListWireHeader::MAGIC);
+  BOOST_CHECK(!can_view<ListMessage<uint32_t>>(otherByteOrder));
+
+  // the frame of a message is not that of a batch, a rope, or a message of another element type
+  BOOST_CHECK(!can_view<ListBatch<uint32_t>>(original));
+  BOOST_CHECK(!can_view<ListRopeMessage<uint32_t>>(original));
+  BOOST_CHECK(!can_view<ListMessage<uint64_t>>(original));
+  BOOST_CHECK(!can_read<ListMessage<uint16_t>>(original));
+
+  Frame unknownCompression = original;
+  unknownCompression.wire_header().compression = 0x7f;
+  BOOST_CHECK(!can_read<ListMessage<uint32_t>>(unknownCompression));
+
+  // and a frame that does not start on an aligned address is refused rather than read unaligned
+  std::vector<uint64_t> shifted(original.words.size() + 1);
+  std::memcpy(reinterpret_cast<uint8_t*>(shifted.data()) + 4, original.data(), original.bytes);
+  ListMessageView<uint32_t> view;
+  BOOST_CHECK(!view_list_message<ListMessage<uint32_t>>(
+    reinterpret_cast<uint8_t*>(shifted.data()) + 4, original.bytes, view));
+}
+
+BOOST_AUTO_TEST_CASE(OlderHeaders)
+{
+  // an encoder that did not know of the priority left it zero on the wire or wrote padding there
+  Frame legacy = encode(make_message(10));
+  ListMessageHeader header;
+  std::memcpy(&header, legacy.data() + sizeof(ListWireHeader), sizeof(header));
+  header.flags &= ~ListMessageHeader::kHasPriority;
+  header.priority = 0xdeadbeef;
+  std::memcpy(legacy.data() + sizeof(ListWireHeader), &header, sizeof(header));
+  ListMessageView<uint32_t> view;
+  BOOST_REQUIRE(view_list_message<ListMessage<uint32_t>>(legacy.data(), legacy.bytes, view));
+  BOOST_CHECK_EQUAL(view.header.priority, 0);
+  BOOST_CHECK_EQUAL(view.header.sequenceNumber, 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
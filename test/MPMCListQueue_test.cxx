@@ -0,0 +1,319 @@
+/**
+ * @file MPMCListQueue_test.cxx
+ *
+ * Unit tests of the batched pushes and pops of MPMCRing, and of the
+ * priority lanes of MPMCListQueue.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#define BOOST_TEST_MODULE MPMCListQueue_test // NOLINT
+
+#include "ListMessage.hpp"
+#include "MPMCListQueue.hpp"
+#include "MPMCRing.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace dunedaq::afv1_example;
+
+namespace {
+
+/**
+ * @brief Stands in for a ListMessage: the lanes only look at the header
+ */
+struct TestMessage
+{
+  ListMessageHeader header;
+};
+
+constexpr size_t kCapacity = 64;
+constexpr size_t kProducers = 4;
+constexpr size_t kConsumers = 3;
+constexpr uint64_t kValuesPerProducer = 20000;
+
+/**
+ * @brief Batch sizes from one to twice the capacity, bunched around the capacity
+ */
+const std::vector<size_t> kBatchSizes = { 1, 7, kCapacity - 1, kCapacity, kCapacity + 1, 2 * kCapacity };
+
+uint64_t
+make_value(size_t producer, uint64_t index)
+{
+  return (static_cast<uint64_t>(producer) << 32) | index;
+}
+
+/**
+ * @brief What each consumer popped, in the order that it popped it
+ */
+using Popped = std::vector<std::vector<uint64_t>>;
+
+/**
+ * @brief Checks that every value of every producer was popped exactly once, and that each consumer
+ * popped the values of each producer that share a key (a lane, or the whole ring) in the order
+ * that they were pushed
+ */
+template<typename KeyOf>
+void
+check_popped(const Popped& popped, KeyOf keyOf)
+{
+  std::vector<uint64_t> all;
+  for (auto& consumerValues : popped) {
+    all.insert(all.end(), consumerValues.begin(), consumerValues.end());
+
+    std::map<std::pair<size_t, size_t>, uint64_t> nextIndex;
+    for (uint64_t value : consumerValues) {
+      size_t producer = value >> 32;
+      uint64_t index = value & 0xffffffff;
+      auto key = std::make_pair(producer, keyOf(index));
+      auto found = nextIndex.find(key);
+      if (found != nextIndex.end()) {
+        BOOST_REQUIRE_GE(index, found->second);
+      }
+      nextIndex[key] = index + 1;
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(all.size(), kProducers * kValuesPerProducer);
+  std::sort(all.begin(), all.end());
+  size_t position = 0;
+  for (size_t producer = 0; producer < kProducers; ++producer) {
+    for (uint64_t index = 0; index < kValuesPerProducer; ++index) {
+      BOOST_REQUIRE_EQUAL(all[position++], make_value(producer, index));
+    }
+  }
+}
+
+/**
+ * @brief Runs kProducers threads that push their values in batches of the kBatchSizes in turn,
+ * and kConsumers threads that pop in batches of the same sizes until all values have been popped
+ */
+template<typename PushBatch, typename PopBatch>
+Popped
+run_producers_and_consumers(PushBatch pushBatch, PopBatch popBatch)
+{
+  std::atomic<size_t> poppedCount{ 0 };
+  Popped popped(kConsumers);
+
+  std::vector<std::thread> threads;
+  for (size_t producer = 0; producer < kProducers; ++producer) {
+    threads.emplace_back([&, producer] {
+      std::vector<TestMessage> batch;
+      uint64_t next = 0;
+      for (size_t turn = producer; next < kValuesPerProducer; ++turn) {
+        size_t batchSize = std::min<uint64_t>(kBatchSizes[turn % kBatchSizes.size()], kValuesPerProducer - next);
+        batch.assign(batchSize, TestMessage());
+        for (size_t idx = 0; idx < batchSize; ++idx) {
+          batch[idx].header.sequenceNumber = make_value(producer, next + idx);
+          batch[idx].header.priority = static_cast<uint32_t>((next + idx) % 3);
+        }
+        size_t pushed = 0;
+        while (pushed < batchSize) {
+          size_t morePushed = pushBatch(batch.data() + pushed, batchSize - pushed);
+          if (morePushed == 0) {
+            std::this_thread::yield();
+          }
+          pushed += morePushed;
+        }
+        next += batchSize;
+      }
+    });
+  }
+  for (size_t consumer = 0; consumer < kConsumers; ++consumer) {
+    threads.emplace_back([&, consumer] {
+      std::vector<TestMessage> batch(2 * kCapacity);
+      for (size_t turn = consumer; poppedCount.load() < kProducers * kValuesPerProducer; ++turn) {
+        size_t count = popBatch(batch.data(), kBatchSizes[turn % kBatchSizes.size()]);
+        if (count == 0) {
+          std::this_thread::yield();
+        }
+        for (size_t idx = 0; idx < count; ++idx) {
+          popped[consumer].push_back(batch[idx].header.sequenceNumber);
+        }
+        poppedCount += count;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return popped;
+}
+
+/**
+ * @brief Fills each lane of the queue with count messages of its priority
+ */
+void
+fill_lanes(MPMCListQueue<TestMessage>& queue, size_t count)
+{
+  for (uint32_t lane = 0; lane < queue.lane_count(); ++lane) {
+    for (size_t idx = 0; idx < count; ++idx) {
+      TestMessage message;
+      message.header.priority = lane;
+      message.header.sequenceNumber = idx;
+      queue.push(std::move(message), std::chrono::milliseconds(0));
+    }
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MPMCListQueue_test)
+
+BOOST_AUTO_TEST_CASE(RingBatchesFromSeveralThreads)
+{
+  MPMCRing<TestMessage> ring(kCapacity);
+  BOOST_REQUIRE_EQUAL(ring.capacity(), kCapacity);
+
+  Popped popped = run_producers_and_consumers(
+    [&](TestMessage* values, size_t count) { return ring.try_push_n(values, count); },
+    [&](TestMessage* values, size_t maxCount) { return ring.try_pop_n(values, maxCount); });
+
+  check_popped(popped, [](uint64_t) { return 0; });
+  BOOST_REQUIRE_EQUAL(ring.size_approx(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(RingBatchLargerThanCapacity)
+{
+  MPMCRing<TestMessage> ring(kCapacity);
+  std::vector<TestMessage> batch(2 * kCapacity);
+  for (size_t idx = 0; idx < batch.size(); ++idx) {
+    batch[idx].header.sequenceNumber = idx;
+  }
+
+  BOOST_REQUIRE_EQUAL(ring.try_push_n(batch.data(), batch.size()), kCapacity);
+  BOOST_REQUIRE_EQUAL(ring.try_push_n(batch.data() + kCapacity, kCapacity), 0);
+
+  std::vector<TestMessage> out(2 * kCapacity);
+  BOOST_REQUIRE_EQUAL(ring.try_pop_n(out.data(), out.size()), kCapacity);
+  for (size_t idx = 0; idx < kCapacity; ++idx) {
+    BOOST_REQUIRE_EQUAL(out[idx].header.sequenceNumber, idx);
+  }
+  BOOST_REQUIRE_EQUAL(ring.try_pop_n(out.data(), out.size()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LanesFromSeveralThreads)
+{
+  for (const std::vector<size_t>& laneWeights : { std::vector<size_t>(), std::vector<size_t>{ 1, 2, 4 } }) {
+    MPMCListQueue<TestMessage> queue("lanes", kCapacity, 3, laneWeights);
+    BOOST_REQUIRE_EQUAL(queue.lane_count(), 3);
+    BOOST_REQUIRE_EQUAL(queue.capacity(), 3 * kCapacity);
+
+    Popped popped = run_producers_and_consumers(
+      [&](TestMessage* values, size_t count) {
+        size_t droppedCount = 0;
+        return queue.push_n(values, count, std::chrono::milliseconds(1), nullptr, droppedCount);
+      },
+      [&](TestMessage* values, size_t maxCount) {
+        return queue.pop_n(values, maxCount, std::chrono::milliseconds(1), nullptr);
+      });
+
+    // the producers put value i on lane i % 3
+    check_popped(popped, [](uint64_t index) { return index % 3; });
+    BOOST_REQUIRE_EQUAL(queue.size_approx(), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StrictPriority)
+{
+  MPMCListQueue<TestMessage> queue("strict", kCapacity, 3);
+  fill_lanes(queue, 10);
+
+  // a message of a priority beyond the highest lane goes onto the highest lane
+  TestMessage urgent;
+  urgent.header.priority = 7;
+  urgent.header.sequenceNumber = 10;
+  queue.push(std::move(urgent), std::chrono::milliseconds(0));
+
+  for (uint32_t lane = 3; lane-- > 0;) {
+    for (uint64_t idx = 0; idx < (lane == 2 ? 11u : 10u); ++idx) {
+      TestMessage message;
+      queue.pop(message, std::chrono::milliseconds(0));
+      BOOST_REQUIRE_EQUAL(message.header.priority, lane == 2 && idx == 10 ? 7 : lane);
+      BOOST_REQUIRE_EQUAL(message.header.sequenceNumber, idx);
+    }
+  }
+  BOOST_REQUIRE(!queue.can_pop());
+}
+
+BOOST_AUTO_TEST_CASE(WeightedProportions)
+{
+  const std::vector<size_t> laneWeights = { 1, 3, 4 };
+  const size_t rounds = 8;
+  MPMCListQueue<TestMessage> queue("weighted", kCapacity, laneWeights.size(), laneWeights);
+  fill_lanes(queue, kCapacity);
+
+  // while no lane runs dry, each full pass of the schedule pops exactly each lane's weight
+  std::vector<size_t> perLane(laneWeights.size(), 0);
+  std::vector<uint32_t> order;
+  for (size_t turn = 0; turn < rounds * 8; ++turn) {
+    TestMessage message;
+    queue.pop(message, std::chrono::milliseconds(0));
+    ++perLane[message.header.priority];
+    order.push_back(message.header.priority);
+  }
+  for (size_t lane = 0; lane < laneWeights.size(); ++lane) {
+    BOOST_CHECK_EQUAL(perLane[lane], rounds * laneWeights[lane]);
+  }
+
+  // and spreads the turns of a lane out rather than popping them in a run
+  size_t longestRun = 1;
+  size_t run = 1;
+  for (size_t idx = 1; idx < order.size(); ++idx) {
+    run = order[idx] == order[idx - 1] ? run + 1 : 1;
+    longestRun = std::max(longestRun, run);
+  }
+  BOOST_CHECK_LE(longestRun, 2);
+}
+
+BOOST_AUTO_TEST_CASE(WeightedSkipsEmptyLanes)
+{
+  MPMCListQueue<TestMessage> queue("weighted", kCapacity, 2, { 1, 1 });
+  for (size_t idx = 0; idx < 5; ++idx) {
+    TestMessage message;
+    message.header.sequenceNumber = idx;
+    queue.push(std::move(message), std::chrono::milliseconds(0));
+  }
+
+  for (uint64_t idx = 0; idx < 5; ++idx) {
+    TestMessage message;
+    queue.pop(message, std::chrono::milliseconds(0));
+    BOOST_REQUIRE_EQUAL(message.header.sequenceNumber, idx);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BatchToppedUpFromHighestLane)
+{
+  MPMCListQueue<TestMessage> queue("weighted", kCapacity, 3, { 1, 1, 1 });
+  fill_lanes(queue, 4);
+
+  // the first pass of the schedule starts at the highest of the lanes with the same weight
+  std::vector<TestMessage> out(12);
+  BOOST_REQUIRE_EQUAL(queue.pop_n(out.data(), out.size(), std::chrono::milliseconds(0), nullptr), 12);
+  for (size_t idx = 0; idx < out.size(); ++idx) {
+    BOOST_REQUIRE_EQUAL(out[idx].header.priority, 2 - idx / 4);
+    BOOST_REQUIRE_EQUAL(out[idx].header.sequenceNumber, idx % 4);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BadLaneSettings)
+{
+  BOOST_CHECK_THROW(MPMCListQueue<TestMessage>("none", kCapacity, 0), std::invalid_argument);
+  BOOST_CHECK_THROW(MPMCListQueue<TestMessage>("short", kCapacity, 3, { 1, 2 }), std::invalid_argument);
+  BOOST_CHECK_THROW(MPMCListQueue<TestMessage>("zero", kCapacity, 2, { 1, 0 }), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
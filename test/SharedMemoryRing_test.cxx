@@ -0,0 +1,205 @@
+/**
+ * @file SharedMemoryRing_test.cxx
+ *
+ * Unit tests of how SharedMemoryRing takes back the slots that a producer
+ * or a consumer claimed and never finished with, and of the payloads that
+ * SharedMemoryListQueue places in its slots.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#define BOOST_TEST_MODULE SharedMemoryRing_test // NOLINT
+
+#include "ListBufferPool.hpp"
+#include "ListMessage.hpp"
+#include "SharedMemoryListQueue.hpp"
+#include "SharedMemoryRing.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+
+using namespace dunedaq::afv1_example;
+
+namespace {
+
+constexpr size_t kSlotCount = 2;
+constexpr size_t kSlotBytes = 64;
+constexpr uint64_t kTypeTag = 42;
+
+/**
+ * @brief Each ring of a pair stands in for a process of its own: the two share the segment but not
+ * the timing of the slots that hold them up
+ */
+struct RingPair
+{
+  explicit RingPair(const std::string& name)
+  {
+    SharedMemoryRing::remove(name);
+    producer.reset(new SharedMemoryRing(name, kSlotCount, kSlotBytes, kTypeTag));
+    consumer.reset(new SharedMemoryRing(name, kSlotCount, kSlotBytes, kTypeTag));
+  }
+
+  std::unique_ptr<SharedMemoryRing> producer;
+  std::unique_ptr<SharedMemoryRing> consumer;
+};
+
+void
+push_value(SharedMemoryRing& ring, uint64_t value)
+{
+  uint64_t position;
+  SharedMemoryRing::Slot* slot = ring.begin_push(position);
+  BOOST_REQUIRE(slot != nullptr);
+  std::memcpy(ring.slot_data(slot), &value, sizeof(value));
+  BOOST_REQUIRE(ring.end_push(slot, position, sizeof(value)));
+}
+
+uint64_t
+pop_value(SharedMemoryRing& ring)
+{
+  uint64_t position;
+  SharedMemoryRing::Slot* slot = ring.begin_pop(position);
+  BOOST_REQUIRE(slot != nullptr);
+  const SharedMemoryRing::Slot* readSlot = slot;
+  BOOST_REQUIRE_EQUAL(ring.slot_size(readSlot), sizeof(uint64_t));
+  uint64_t value;
+  std::memcpy(&value, ring.slot_data(readSlot), sizeof(value));
+  BOOST_REQUIRE(ring.end_pop(slot, position));
+  return value;
+}
+
+void
+wait_past_claim_timeout()
+{
+  std::this_thread::sleep_for(SharedMemoryRing::CLAIM_TIMEOUT + std::chrono::milliseconds(100));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(AbandonedPushIsSkipped)
+{
+  RingPair rings("SharedMemoryRing_test.push");
+
+  uint64_t abandonedPosition;
+  SharedMemoryRing::Slot* abandonedSlot = rings.producer->begin_push(abandonedPosition);
+  BOOST_REQUIRE(abandonedSlot != nullptr);
+  push_value(*rings.producer, 7);
+
+  // the message behind the claimed slot is held up until the claim has timed out
+  uint64_t position;
+  BOOST_REQUIRE(rings.consumer->begin_pop(position) == nullptr);
+  wait_past_claim_timeout();
+  BOOST_REQUIRE_EQUAL(pop_value(*rings.consumer), 7);
+  BOOST_REQUIRE_EQUAL(rings.consumer->take_skipped_slot_count(), 1);
+  BOOST_REQUIRE_EQUAL(rings.consumer->take_skipped_slot_count(), 0);
+
+  // the producer is told that its message was lost, and the slot is free for the next one
+  BOOST_REQUIRE(!rings.producer->end_push(abandonedSlot, abandonedPosition, sizeof(uint64_t)));
+  push_value(*rings.producer, 8);
+  BOOST_REQUIRE_EQUAL(pop_value(*rings.consumer), 8);
+  BOOST_REQUIRE_EQUAL(rings.producer->take_skipped_slot_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(AbandonedPopIsTakenBack)
+{
+  RingPair rings("SharedMemoryRing_test.pop");
+
+  push_value(*rings.producer, 1);
+  push_value(*rings.producer, 2);
+  uint64_t abandonedPosition;
+  SharedMemoryRing::Slot* abandonedSlot = rings.consumer->begin_pop(abandonedPosition);
+  BOOST_REQUIRE(abandonedSlot != nullptr);
+  BOOST_REQUIRE_EQUAL(pop_value(*rings.consumer), 2);
+
+  // the ring is full until the claim of the popped slot has timed out
+  uint64_t position;
+  BOOST_REQUIRE(rings.producer->begin_push(position) == nullptr);
+  wait_past_claim_timeout();
+  push_value(*rings.producer, 3);
+  BOOST_REQUIRE_EQUAL(rings.producer->take_skipped_slot_count(), 1);
+
+  // the consumer is told that what it read may have been overwritten
+  BOOST_REQUIRE(!rings.consumer->end_pop(abandonedSlot, abandonedPosition));
+  BOOST_REQUIRE_EQUAL(pop_value(*rings.consumer), 3);
+  BOOST_REQUIRE(rings.consumer->begin_pop(position) == nullptr);
+  BOOST_REQUIRE_EQUAL(rings.consumer->take_skipped_slot_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(PlacedPayloadIsPublishedWhenDropped)
+{
+  using Message = ListMessage<uint32_t>;
+  const std::string name = "SharedMemoryRing_test.placed";
+  SharedMemoryRing::remove(name);
+  ListBufferPool& pool = ListBufferPool::get("SharedMemoryRing_test");
+  SharedMemoryListQueue<Message> producer(name, 4, 4096, &pool);
+  SharedMemoryListQueue<Message> consumer(name, 4, 4096, &pool);
+  const std::chrono::milliseconds timeout(10);
+  size_t droppedCount = 0;
+
+  Message message;
+  message.payload = producer.place_payload(100, timeout, nullptr);
+  BOOST_REQUIRE_EQUAL(message.payload.size(), 100);
+  BOOST_REQUIRE(message.payload.pool() != &pool);
+  std::iota(message.payload.begin(), message.payload.end(), 1);
+  message.header.sequenceNumber = 5;
+  BOOST_REQUIRE_EQUAL(producer.push_n(&message, 1, timeout, nullptr, droppedCount), 1);
+
+  // the slot is published once the payload is dropped, not when it is pushed
+  Message popped;
+  BOOST_REQUIRE_EQUAL(consumer.pop_n(&popped, 1, std::chrono::milliseconds(0), nullptr), 0);
+  Message copy = message;
+  message = Message();
+  BOOST_REQUIRE_EQUAL(consumer.pop_n(&popped, 1, std::chrono::milliseconds(0), nullptr), 0);
+  copy = Message();
+  BOOST_REQUIRE_EQUAL(consumer.pop_n(&popped, 1, timeout, nullptr), 1);
+  BOOST_REQUIRE_EQUAL(popped.header.sequenceNumber, 5);
+  BOOST_REQUIRE_EQUAL(popped.payload.size(), 100);
+  for (size_t idx = 0; idx < popped.payload.size(); ++idx) {
+    BOOST_REQUIRE_EQUAL(popped.payload[idx], idx + 1);
+  }
+
+  // a payload that is too large for a slot is not placed
+  BOOST_REQUIRE(producer.place_payload(4096, timeout, nullptr).empty());
+  BOOST_REQUIRE_EQUAL(droppedCount, 0);
+}
+
+BOOST_AUTO_TEST_CASE(UnpushedPlacedPayloadIsSkipped)
+{
+  using Message = ListMessage<uint32_t>;
+  const std::string name = "SharedMemoryRing_test.unpushed";
+  SharedMemoryRing::remove(name);
+  ListBufferPool& pool = ListBufferPool::get("SharedMemoryRing_test");
+  SharedMemoryListQueue<Message> producer(name, 4, 4096, &pool);
+  SharedMemoryListQueue<Message> consumer(name, 4, 4096, &pool);
+  const std::chrono::milliseconds timeout(10);
+  size_t droppedCount = 0;
+
+  Message unpushed;
+  unpushed.payload = producer.place_payload(10, timeout, nullptr);
+  Message pushedTwice;
+  pushedTwice.payload = producer.place_payload(20, timeout, nullptr);
+  pushedTwice.header.sequenceNumber = 2;
+  BOOST_REQUIRE_EQUAL(producer.push_n(&pushedTwice, 1, timeout, nullptr, droppedCount), 1);
+  // the second push can not be carried in the same slot, so it is copied
+  BOOST_REQUIRE_EQUAL(producer.push_n(&pushedTwice, 1, timeout, nullptr, droppedCount), 1);
+  BOOST_REQUIRE_EQUAL(producer.size_approx(), 3);
+  unpushed = Message();
+  pushedTwice = Message();
+
+  Message popped[3];
+  BOOST_REQUIRE_EQUAL(consumer.pop_n(popped, 3, timeout, nullptr), 2);
+  BOOST_REQUIRE_EQUAL(popped[0].header.sequenceNumber, 2);
+  BOOST_REQUIRE_EQUAL(popped[0].payload.size(), 20);
+  BOOST_REQUIRE_EQUAL(popped[1].header.sequenceNumber, 2);
+  BOOST_REQUIRE_EQUAL(popped[1].payload.size(), 20);
+  BOOST_REQUIRE_EQUAL(consumer.size_approx(), 0);
+}